@@ -1,5 +1,6 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
+using System.IO;
 using UnrealBuildTool;
 
 public class DiamondSquareCPP : ModuleRules
@@ -10,7 +11,10 @@ public class DiamondSquareCPP : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] { "ProceduralMeshComponent" });
+		PrivateDependencyModuleNames.AddRange(new string[] { "ProceduralMeshComponent", "ImageWrapper", "Json", "JsonUtilities", "HTTPServer" });
+
+		// Engine-independent generation core; its sources build with the module, and on their own through its CMakeLists.txt
+		PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "GenerationCore", "Public"));
 
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
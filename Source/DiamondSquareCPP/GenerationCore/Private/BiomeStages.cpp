@@ -0,0 +1,103 @@
+#include "GenerationCore/BiomeStages.h"
+
+namespace GenerationCore
+{
+    bool IsEdgeCell(const FBiomeBoard& Board, int32_t R, int32_t C)
+    {
+        const ECell Key = Board(R, C);
+
+        // Up, Down, Left, Right; neighbours outside the board never make an edge
+        return (R > 0 && Board(R - 1, C) != Key)
+            || (R < Board.Rows - 1 && Board(R + 1, C) != Key)
+            || (C > 0 && Board(R, C - 1) != Key)
+            || (C < Board.Cols - 1 && Board(R, C + 1) != Key);
+    }
+
+    void ComputeEdgeMask(const FBiomeBoard& Board, TGrid<uint8_t>& OutMask)
+    {
+        const int32_t Rows = Board.Rows;
+        const int32_t Cols = Board.Cols;
+        OutMask.Init(Rows, Cols);
+
+        for (int32_t R = 0; R < Rows; ++R)
+        {
+            // At the top and bottom rows the row is compared with itself, which never differs
+            const ECell* Cur = Board.Row(R);
+            const ECell* Up = R > 0 ? Board.Row(R - 1) : Cur;
+            const ECell* Down = R < Rows - 1 ? Board.Row(R + 1) : Cur;
+            uint8_t* Out = OutMask.Row(R);
+
+            // Branch-free whole-row compares against the rows above and below and the row shifted by one
+            for (int32_t C = 0; C < Cols; ++C)
+            {
+                Out[C] = uint8_t(Cur[C] != Up[C]) | uint8_t(Cur[C] != Down[C]);
+            }
+            for (int32_t C = 0; C < Cols - 1; ++C)
+            {
+                Out[C] |= uint8_t(Cur[C] != Cur[C + 1]);
+            }
+            for (int32_t C = 1; C < Cols; ++C)
+            {
+                Out[C] |= uint8_t(Cur[C] != Cur[C - 1]);
+            }
+        }
+    }
+
+    void RefreshEdgeMask(const FBiomeBoard& Board, TGrid<uint8_t>& Mask, int32_t R, int32_t C)
+    {
+        if (C + 1 < Board.Cols)
+        {
+            Mask(R, C + 1) = IsEdgeCell(Board, R, C + 1);
+        }
+        if (R + 1 < Board.Rows)
+        {
+            Mask(R + 1, C) = IsEdgeCell(Board, R + 1, C);
+        }
+    }
+
+    bool IsSurroundedByOcean(const FBiomeBoard& Board, int32_t R, int32_t C)
+    {
+        return (R == 0 || Board(R - 1, C) == ECell::Ocean)
+            && (R == Board.Rows - 1 || Board(R + 1, C) == ECell::Ocean)
+            && (C == 0 || Board(R, C - 1) == ECell::Ocean)
+            && (C == Board.Cols - 1 || Board(R, C + 1) == ECell::Ocean);
+    }
+
+    FBiomeBoard Zoom(const FBiomeBoard& Board, uint32_t StageSeed)
+    {
+        const int32_t Rows = Board.Rows * 2;
+        const int32_t Cols = Board.Cols * 2;
+
+        // Reads only from the upscaled input, so the result does not depend on the order cells are visited
+        auto Scaled = [&Board](int32_t R, int32_t C) { return Board(R / 2, C / 2); };
+        FBiomeBoard Result(Rows, Cols);
+        for (int32_t R = 0; R < Rows; ++R)
+        {
+            ECell* Out = Result.Row(R);
+            for (int32_t C = 0; C < Cols; ++C)
+            {
+                Out[C] = ZoomCell(Scaled, Rows, Cols, StageSeed, R, C);
+            }
+        }
+        return Result;
+    }
+
+    void SurroundWithOcean(FBiomeBoard& Board)
+    {
+        if (Board.Rows == 0 || Board.Cols == 0)
+        {
+            return;
+        }
+
+        for (int32_t C = 0; C < Board.Cols; ++C)
+        {
+            Board(0, C) = ECell::Ocean;
+            Board(Board.Rows - 1, C) = ECell::Ocean;
+        }
+        for (int32_t R = 0; R < Board.Rows; ++R)
+        {
+            Board(R, 0) = ECell::Ocean;
+            Board(R, Board.Cols - 1) = ECell::Ocean;
+        }
+    }
+}
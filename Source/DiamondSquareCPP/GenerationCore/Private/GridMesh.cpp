@@ -0,0 +1,55 @@
+#include "GenerationCore/GridMesh.h"
+
+namespace GenerationCore
+{
+    int64_t BuildGridTriangles(int32_t Rows, int32_t Cols, const float* SkipMask, int32_t* OutIndices)
+    {
+        int32_t* Out = OutIndices;
+        for (int32_t X = 0; X < Rows - 1; ++X)
+        {
+            for (int32_t Y = 0; Y < Cols - 1; ++Y)
+            {
+                const int32_t VertexIndex = X * Cols + Y;
+
+                // The cave layer has its own surface here
+                if (SkipMask && SkipMask[VertexIndex] >= 1.0f && SkipMask[VertexIndex + 1] >= 1.0f
+                    && SkipMask[VertexIndex + Cols] >= 1.0f && SkipMask[VertexIndex + Cols + 1] >= 1.0f)
+                {
+                    continue;
+                }
+
+                // First triangle: bottom left, top right, top left
+                Out[0] = VertexIndex;
+                Out[1] = VertexIndex + Cols + 1;
+                Out[2] = VertexIndex + Cols;
+
+                // Second triangle: bottom left, bottom right, top right
+                Out[3] = VertexIndex;
+                Out[4] = VertexIndex + 1;
+                Out[5] = VertexIndex + Cols + 1;
+                Out += 6;
+            }
+        }
+        return Out - OutIndices;
+    }
+
+    void BuildGridVertices(const TGrid<float>& Noise, const FGridMeshSettings& Settings, int32_t FirstRow, int32_t EndRow, float* OutPositions, float* OutUVs)
+    {
+        for (int32_t X = FirstRow; X < EndRow; ++X)
+        {
+            const float* Row = Noise.Row(X);
+            for (int32_t Y = 0; Y < Noise.Cols; ++Y)
+            {
+                const int64_t Index = int64_t(X) * Noise.Cols + Y;
+                OutPositions[Index * 3 + 0] = X * Settings.Scale;
+                OutPositions[Index * 3 + 1] = Y * Settings.Scale;
+                OutPositions[Index * 3 + 2] = GetVertexHeight(Settings, Row[Y]);
+                if (OutUVs)
+                {
+                    OutUVs[Index * 2 + 0] = X * Settings.UVScale;
+                    OutUVs[Index * 2 + 1] = Y * Settings.UVScale;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#include "GenerationCore/Noise.h"
+
+#include <cmath>
+
+namespace GenerationCore
+{
+    namespace
+    {
+        // Ken Perlin's reference permutation
+        const uint8_t PerlinPermutation[256] = {
+            151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
+            140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
+            247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
+            57, 177, 33, 88, 237, 149, 56, 87, 174, 20, 125, 136, 171, 168, 68, 175,
+            74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122,
+            60, 211, 133, 230, 220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54,
+            65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+            200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64,
+            52, 217, 226, 250, 124, 123, 5, 202, 38, 147, 118, 126, 255, 82, 85, 212,
+            207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213,
+            119, 248, 152, 2, 44, 154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9,
+            129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+            218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241,
+            81, 51, 145, 235, 249, 14, 239, 107, 49, 192, 214, 31, 181, 199, 106, 157,
+            184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93,
+            222, 114, 67, 29, 24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180 };
+
+        inline int32_t PerlinHash(int32_t X, int32_t Y)
+        {
+            return PerlinPermutation[(PerlinPermutation[X & 255] + Y) & 255];
+        }
+
+        inline float PerlinFade(float T)
+        {
+            return T * T * T * (T * (T * 6.0f - 15.0f) + 10.0f);
+        }
+
+        inline float PerlinLerp(float A, float B, float Alpha)
+        {
+            return A + Alpha * (B - A);
+        }
+
+        // Dot product with one of eight gradients: the four axes and the four diagonals
+        inline float PerlinGradient(int32_t Hash, float X, float Y)
+        {
+            switch (Hash & 7)
+            {
+            case 0: return X + Y;
+            case 1: return -X + Y;
+            case 2: return X - Y;
+            case 3: return -X - Y;
+            case 4: return X;
+            case 5: return -X;
+            case 6: return Y;
+            default: return -Y;
+            }
+        }
+    }
+
+    float PerlinNoise2D(float X, float Y)
+    {
+        const float FloorX = std::floor(X);
+        const float FloorY = std::floor(Y);
+
+        // The lattice repeats every 256 cells; wrap before converting, as high octaves sample far past the int32 range
+        const int32_t CellX = int32_t(FloorX - 256.0f * std::floor(FloorX * (1.0f / 256.0f)));
+        const int32_t CellY = int32_t(FloorY - 256.0f * std::floor(FloorY * (1.0f / 256.0f)));
+        const float FracX = X - FloorX;
+        const float FracY = Y - FloorY;
+        const float U = PerlinFade(FracX);
+        const float V = PerlinFade(FracY);
+
+        const float Bottom = PerlinLerp(
+            PerlinGradient(PerlinHash(CellX, CellY), FracX, FracY),
+            PerlinGradient(PerlinHash(CellX + 1, CellY), FracX - 1.0f, FracY), U);
+        const float Top = PerlinLerp(
+            PerlinGradient(PerlinHash(CellX, CellY + 1), FracX, FracY - 1.0f),
+            PerlinGradient(PerlinHash(CellX + 1, CellY + 1), FracX - 1.0f, FracY - 1.0f), U);
+        return PerlinLerp(Bottom, Top, V);
+    }
+}
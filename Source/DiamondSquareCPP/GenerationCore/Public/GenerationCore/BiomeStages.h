@@ -0,0 +1,341 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include "GenerationCore/Cell.h"
+#include "GenerationCore/Grid.h"
+
+// Stages of the stochastic biome automaton. Random stages take their generator as a template parameter with the
+// FRandomStream interface (FRand, RandRange), so FRandom and the engine's FRandomStream both work and make the
+// same boards from the same seed. Every stage returns a new board and leaves its input alone.
+
+namespace GenerationCore
+{
+    using FBiomeBoard = TGrid<ECell>;
+
+    // Temperature cells are never reshaped by the island stages
+    inline bool CanTransform(ECell Cell)
+    {
+        return !TemperatureCells.Contains(Cell);
+    }
+
+    // True if a 4-neighbour of (R, C) inside the board differs from it
+    bool IsEdgeCell(const FBiomeBoard& Board, int32_t R, int32_t C);
+
+    // IsEdgeCell for every cell, as 0 or 1
+    void ComputeEdgeMask(const FBiomeBoard& Board, TGrid<uint8_t>& OutMask);
+
+    // After Board(R, C) changes in place, refreshes the mask of the cells right of and below it, the only
+    // neighbours a row-major sweep has yet to visit
+    void RefreshEdgeMask(const FBiomeBoard& Board, TGrid<uint8_t>& Mask, int32_t R, int32_t C);
+
+    // True if every 4-neighbour of (R, C) inside the board is Ocean
+    bool IsSurroundedByOcean(const FBiomeBoard& Board, int32_t R, int32_t C);
+
+    // Well-mixed hash of a cell coordinate, so per-cell random choices do not depend on visiting order
+    inline uint32_t HashCell(uint32_t Seed, int32_t R, int32_t C)
+    {
+        uint32_t Hash = Seed ^ (uint32_t(R) * 0x9E3779B1u) ^ (uint32_t(C) * 0x85EBCA77u);
+        Hash ^= Hash >> 16;
+        Hash *= 0x7FEB352Du;
+        Hash ^= Hash >> 15;
+        Hash *= 0x846CA68Bu;
+        Hash ^= Hash >> 16;
+        return Hash;
+    }
+
+    struct FCellOffset
+    {
+        int32_t R = 0;
+        int32_t C = 0;
+    };
+
+    // Offset a Zoom edge cell copies from, drawn from { -1, -1, 0 x 8, 1, 1 } on each axis
+    inline FCellOffset ZoomOffset(uint32_t StageSeed, int32_t R, int32_t C)
+    {
+        static constexpr int32_t Indexes[] = { -1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1 };
+        const uint32_t Hash = HashCell(StageSeed, R, C);
+        return { Indexes[(Hash & 0xFFFF) % 12], Indexes[(Hash >> 16) % 12] };
+    }
+
+    // Zoom output at (R, C) of a Rows x Cols board, given Scaled(R, C) reading the 2x upscaled input. Edge cells
+    // copy a jittered neighbour of the upscaled input. Scaled may return any comparable cell type.
+    template <typename ScaledType>
+    inline auto ZoomCell(ScaledType&& Scaled, int32_t Rows, int32_t Cols, uint32_t StageSeed, int32_t R, int32_t C)
+        -> std::decay_t<decltype(Scaled(R, C))>
+    {
+        const auto Key = Scaled(R, C);
+        const bool bEdge = (R > 0 && Scaled(R - 1, C) != Key)
+            || (R < Rows - 1 && Scaled(R + 1, C) != Key)
+            || (C > 0 && Scaled(R, C - 1) != Key)
+            || (C < Cols - 1 && Scaled(R, C + 1) != Key);
+        if (!bEdge)
+        {
+            return Key;
+        }
+
+        const FCellOffset Offset = ZoomOffset(StageSeed, R, C);
+        return Scaled(ClampIndex(R + Offset.R, 0, Rows - 1), ClampIndex(C + Offset.C, 0, Cols - 1));
+    }
+
+    // Doubles the board, jittering the edges with ZoomCell
+    FBiomeBoard Zoom(const FBiomeBoard& Board, uint32_t StageSeed);
+
+    // Sets the border cells of Board to Ocean
+    void SurroundWithOcean(FBiomeBoard& Board);
+
+    // 4 x 4 ocean with each cell turned to land at odds of one in ten
+    template <typename RandomType>
+    FBiomeBoard Island(RandomType& Random)
+    {
+        const float ProbLand = 0.1f;
+        FBiomeBoard Board(4, 4, ECell::Ocean);
+        for (int32_t R = 0; R < 4; ++R)
+        {
+            for (int32_t C = 0; C < 4; ++C)
+            {
+                if (Random.FRand() <= ProbLand)
+                {
+                    Board(R, C) = ECell::Land;
+                }
+            }
+        }
+        return Board;
+    }
+
+    // Edge cells become Land at odds of ProbabilityOfLand, and Ocean otherwise
+    template <typename RandomType>
+    FBiomeBoard AddIsland(const FBiomeBoard& Board, float ProbabilityOfLand, RandomType& Random)
+    {
+        FBiomeBoard NextBoard = Board;
+        TGrid<uint8_t> EdgeMask;
+        ComputeEdgeMask(Board, EdgeMask);
+
+        for (int32_t R = 0; R < Board.Rows; ++R)
+        {
+            for (int32_t C = 0; C < Board.Cols; ++C)
+            {
+                if (EdgeMask(R, C) && CanTransform(Board(R, C)))
+                {
+                    NextBoard(R, C) = Random.FRand() < ProbabilityOfLand ? ECell::Land : ECell::Ocean;
+                }
+            }
+        }
+        return NextBoard;
+    }
+
+    // Edge cells take the most common non-ocean 4-neighbour at odds of ProbabilityOfLand. Ties go to the
+    // neighbour seen first, in the order up, down, left, right.
+    template <typename RandomType>
+    FBiomeBoard AddIsland2(const FBiomeBoard& Board, float ProbabilityOfLand, RandomType& Random)
+    {
+        static constexpr int32_t OffsetRows[4] = { -1, 1, 0, 0 };
+        static constexpr int32_t OffsetCols[4] = { 0, 0, -1, 1 };
+
+        FBiomeBoard NextBoard = Board;
+        TGrid<uint8_t> EdgeMask;
+        ComputeEdgeMask(Board, EdgeMask);
+
+        for (int32_t R = 0; R < Board.Rows; ++R)
+        {
+            for (int32_t C = 0; C < Board.Cols; ++C)
+            {
+                if (!EdgeMask(R, C) || !CanTransform(Board(R, C)))
+                {
+                    continue;
+                }
+
+                ECell Values[4];
+                int32_t Counts[4];
+                int32_t NumValues = 0;
+                for (int32_t K = 0; K < 4; ++K)
+                {
+                    const int32_t NR = R + OffsetRows[K];
+                    const int32_t NC = C + OffsetCols[K];
+                    if (!Board.IsInside(NR, NC) || Board(NR, NC) == ECell::Ocean)
+                    {
+                        continue;
+                    }
+                    int32_t Index = 0;
+                    while (Index < NumValues && Values[Index] != Board(NR, NC))
+                    {
+                        ++Index;
+                    }
+                    if (Index == NumValues)
+                    {
+                        Values[NumValues] = Board(NR, NC);
+                        Counts[NumValues++] = 0;
+                    }
+                    ++Counts[Index];
+                }
+
+                ECell MajorityType = ECell::Ocean;
+                int32_t MaxCount = 0;
+                for (int32_t Index = 0; Index < NumValues; ++Index)
+                {
+                    if (Counts[Index] > MaxCount)
+                    {
+                        MajorityType = Values[Index];
+                        MaxCount = Counts[Index];
+                    }
+                }
+
+                if (MajorityType != ECell::Ocean && Random.FRand() <= ProbabilityOfLand)
+                {
+                    NextBoard(R, C) = MajorityType;
+                }
+            }
+        }
+        return NextBoard;
+    }
+
+    // Doubles the board, then sweeps it row-major copying a random neighbour into each edge cell
+    template <typename RandomType>
+    FBiomeBoard FuzzyZoom(const FBiomeBoard& Board, RandomType& Random)
+    {
+        const int32_t Rows = Board.Rows * 2;
+        const int32_t Cols = Board.Cols * 2;
+        FBiomeBoard Scaled(Rows, Cols);
+        for (int32_t R = 0; R < Rows; ++R)
+        {
+            for (int32_t C = 0; C < Cols; ++C)
+            {
+                Scaled(R, C) = Board(R / 2, C / 2);
+            }
+        }
+
+        TGrid<uint8_t> EdgeMask;
+        ComputeEdgeMask(Scaled, EdgeMask);
+
+        for (int32_t R = 0; R < Rows; ++R)
+        {
+            for (int32_t C = 0; C < Cols; ++C)
+            {
+                if (!EdgeMask(R, C))
+                {
+                    continue;
+                }
+
+                // Offsets are uniform over -1, 0 and 1 on each axis
+                const int32_t OffsetR = Random.RandRange(-1, 1);
+                const int32_t OffsetC = Random.RandRange(-1, 1);
+                const int32_t SourceR = ClampIndex(R + OffsetR, 0, Rows - 1);
+                const int32_t SourceC = ClampIndex(C + OffsetC, 0, Cols - 1);
+                if (Scaled(SourceR, SourceC) != Scaled(R, C))
+                {
+                    Scaled(R, C) = Scaled(SourceR, SourceC);
+                    RefreshEdgeMask(Scaled, EdgeMask, R, C);
+                }
+            }
+        }
+        return Scaled;
+    }
+
+    // Ocean cells with no land 4-neighbour become Land at odds of 0.35
+    template <typename RandomType>
+    FBiomeBoard RemoveTooMuchOcean(const FBiomeBoard& Board, RandomType& Random)
+    {
+        const float ProbLand = 0.35f;
+        FBiomeBoard NextBoard = Board;
+        for (int32_t R = 0; R < Board.Rows; ++R)
+        {
+            for (int32_t C = 0; C < Board.Cols; ++C)
+            {
+                if (Board(R, C) == ECell::Ocean && IsSurroundedByOcean(Board, R, C) && Random.FRand() < ProbLand)
+                {
+                    NextBoard(R, C) = ECell::Land;
+                }
+            }
+        }
+        return NextBoard;
+    }
+
+    // Land becomes Warm, Cold or Freezing at odds of 4:1:1; Ocean is kept
+    template <typename RandomType>
+    ECell AddTempsCell(ECell Cell, RandomType& Random)
+    {
+        if (Cell == ECell::Ocean)
+        {
+            return Cell;
+        }
+
+        const int32_t Temp = Random.RandRange(1, 6);
+        if (Temp <= 4)
+        {
+            return ECell::Warm;
+        }
+        return Temp == 5 ? ECell::Cold : ECell::Freezing;
+    }
+
+    // One of Biomes, picked with the matching entry of Odds; the last when the odds sum to less than the roll
+    template <typename RandomType, int32_t NumBiomes>
+    ECell SelectBiome(const ECell (&Biomes)[NumBiomes], const float (&Odds)[NumBiomes], RandomType& Random)
+    {
+        const float Roll = Random.FRand();
+        float Cumulative = 0.0f;
+        for (int32_t Index = 0; Index < NumBiomes; ++Index)
+        {
+            Cumulative += Odds[Index];
+            if (Roll < Cumulative)
+            {
+                return Biomes[Index];
+            }
+        }
+        return Biomes[NumBiomes - 1];
+    }
+
+    // Temperature cells become a biome of their climate; other cells are kept
+    template <typename RandomType>
+    ECell TemperatureToBiomeCell(ECell Cell, RandomType& Random)
+    {
+        if (Cell == ECell::Warm)
+        {
+            static constexpr ECell Biomes[] = { ECell::Desert, ECell::Plains, ECell::Rainforest, ECell::Savannah, ECell::Swamp, ECell::Steppe, ECell::Mesa, ECell::Grassland };
+            static constexpr float Odds[] = { 0.2f, 0.3f, 0.05f, 0.15f, 0.02f, 0.1f, 0.05f, 0.13f };
+            return SelectBiome(Biomes, Odds, Random);
+        }
+        if (Cell == ECell::Temperate)
+        {
+            static constexpr ECell Biomes[] = { ECell::Woodland, ECell::Forest, ECell::Highland, ECell::Marsh };
+            static constexpr float Odds[] = { 0.2f, 0.5f, 0.2f, 0.1f };
+            return SelectBiome(Biomes, Odds, Random);
+        }
+        if (Cell == ECell::Cold)
+        {
+            static constexpr ECell Biomes[] = { ECell::Taiga, ECell::SnowyForest, ECell::Highland, ECell::Volcanic };
+            static constexpr float Odds[] = { 0.4f, 0.3f, 0.25f, 0.05f };
+            return SelectBiome(Biomes, Odds, Random);
+        }
+        if (Cell == ECell::Freezing)
+        {
+            static constexpr ECell Biomes[] = { ECell::Tundra, ECell::IcePlains, ECell::Ice, ECell::SnowyForest };
+            static constexpr float Odds[] = { 0.4f, 0.3f, 0.15f, 0.1f };
+            return SelectBiome(Biomes, Odds, Random);
+        }
+        return Cell;
+    }
+
+    // Applies CellFunc(Cell, Random) to every cell in row-major order
+    template <typename RandomType, typename CellFuncType>
+    FBiomeBoard MapCells(const FBiomeBoard& Board, RandomType& Random, CellFuncType&& CellFunc)
+    {
+        FBiomeBoard NextBoard(Board.Rows, Board.Cols);
+        for (int64_t Index = 0; Index < Board.Num(); ++Index)
+        {
+            NextBoard.Cells[size_t(Index)] = CellFunc(Board.Cells[size_t(Index)], Random);
+        }
+        return NextBoard;
+    }
+
+    template <typename RandomType>
+    FBiomeBoard AddTemps(const FBiomeBoard& Board, RandomType& Random)
+    {
+        return MapCells(Board, Random, [](ECell Cell, RandomType& CellRandom) { return AddTempsCell(Cell, CellRandom); });
+    }
+
+    template <typename RandomType>
+    FBiomeBoard TemperatureToBiome(const FBiomeBoard& Board, RandomType& Random)
+    {
+        return MapCells(Board, Random, [](ECell Cell, RandomType& CellRandom) { return TemperatureToBiomeCell(Cell, CellRandom); });
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+
+namespace GenerationCore
+{
+    // Cell values of the biome automaton, in the same order as ADiamondSquare::ECell
+    enum class ECell : uint8_t
+    {
+        Land,
+        Ocean,
+        Warm,
+        Cold,
+        Freezing,
+        Temperate,
+        // Biome types
+        DeepOcean,
+        Desert,
+        SandDunes,
+        Plains,
+        Grassland,
+        Rainforest,
+        Savannah,
+        Swamp,
+        Marsh,
+        Woodland,
+        Forest,
+        Highland,
+        Taiga,
+        SnowyForest,
+        Tundra,
+        IcePlains,
+        Mountain,
+        Volcanic,
+        Beach,
+        River,
+        SwampShore,
+        Ice,
+        ColdBeach,
+        Oasis,
+        Steppe,
+        Mesa
+    };
+
+    constexpr int32_t NumCells = int32_t(ECell::Mesa) + 1;
+
+    // Set of cell values stored as a bitmask
+    struct FCellSet
+    {
+        uint64_t Bits = 0;
+
+        constexpr FCellSet() = default;
+
+        constexpr FCellSet(std::initializer_list<ECell> Cells)
+        {
+            for (ECell Cell : Cells)
+            {
+                Bits |= uint64_t(1) << uint64_t(Cell);
+            }
+        }
+
+        constexpr bool Contains(ECell Cell) const
+        {
+            return (Bits >> uint64_t(Cell)) & 1;
+        }
+    };
+
+    constexpr FCellSet TemperatureCells = { ECell::Warm, ECell::Temperate, ECell::Cold, ECell::Freezing };
+}
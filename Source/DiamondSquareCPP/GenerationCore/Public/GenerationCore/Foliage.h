@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+namespace GenerationCore
+{
+    // Scatters foliage over cells [StartX, EndX) x [StartY, EndY), visited row-major. Each cell with a positive
+    // DensityAt(X, Y) gets an instance at odds of that density, and OnInstance(X, Y, Yaw) is called with a yaw in
+    // [0, 360). Random draws happen in the same order for the same inputs, so a seeded generator reproduces the
+    // same layout.
+    template <typename RandomType, typename DensityType, typename InstanceType>
+    int32_t ScatterFoliage(int32_t StartX, int32_t EndX, int32_t StartY, int32_t EndY, DensityType&& DensityAt, RandomType& Random, InstanceType&& OnInstance)
+    {
+        int32_t NumInstances = 0;
+        for (int32_t X = StartX; X < EndX; ++X)
+        {
+            for (int32_t Y = StartY; Y < EndY; ++Y)
+            {
+                const float Density = DensityAt(X, Y);
+                if (Density <= 0.0f || Random.FRand() >= Density)
+                {
+                    continue;
+                }
+
+                OnInstance(X, Y, Random.FRandRange(0.0f, 360.0f));
+                ++NumInstances;
+            }
+        }
+        return NumInstances;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace GenerationCore
+{
+    // Rows x Cols values stored row-major. As in the engine module, X is the row and Y the column.
+    template <typename T>
+    struct TGrid
+    {
+        int32_t Rows = 0;
+        int32_t Cols = 0;
+        std::vector<T> Cells;
+
+        TGrid() = default;
+
+        TGrid(int32_t InRows, int32_t InCols, const T& Value = T())
+        {
+            Init(InRows, InCols, Value);
+        }
+
+        void Init(int32_t InRows, int32_t InCols, const T& Value = T())
+        {
+            Rows = InRows;
+            Cols = InCols;
+            Cells.assign(size_t(InRows) * size_t(InCols), Value);
+        }
+
+        int64_t Num() const
+        {
+            return int64_t(Rows) * Cols;
+        }
+
+        bool IsInside(int32_t R, int32_t C) const
+        {
+            return R >= 0 && R < Rows && C >= 0 && C < Cols;
+        }
+
+        T& operator()(int32_t R, int32_t C)
+        {
+            return Cells[size_t(R) * size_t(Cols) + size_t(C)];
+        }
+
+        const T& operator()(int32_t R, int32_t C) const
+        {
+            return Cells[size_t(R) * size_t(Cols) + size_t(C)];
+        }
+
+        T* Row(int32_t R)
+        {
+            return Cells.data() + size_t(R) * size_t(Cols);
+        }
+
+        const T* Row(int32_t R) const
+        {
+            return Cells.data() + size_t(R) * size_t(Cols);
+        }
+    };
+
+    inline int32_t ClampIndex(int32_t Value, int32_t Min, int32_t Max)
+    {
+        return Value < Min ? Min : (Value > Max ? Max : Value);
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "GenerationCore/Grid.h"
+
+namespace GenerationCore
+{
+    struct FGridMeshSettings
+    {
+        // Distance between neighbouring vertices
+        float Scale = 500.0f;
+        float UVScale = 0.0f;
+        float ZMultiplier = 8.0f;
+        float ZExpo = 2.1f;
+    };
+
+    // Height of a vertex with noise value Noise
+    inline float GetVertexHeight(const FGridMeshSettings& Settings, float Noise)
+    {
+        return std::pow(Noise * Settings.ZMultiplier, Settings.ZExpo) * Settings.Scale;
+    }
+
+    // Indices BuildGridTriangles writes at most for a Rows x Cols vertex grid
+    inline int64_t GetMaxGridTriangleIndices(int32_t Rows, int32_t Cols)
+    {
+        return Rows > 1 && Cols > 1 ? int64_t(Rows - 1) * (Cols - 1) * 6 : 0;
+    }
+
+    // Writes two clockwise triangles for each quad of a Rows x Cols row-major vertex grid into OutIndices, which
+    // holds GetMaxGridTriangleIndices. Quads whose four corners all have a SkipMask of 1 or more are left out;
+    // SkipMask may be null. Returns the number of indices written.
+    int64_t BuildGridTriangles(int32_t Rows, int32_t Cols, const float* SkipMask, int32_t* OutIndices);
+
+    // Writes the position (X, Y, Z) and UV of the vertices in rows [FirstRow, EndRow) of Noise into OutPositions
+    // (3 floats per vertex) and OutUVs (2 floats per vertex, may be null), both indexed over the whole grid
+    // row-major. Rows are independent, so callers can split a grid across threads by row range.
+    void BuildGridVertices(const TGrid<float>& Noise, const FGridMeshSettings& Settings, int32_t FirstRow, int32_t EndRow, float* OutPositions, float* OutUVs);
+
+    inline void BuildGridVertices(const TGrid<float>& Noise, const FGridMeshSettings& Settings, float* OutPositions, float* OutUVs)
+    {
+        BuildGridVertices(Noise, Settings, 0, Noise.Rows, OutPositions, OutUVs);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include "GenerationCore/Grid.h"
+
+namespace GenerationCore
+{
+    // Improved Perlin noise (gradient noise with a quintic fade) in about [-1, 1], repeating every 256 units
+    float PerlinNoise2D(float X, float Y);
+
+    struct FPerlinNoise
+    {
+        float operator()(float X, float Y) const
+        {
+            return PerlinNoise2D(X, Y);
+        }
+    };
+
+    struct FFractalNoiseSettings
+    {
+        int32_t Octaves = 12;
+        float Scale = 500.0f;
+        float Persistence = 0.7f;
+        float Lacunarity = 7.0f;
+    };
+
+    // Sum of Octaves layers of Noise(X, Y) at grid vertex (X, Y), each Lacunarity times the frequency and
+    // Persistence times the amplitude of the one before. Noise is any callable taking two floats.
+    template <typename NoiseType>
+    inline float FractalNoise(const FFractalNoiseSettings& Settings, int32_t X, int32_t Y, const NoiseType& Noise)
+    {
+        float Amplitude = 1.0f;
+        float Frequency = 1.0f;
+        float NoiseHeight = 0.0f;
+        for (int32_t Octave = 0; Octave < Settings.Octaves; ++Octave)
+        {
+            const float SampleX = X / Settings.Scale * Frequency;
+            const float SampleY = Y / Settings.Scale * Frequency;
+            NoiseHeight += Noise(SampleX, SampleY) * Amplitude;
+            Amplitude *= Settings.Persistence;
+            Frequency *= Settings.Lacunarity;
+        }
+        return NoiseHeight;
+    }
+
+    // Fills rows [FirstRow, EndRow) of Out with FractalNoise. Rows are independent, so callers can split a grid
+    // across threads by row range.
+    template <typename NoiseType>
+    void FillFractalNoise(const FFractalNoiseSettings& Settings, TGrid<float>& Out, int32_t FirstRow, int32_t EndRow, const NoiseType& Noise)
+    {
+        for (int32_t X = FirstRow; X < EndRow; ++X)
+        {
+            float* Row = Out.Row(X);
+            for (int32_t Y = 0; Y < Out.Cols; ++Y)
+            {
+                Row[Y] = FractalNoise(Settings, X, Y, Noise);
+            }
+        }
+    }
+
+    inline void FillFractalNoise(const FFractalNoiseSettings& Settings, TGrid<float>& Out)
+    {
+        FillFractalNoise(Settings, Out, 0, Out.Rows, FPerlinNoise());
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace GenerationCore
+{
+    // Linear congruential generator with the interface and sequence of FRandomStream. The stages take their
+    // generator as a template parameter, so the engine passes its FRandomStream and standalone builds use this.
+    class FRandom
+    {
+    public:
+        FRandom() = default;
+
+        explicit FRandom(int32_t InSeed)
+        {
+            Initialize(InSeed);
+        }
+
+        void Initialize(int32_t InSeed)
+        {
+            InitialSeed = InSeed;
+            Seed = uint32_t(InSeed);
+        }
+
+        void Reset()
+        {
+            Seed = uint32_t(InitialSeed);
+        }
+
+        int32_t GetInitialSeed() const { return InitialSeed; }
+        int32_t GetCurrentSeed() const { return int32_t(Seed); }
+
+        // Uniform in [0, 1), built from the top 23 bits of the state
+        float GetFraction()
+        {
+            MutateSeed();
+            const uint32_t Bits = 0x3F800000u | (Seed >> 9);
+            float Result;
+            std::memcpy(&Result, &Bits, sizeof(Result));
+            return Result - 1.0f;
+        }
+
+        float FRand()
+        {
+            return GetFraction();
+        }
+
+        uint32_t GetUnsignedInt()
+        {
+            MutateSeed();
+            return Seed;
+        }
+
+        // Uniform in [0, A), or 0 when A is not positive
+        int32_t RandHelper(int32_t A)
+        {
+            return A > 0 ? int32_t(GetFraction() * float(A)) : 0;
+        }
+
+        // Uniform in [Min, Max], both inclusive
+        int32_t RandRange(int32_t Min, int32_t Max)
+        {
+            const int32_t Range = (Max - Min) + 1;
+            return Min + RandHelper(Range);
+        }
+
+        float FRandRange(float Min, float Max)
+        {
+            return Min + (Max - Min) * FRand();
+        }
+
+    private:
+        void MutateSeed()
+        {
+            Seed = (Seed * 196314165u) + 907633515u;
+        }
+
+        int32_t InitialSeed = 0;
+        uint32_t Seed = 0;
+    };
+}
@@ -0,0 +1,101 @@
+#include "BiomeBitboard.h"
+
+
+void FBiomeBitboard::Init(int32 InRows, int32 InCols)
+{
+    Rows = InRows;
+    Cols = InCols;
+    WordsPerRow = FMath::DivideAndRoundUp(InCols, 64);
+    Words.Init(0, Rows * WordsPerRow);
+}
+
+
+uint64 FBiomeBitboard::ValidMask(int32 WordIndex) const
+{
+    const int32 BitsInWord = FMath::Min(Cols - (WordIndex << 6), 64);
+    return BitsInWord >= 64 ? ~uint64(0) : ((uint64(1) << BitsInWord) - 1);
+}
+
+
+uint64 FBiomeBitboard::LeftNeighbours(int32 R, int32 WordIndex) const
+{
+    const uint64* RowWords = Row(R);
+    const uint64 Word = RowWords[WordIndex];
+
+    // Column 0 has no left neighbour and takes its own value instead
+    const uint64 Carry = WordIndex > 0 ? (RowWords[WordIndex - 1] >> 63) : (Word & 1);
+    return (Word << 1) | Carry;
+}
+
+
+uint64 FBiomeBitboard::RightNeighbours(int32 R, int32 WordIndex) const
+{
+    const uint64* RowWords = Row(R);
+    const uint64 Word = RowWords[WordIndex];
+
+    uint64 Right = Word >> 1;
+    if (WordIndex + 1 < WordsPerRow)
+    {
+        Right |= RowWords[WordIndex + 1] << 63;
+    }
+    else
+    {
+        // The last column has no right neighbour and takes its own value instead
+        const uint64 LastBit = uint64(1) << ((Cols - 1) & 63);
+        Right = (Right & ~LastBit) | (Word & LastBit);
+    }
+    return Right;
+}
+
+
+uint64 FBiomeBitboard::EdgeWord(int32 R, int32 WordIndex) const
+{
+    const uint64 Cur = Row(R)[WordIndex];
+    const uint64 Up = R > 0 ? Row(R - 1)[WordIndex] : Cur;
+    const uint64 Down = R < Rows - 1 ? Row(R + 1)[WordIndex] : Cur;
+
+    const uint64 Differs = (Cur ^ Up) | (Cur ^ Down) | (Cur ^ LeftNeighbours(R, WordIndex)) | (Cur ^ RightNeighbours(R, WordIndex));
+    return Differs & ValidMask(WordIndex);
+}
+
+
+uint64 FBiomeBitboard::SurroundedByOceanWord(int32 R, int32 WordIndex) const
+{
+    // Missing neighbours stand in as the cell itself, which is Ocean whenever the result matters
+    const uint64 Cur = Row(R)[WordIndex];
+    const uint64 Up = R > 0 ? Row(R - 1)[WordIndex] : Cur;
+    const uint64 Down = R < Rows - 1 ? Row(R + 1)[WordIndex] : Cur;
+
+    const uint64 AnyLand = Cur | Up | Down | LeftNeighbours(R, WordIndex) | RightNeighbours(R, WordIndex);
+    return ~AnyLand & ValidMask(WordIndex);
+}
+
+
+FBiomeBitboard FBiomeBitboard::Upscale2x() const
+{
+    FBiomeBitboard Scaled;
+    Scaled.Init(Rows * 2, Cols * 2);
+
+    for (int32 R = 0; R < Rows; ++R)
+    {
+        const uint64* Source = Row(R);
+        uint64* Top = Scaled.Row(R * 2);
+        uint64* Bottom = Scaled.Row(R * 2 + 1);
+
+        for (int32 WordIndex = 0; WordIndex < Scaled.WordsPerRow; ++WordIndex)
+        {
+            // Each output word covers half an input word; spread every bit over two neighbouring bits
+            uint64 Half = (Source[WordIndex >> 1] >> ((WordIndex & 1) * 32)) & 0xFFFFFFFFull;
+            Half = (Half | (Half << 16)) & 0x0000FFFF0000FFFFull;
+            Half = (Half | (Half << 8)) & 0x00FF00FF00FF00FFull;
+            Half = (Half | (Half << 4)) & 0x0F0F0F0F0F0F0F0Full;
+            Half = (Half | (Half << 2)) & 0x3333333333333333ull;
+            Half = (Half | (Half << 1)) & 0x5555555555555555ull;
+
+            Top[WordIndex] = Half | (Half << 1);
+            Bottom[WordIndex] = Top[WordIndex];
+        }
+    }
+
+    return Scaled;
+}
@@ -0,0 +1,130 @@
+#include "BiomeDistance.h"
+#include "Async/ParallelFor.h"
+
+
+void FBiomeDistance::Transform1D(const float* F, int32 N, float* D, int32* V, float* Z)
+{
+    // Cells without a feature add no parabola; they only receive distances
+    int32 K = -1;
+    for (int32 Q = 0; Q < N; ++Q)
+    {
+        if (F[Q] >= NoFeature)
+        {
+            continue;
+        }
+        if (K < 0)
+        {
+            K = 0;
+            V[0] = Q;
+            Z[0] = -NoFeature;
+            Z[1] = NoFeature;
+            continue;
+        }
+
+        float S;
+        while (true)
+        {
+            const int32 P = V[K];
+            S = ((F[Q] + float(Q) * Q) - (F[P] + float(P) * P)) / (2.0f * (Q - P));
+            if (S > Z[K])
+            {
+                break;
+            }
+            --K;
+        }
+        ++K;
+        V[K] = Q;
+        Z[K] = S;
+        Z[K + 1] = NoFeature;
+    }
+
+    if (K < 0)
+    {
+        for (int32 Q = 0; Q < N; ++Q)
+        {
+            D[Q] = NoFeature;
+        }
+        return;
+    }
+
+    K = 0;
+    for (int32 Q = 0; Q < N; ++Q)
+    {
+        while (Z[K + 1] < Q)
+        {
+            ++K;
+        }
+        const float Offset = float(Q - V[K]);
+        D[Q] = Offset * Offset + F[V[K]];
+    }
+}
+
+
+TArray<float> FBiomeDistance::SquaredDistance(const TArray<uint8>& Features, int32 Rows, int32 Cols, bool bBorderIsFeature)
+{
+    TArray<float> Distances;
+    Distances.SetNumUninitialized(Rows * Cols);
+    if (Rows == 0 || Cols == 0)
+    {
+        return Distances;
+    }
+
+    // Lines are split into a few batches per worker so each batch reuses one set of scratch buffers
+    const int32 MaxLength = FMath::Max(Rows, Cols);
+    auto ForEachLine = [MaxLength](int32 NumLines, auto&& TransformLine)
+        {
+            const int32 LinesPerBatch = 32;
+            ParallelFor(FMath::DivideAndRoundUp(NumLines, LinesPerBatch), [&](int32 Batch)
+                {
+                    TArray<float> In;
+                    TArray<float> Out;
+                    TArray<int32> V;
+                    TArray<float> Z;
+                    In.SetNumUninitialized(MaxLength);
+                    Out.SetNumUninitialized(MaxLength);
+                    V.SetNumUninitialized(MaxLength);
+                    Z.SetNumUninitialized(MaxLength + 1);
+
+                    const int32 End = FMath::Min((Batch + 1) * LinesPerBatch, NumLines);
+                    for (int32 Line = Batch * LinesPerBatch; Line < End; ++Line)
+                    {
+                        TransformLine(Line, In.GetData(), Out.GetData(), V.GetData(), Z.GetData());
+                    }
+                });
+        };
+
+    // Down each column: distance to the nearest feature in the same column
+    ForEachLine(Cols, [&](int32 C, float* In, float* Out, int32* V, float* Z)
+        {
+            for (int32 R = 0; R < Rows; ++R)
+            {
+                In[R] = Features[R * Cols + C] ? 0.0f : NoFeature;
+            }
+            Transform1D(In, Rows, Out, V, Z);
+            for (int32 R = 0; R < Rows; ++R)
+            {
+                Distances[R * Cols + C] = Out[R];
+            }
+        });
+
+    // Along each row, over the column results: the exact 2D distance
+    ForEachLine(Rows, [&](int32 R, float* In, float* Out, int32* V, float* Z)
+        {
+            float* Row = Distances.GetData() + R * Cols;
+            FMemory::Memcpy(In, Row, Cols * sizeof(float));
+            Transform1D(In, Cols, Row, V, Z);
+
+            // The ring outside the grid is a full line on every side, so its nearest cell is straight across
+            if (bBorderIsFeature)
+            {
+                const int32 RowEdge = FMath::Min(R + 1, Rows - R);
+                for (int32 C = 0; C < Cols; ++C)
+                {
+                    const float Edge = float(FMath::Min(RowEdge, FMath::Min(C + 1, Cols - C)));
+                    Row[C] = FMath::Min(Row[C], Edge * Edge);
+                }
+            }
+        });
+
+    return Distances;
+}
@@ -0,0 +1,237 @@
+#include "BiomePipeline.h"
+
+
+#if WITH_EDITOR
+EDataValidationResult UBiomePipeline::IsDataValid(TArray<FText>& ValidationErrors)
+{
+    EDataValidationResult Result = Super::IsDataValid(ValidationErrors);
+
+    FBiomePipelinePlan Plan;
+    FString Error;
+    if (!FBiomePipelinePlanner::Plan(Stages, true, Plan, Error))
+    {
+        ValidationErrors.Add(FText::FromString(Error));
+        Result = EDataValidationResult::Invalid;
+    }
+    return Result;
+}
+#endif
+
+
+bool FBiomeCellRule::IsInvariantUnder(const FBiomeCellRule& Earlier) const
+{
+    // Earlier moves cells from its Source to its Target; membership of Neighbours survives that only when
+    // the whole Source sits on the same side of Neighbours as the Target
+    if (Neighbours.Contains(Earlier.Target))
+    {
+        return (Earlier.Source.Bits & ~Neighbours.Bits) == 0;
+    }
+    return (Earlier.Source.Bits & Neighbours.Bits) == 0;
+}
+
+
+TArray<FBiomeStageDesc> FBiomePipelinePlanner::GetDefaultStages(bool bSurroundWithOcean)
+{
+    TArray<EBiomeStage> Order = {
+        EBiomeStage::Island,
+        EBiomeStage::FuzzyZoom,
+        EBiomeStage::AddIsland,
+        EBiomeStage::Zoom,
+        EBiomeStage::AddIsland,
+        EBiomeStage::AddIsland,
+        EBiomeStage::AddIsland,
+        EBiomeStage::RemoveTooMuchOcean,
+        EBiomeStage::AddTemps,
+        EBiomeStage::AddIsland2,
+        EBiomeStage::WarmToTemperate,
+        EBiomeStage::FreezingToCold,
+        EBiomeStage::Zoom,
+        EBiomeStage::AddIsland2,
+        EBiomeStage::SurroundWithOcean,
+        EBiomeStage::Zoom,
+        EBiomeStage::TemperatureToBiome,
+        EBiomeStage::DeepOcean,
+        EBiomeStage::Zoom,
+        EBiomeStage::Zoom,
+        EBiomeStage::Zoom,
+        EBiomeStage::Zoom,
+        EBiomeStage::Shore,
+        EBiomeStage::Zoom
+    };
+
+    TArray<FBiomeStageDesc> Stages;
+    Stages.Reserve(Order.Num());
+    for (EBiomeStage Stage : Order)
+    {
+        FBiomeStageDesc& Desc = Stages.AddDefaulted_GetRef();
+        Desc.Stage = Stage;
+        Desc.bEnabled = Stage != EBiomeStage::SurroundWithOcean || bSurroundWithOcean;
+    }
+    return Stages;
+}
+
+
+bool FBiomePipelinePlanner::IsBitboardStage(EBiomeStage Stage)
+{
+    return Stage == EBiomeStage::Island
+        || Stage == EBiomeStage::FuzzyZoom
+        || Stage == EBiomeStage::AddIsland
+        || Stage == EBiomeStage::Zoom
+        || Stage == EBiomeStage::RemoveTooMuchOcean;
+}
+
+
+bool FBiomePipelinePlanner::IsTileStage(EBiomeStage Stage)
+{
+    return Stage == EBiomeStage::Zoom || Stage == EBiomeStage::Shore;
+}
+
+
+bool FBiomePipelinePlanner::IsPointStage(EBiomeStage Stage)
+{
+    return Stage == EBiomeStage::AddTemps || Stage == EBiomeStage::TemperatureToBiome;
+}
+
+
+const FBiomeCellRule* FBiomePipelinePlanner::GetCellRule(EBiomeStage Stage)
+{
+    using ECell = ADiamondSquare::ECell;
+
+    // Warm cells next to Cold or Freezing become Temperate
+    static constexpr FBiomeCellRule WarmToTemperate = { { ECell::Warm }, ADiamondSquare::CoolerCells, ECell::Temperate, false };
+    // Freezing cells next to Warm or Temperate become Cold
+    static constexpr FBiomeCellRule FreezingToCold = { { ECell::Freezing }, ADiamondSquare::WarmerCells, ECell::Cold, false };
+    // Ocean surrounded by ocean on all eight sides becomes DeepOcean; cells on the border never qualify
+    static constexpr FBiomeCellRule DeepOcean = { ADiamondSquare::OceanCells, ADiamondSquare::OceanCells, ECell::DeepOcean, true };
+
+    switch (Stage)
+    {
+    case EBiomeStage::WarmToTemperate:
+        return &WarmToTemperate;
+    case EBiomeStage::FreezingToCold:
+        return &FreezingToCold;
+    case EBiomeStage::DeepOcean:
+        return &DeepOcean;
+    default:
+        return nullptr;
+    }
+}
+
+
+bool FBiomePipelinePlanner::IsStencilRadius(float Radius)
+{
+    // Lattice distances run 1, sqrt(2), 2, ...; a radius between sqrt(2) and 2 admits exactly the 3x3 block
+    return Radius >= FMath::Sqrt(2.0f) - KINDA_SMALL_NUMBER && Radius < 2.0f;
+}
+
+
+bool FBiomePipelinePlanner::IsStencilStage(const FBiomeStageDesc& Desc)
+{
+    if (Desc.Stage != EBiomeStage::DeepOcean && Desc.Stage != EBiomeStage::Shore)
+    {
+        return true;
+    }
+    return Desc.Radius < 0.0f || IsStencilRadius(Desc.Radius);
+}
+
+
+bool FBiomePipelinePlanner::Plan(const TArray<FBiomeStageDesc>& Stages, bool bTiled, FBiomePipelinePlan& OutPlan, FString& OutError)
+{
+    OutPlan = FBiomePipelinePlan();
+
+    TArray<FBiomeStageDesc> Enabled = Stages.FilterByPredicate([](const FBiomeStageDesc& Desc) { return Desc.bEnabled; });
+    if (Enabled.Num() == 0)
+    {
+        OutError = TEXT("The pipeline has no enabled stages");
+        return false;
+    }
+    if (Enabled[0].Stage != EBiomeStage::Island)
+    {
+        OutError = TEXT("The first enabled stage must be Island");
+        return false;
+    }
+
+    int32 Size = IslandSize;
+    for (int32 Index = 1; Index < Enabled.Num(); ++Index)
+    {
+        const EBiomeStage Stage = Enabled[Index].Stage;
+        if (Stage == EBiomeStage::Island)
+        {
+            OutError = FString::Printf(TEXT("Enabled stage %d is Island, which can only come first"), Index);
+            return false;
+        }
+        if (Stage == EBiomeStage::Zoom || Stage == EBiomeStage::FuzzyZoom)
+        {
+            Size *= 2;
+            if (Size > MaxOutputSize)
+            {
+                OutError = FString::Printf(TEXT("Enabled stage %d zooms the board past %d x %d"), Index, MaxOutputSize, MaxOutputSize);
+                return false;
+            }
+        }
+    }
+    OutPlan.OutputSize = Size;
+    OutPlan.NumStages = Enabled.Num();
+
+    // Greedily group stages into steps. The board stays packed while only Land/Ocean stages have run.
+    bool bOnBitboard = true;
+    int32 Index = 0;
+    while (Index < Enabled.Num())
+    {
+        FBiomePlanStep& Step = OutPlan.Steps.AddDefaulted_GetRef();
+        const EBiomeStage Stage = Enabled[Index].Stage;
+
+        if (bOnBitboard && IsBitboardStage(Stage))
+        {
+            Step.Kind = EBiomePlanStepKind::Bitboard;
+            while (Index < Enabled.Num() && IsBitboardStage(Enabled[Index].Stage))
+            {
+                Step.Stages.Add(Enabled[Index++]);
+            }
+            OutPlan.NumPasses += Step.Stages.Num();
+            continue;
+        }
+        bOnBitboard = false;
+
+        if (bTiled && IsTileStage(Stage) && IsStencilStage(Enabled[Index]))
+        {
+            Step.Kind = EBiomePlanStepKind::Tiled;
+            while (Index < Enabled.Num() && IsTileStage(Enabled[Index].Stage) && IsStencilStage(Enabled[Index]))
+            {
+                Step.Stages.Add(Enabled[Index++]);
+            }
+        }
+        else if (IsPointStage(Stage) || (GetCellRule(Stage) && IsStencilStage(Enabled[Index])))
+        {
+            // A per-cell stage can lead, since its output is produced a row ahead of the rules reading it.
+            // Each rule after that must not care about the rewrites of the rules before it, because all of
+            // them read their neighbours from the leading stage's output.
+            Step.Kind = EBiomePlanStepKind::CellPass;
+            TArray<const FBiomeCellRule*, TInlineAllocator<8>> Rules;
+            if (const FBiomeCellRule* Rule = GetCellRule(Stage))
+            {
+                Rules.Add(Rule);
+            }
+            Step.Stages.Add(Enabled[Index++]);
+
+            while (Index < Enabled.Num())
+            {
+                const FBiomeCellRule* Rule = IsStencilStage(Enabled[Index]) ? GetCellRule(Enabled[Index].Stage) : nullptr;
+                if (!Rule || Rules.ContainsByPredicate([Rule](const FBiomeCellRule* Earlier) { return !Rule->IsInvariantUnder(*Earlier); }))
+                {
+                    break;
+                }
+                Rules.Add(Rule);
+                Step.Stages.Add(Enabled[Index++]);
+            }
+        }
+        else
+        {
+            Step.Kind = EBiomePlanStepKind::Stage;
+            Step.Stages.Add(Enabled[Index++]);
+        }
+        ++OutPlan.NumPasses;
+    }
+
+    return true;
+}
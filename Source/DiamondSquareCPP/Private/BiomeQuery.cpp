@@ -0,0 +1,65 @@
+#include "BiomeQuery.h"
+#include "Misc/ScopeLock.h"
+
+
+static FIntPoint GetFinalSize(const TArray<TArray<ADiamondSquare::ECell>>& Root, const TArray<FBiomeTileStage>& Stages)
+{
+    const FIntPoint RootSize(Root.Num(), Root.Num() > 0 ? Root[0].Num() : 0);
+    return FBiomeTiles::GetLevelSizes(RootSize, Stages).Last();
+}
+
+
+FBiomeQuery::FBiomeQuery(TArray<TArray<ECell>>&& InRoot, const TArray<FBiomeTileStage>& InStages, int32 InTileSize, int32 MaxCachedTiles)
+    : Root(MoveTemp(InRoot))
+    , Stages(InStages)
+    , Size(GetFinalSize(Root, Stages))
+    , TileSize(FMath::Max(InTileSize, 1))
+    , Tiles(FMath::Max(MaxCachedTiles, 1))
+{
+}
+
+
+bool FBiomeQuery::GetBiome(int32 X, int32 Y, ECell& OutBiome)
+{
+    if (X < 0 || Y < 0 || X >= Size.X || Y >= Size.Y)
+    {
+        return false;
+    }
+
+    if (Stages.Num() == 0)
+    {
+        OutBiome = Root[X][Y];
+        return true;
+    }
+
+    const FTilePtr Tile = FindOrMakeTile(FIntPoint(X / TileSize, Y / TileSize));
+    OutBiome = Tile->Get(X, Y);
+    return true;
+}
+
+
+FBiomeQuery::FTilePtr FBiomeQuery::FindOrMakeTile(const FIntPoint& TileCoord)
+{
+    {
+        FScopeLock Lock(&CacheLock);
+        if (const FTilePtr* Cached = Tiles.FindAndTouch(TileCoord))
+        {
+            return *Cached;
+        }
+    }
+
+    // Make the tile without holding the lock so other lookups are not held up. Threads that miss the same
+    // tile at once each make it, with identical results.
+    const FIntRect Rect(
+        TileCoord.X * TileSize,
+        TileCoord.Y * TileSize,
+        FMath::Min((TileCoord.X + 1) * TileSize, Size.X),
+        FMath::Min((TileCoord.Y + 1) * TileSize, Size.Y));
+
+    TSharedRef<FBiomeTile, ESPMode::ThreadSafe> Tile = MakeShared<FBiomeTile, ESPMode::ThreadSafe>();
+    FBiomeTiles::RunTile(Root, Stages, Rect, *Tile);
+
+    FScopeLock Lock(&CacheLock);
+    Tiles.Add(TileCoord, Tile);
+    return Tile;
+}
@@ -0,0 +1,213 @@
+#include "BiomeRegions.h"
+#include "Async/ParallelFor.h"
+
+
+// Root of Index, halving the path on the way
+static int32 FindRoot(TArray<int32>& Parents, int32 Index)
+{
+    while (Parents[Index] != Index)
+    {
+        Parents[Index] = Parents[Parents[Index]];
+        Index = Parents[Index];
+    }
+    return Index;
+}
+
+
+// Joins the sets of A and B under the smaller root, so every root ends up being its region's first cell
+static void Union(TArray<int32>& Parents, int32 A, int32 B)
+{
+    const int32 RootA = FindRoot(Parents, A);
+    const int32 RootB = FindRoot(Parents, B);
+    if (RootA < RootB)
+    {
+        Parents[RootB] = RootA;
+    }
+    else if (RootB < RootA)
+    {
+        Parents[RootA] = RootB;
+    }
+}
+
+
+FBiomeRegions FBiomeRegions::Label(const TArray<uint8>& Classes, int32 Rows, int32 Cols, int32 StripRows)
+{
+    FBiomeRegions Result;
+    Result.Rows = Rows;
+    Result.Cols = Cols;
+    if (Rows == 0 || Cols == 0)
+    {
+        return Result;
+    }
+
+    StripRows = FMath::Max(StripRows, 1);
+    const int32 NumStrips = FMath::DivideAndRoundUp(Rows, StripRows);
+    TArray<int32> Parents;
+    Parents.SetNumUninitialized(Rows * Cols);
+
+    // Each strip links cells to their left and upper neighbours without leaving the strip, so strips never
+    // touch each other's parents
+    ParallelFor(NumStrips, [&](int32 Strip)
+        {
+            const int32 Begin = Strip * StripRows;
+            const int32 End = FMath::Min(Begin + StripRows, Rows);
+            for (int32 R = Begin; R < End; ++R)
+            {
+                for (int32 C = 0; C < Cols; ++C)
+                {
+                    const int32 Index = R * Cols + C;
+                    Parents[Index] = Index;
+                    if (C > 0 && Classes[Index - 1] == Classes[Index])
+                    {
+                        Union(Parents, Index - 1, Index);
+                    }
+                    if (R > Begin && Classes[Index - Cols] == Classes[Index])
+                    {
+                        Union(Parents, Index - Cols, Index);
+                    }
+                }
+            }
+        });
+
+    // Stitch the strips together along their top rows
+    for (int32 Strip = 1; Strip < NumStrips; ++Strip)
+    {
+        const int32 R = Strip * StripRows;
+        for (int32 C = 0; C < Cols; ++C)
+        {
+            const int32 Index = R * Cols + C;
+            if (Classes[Index - Cols] == Classes[Index])
+            {
+                Union(Parents, Index - Cols, Index);
+            }
+        }
+    }
+
+    // Roots are the first cells of their regions, so numbering them in row-major order is deterministic
+    TArray<int32> RootRegion;
+    RootRegion.SetNumUninitialized(Rows * Cols);
+    int32 NumRegions = 0;
+    for (int32 Index = 0; Index < Rows * Cols; ++Index)
+    {
+        if (Parents[Index] == Index)
+        {
+            RootRegion[Index] = NumRegions++;
+        }
+    }
+
+    // Label cells and gather per-strip partial statistics in parallel; finds are read-only from here on
+    struct FPartial
+    {
+        int64 SumR = 0;
+        int64 SumC = 0;
+        int32 Area = 0;
+        FIntRect Bounds = FIntRect(MAX_int32, MAX_int32, MIN_int32, MIN_int32);
+    };
+    TArray<TMap<int32, FPartial>> StripStats;
+    StripStats.SetNum(NumStrips);
+    Result.Labels.SetNumUninitialized(Rows * Cols);
+
+    ParallelFor(NumStrips, [&](int32 Strip)
+        {
+            TMap<int32, FPartial>& Stats = StripStats[Strip];
+            const int32 Begin = Strip * StripRows;
+            const int32 End = FMath::Min(Begin + StripRows, Rows);
+            for (int32 R = Begin; R < End; ++R)
+            {
+                for (int32 C = 0; C < Cols; ++C)
+                {
+                    int32 Root = R * Cols + C;
+                    while (Parents[Root] != Root)
+                    {
+                        Root = Parents[Root];
+                    }
+                    const int32 Region = RootRegion[Root];
+                    Result.Labels[R * Cols + C] = Region;
+
+                    FPartial& Partial = Stats.FindOrAdd(Region);
+                    Partial.SumR += R;
+                    Partial.SumC += C;
+                    ++Partial.Area;
+                    Partial.Bounds.Min.X = FMath::Min(Partial.Bounds.Min.X, R);
+                    Partial.Bounds.Min.Y = FMath::Min(Partial.Bounds.Min.Y, C);
+                    Partial.Bounds.Max.X = FMath::Max(Partial.Bounds.Max.X, R + 1);
+                    Partial.Bounds.Max.Y = FMath::Max(Partial.Bounds.Max.Y, C + 1);
+                }
+            }
+        });
+
+    TArray<FPartial> Totals;
+    Totals.SetNum(NumRegions);
+    for (const TMap<int32, FPartial>& Stats : StripStats)
+    {
+        for (const TPair<int32, FPartial>& Pair : Stats)
+        {
+            FPartial& Total = Totals[Pair.Key];
+            Total.SumR += Pair.Value.SumR;
+            Total.SumC += Pair.Value.SumC;
+            Total.Area += Pair.Value.Area;
+            Total.Bounds.Min.X = FMath::Min(Total.Bounds.Min.X, Pair.Value.Bounds.Min.X);
+            Total.Bounds.Min.Y = FMath::Min(Total.Bounds.Min.Y, Pair.Value.Bounds.Min.Y);
+            Total.Bounds.Max.X = FMath::Max(Total.Bounds.Max.X, Pair.Value.Bounds.Max.X);
+            Total.Bounds.Max.Y = FMath::Max(Total.Bounds.Max.Y, Pair.Value.Bounds.Max.Y);
+        }
+    }
+
+    Result.Regions.SetNum(NumRegions);
+    for (int32 Index = 0; Index < Rows * Cols; ++Index)
+    {
+        if (Parents[Index] == Index)
+        {
+            const FPartial& Total = Totals[RootRegion[Index]];
+            FBiomeRegion& Region = Result.Regions[RootRegion[Index]];
+            Region.Class = Classes[Index];
+            Region.Area = Total.Area;
+            Region.Bounds = Total.Bounds;
+            Region.Centroid = FVector2D(double(Total.SumR) / Total.Area, double(Total.SumC) / Total.Area);
+        }
+    }
+
+    return Result;
+}
+
+
+int32 FBiomeRegions::FindLargest(uint8 Class) const
+{
+    int32 Largest = INDEX_NONE;
+    for (int32 Index = 0; Index < Regions.Num(); ++Index)
+    {
+        if (Regions[Index].Class == Class && (Largest == INDEX_NONE || Regions[Index].Area > Regions[Largest].Area))
+        {
+            Largest = Index;
+        }
+    }
+    return Largest;
+}
+
+
+FIntPoint FBiomeRegions::GetRandomCell(int32 Region, FRandomStream& Random) const
+{
+    const FIntRect& Bounds = Regions[Region].Bounds;
+    for (int32 Try = 0; Try < 32; ++Try)
+    {
+        const int32 R = Random.RandRange(Bounds.Min.X, Bounds.Max.X - 1);
+        const int32 C = Random.RandRange(Bounds.Min.Y, Bounds.Max.Y - 1);
+        if (Labels[R * Cols + C] == Region)
+        {
+            return FIntPoint(R, C);
+        }
+    }
+
+    // Thin or hollow regions can keep missing; the first cell in row-major order always belongs
+    for (int32 R = Bounds.Min.X; R < Bounds.Max.X; ++R)
+    {
+        for (int32 C = Bounds.Min.Y; C < Bounds.Max.Y; ++C)
+        {
+            if (Labels[R * Cols + C] == Region)
+            {
+                return FIntPoint(R, C);
+            }
+        }
+    }
+    return Bounds.Min;
+}
@@ -0,0 +1,234 @@
+#include "BiomeRunMap.h"
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+
+
+FBiomeRunMap::FBiomeRunMap(const TArray<TArray<ECell>>& Board)
+    : Size(Board.Num(), Board.Num() > 0 ? Board[0].Num() : 0)
+{
+    // Count the runs of every row, then fill each row's slice in parallel
+    TArray<int32> RowRuns;
+    RowRuns.SetNumZeroed(Size.X);
+    ParallelFor(Size.X, [&](int32 X)
+        {
+            const TArray<ECell>& Row = Board[X];
+            int32 Runs = Size.Y > 0 ? 1 : 0;
+            for (int32 Y = 1; Y < Size.Y; ++Y)
+            {
+                Runs += Row[Y] != Row[Y - 1] ? 1 : 0;
+            }
+            RowRuns[X] = Runs;
+        });
+
+    RowOffsets.SetNumUninitialized(Size.X + 1);
+    RowOffsets[0] = 0;
+    for (int32 X = 0; X < Size.X; ++X)
+    {
+        RowOffsets[X + 1] = RowOffsets[X] + RowRuns[X];
+    }
+
+    RunStarts.SetNumUninitialized(RowOffsets[Size.X]);
+    RunBiomes.SetNumUninitialized(RowOffsets[Size.X]);
+    ParallelFor(Size.X, [&](int32 X)
+        {
+            const TArray<ECell>& Row = Board[X];
+            int32 Run = RowOffsets[X];
+            for (int32 Y = 0; Y < Size.Y; ++Y)
+            {
+                if (Y == 0 || Row[Y] != Row[Y - 1])
+                {
+                    RunStarts[Run] = Y;
+                    RunBiomes[Run] = Row[Y];
+                    ++Run;
+                }
+            }
+        });
+}
+
+
+FArchive& operator<<(FArchive& Ar, FBiomeRunMap& Map)
+{
+    Ar << Map.Size;
+    Map.RowOffsets.BulkSerialize(Ar);
+    Map.RunStarts.BulkSerialize(Ar);
+    Ar << Map.RunBiomes;
+    return Ar;
+}
+
+
+bool FBiomeRunMap::IsValid() const
+{
+    if (Size.X <= 0 || Size.Y <= 0 || RowOffsets.Num() != Size.X + 1 || RowOffsets[0] != 0
+        || RowOffsets.Last() != RunStarts.Num() || RunBiomes.Num() != RunStarts.Num())
+    {
+        return false;
+    }
+    for (int32 X = 0; X < Size.X; ++X)
+    {
+        // Every row starts a run at column 0, and its runs start in increasing columns inside the row
+        if (RowOffsets[X + 1] <= RowOffsets[X] || RunStarts[RowOffsets[X]] != 0)
+        {
+            return false;
+        }
+        for (int32 Run = RowOffsets[X] + 1; Run < RowOffsets[X + 1]; ++Run)
+        {
+            if (RunStarts[Run] <= RunStarts[Run - 1] || RunStarts[Run] >= Size.Y)
+            {
+                return false;
+            }
+        }
+    }
+    for (const ECell Biome : RunBiomes)
+    {
+        if (Biome > ECell::Mesa)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+SIZE_T FBiomeRunMap::GetAllocatedSize() const
+{
+    return RowOffsets.GetAllocatedSize() + RunStarts.GetAllocatedSize() + RunBiomes.GetAllocatedSize();
+}
+
+
+int32 FBiomeRunMap::FindRun(int32 X, int32 Y) const
+{
+    // The last run starting at or before Y
+    const int32 First = RowOffsets[X];
+    const TArrayView<const int32> Starts(RunStarts.GetData() + First, RowOffsets[X + 1] - First);
+    return First + Algo::UpperBound(Starts, Y) - 1;
+}
+
+
+bool FBiomeRunMap::GetBiome(int32 X, int32 Y, ECell& OutBiome) const
+{
+    if (X < 0 || Y < 0 || X >= Size.X || Y >= Size.Y)
+    {
+        return false;
+    }
+    OutBiome = RunBiomes[FindRun(X, Y)];
+    return true;
+}
+
+
+bool FBiomeRunMap::FindNearest(ECell Biome, const FIntPoint& From, FIntPoint& OutCell, int32 MaxDistance) const
+{
+    if (Size.X == 0 || Size.Y == 0 || MaxDistance < 0)
+    {
+        return false;
+    }
+
+    const int64 MaxSquared = FMath::Square(int64(MaxDistance));
+    int64 BestSquared = MaxSquared + 1;
+    const int32 NearestY = FMath::Clamp(From.Y, 0, Size.Y - 1);
+
+    // Closest column of Biome on row X, walking runs outward from the one under From.Y
+    auto SearchRow = [&](int32 X)
+        {
+            const int64 RowSquared = FMath::Square(int64(X - From.X));
+            const int32 Home = FindRun(X, NearestY);
+
+            for (int32 Run = Home; Run >= RowOffsets[X]; --Run)
+            {
+                const int32 Y = FMath::Min(GetRunEnd(X, Run) - 1, NearestY);
+                const int64 Squared = RowSquared + FMath::Square(int64(Y - From.Y));
+                if (Squared >= BestSquared)
+                {
+                    break;
+                }
+                if (RunBiomes[Run] == Biome)
+                {
+                    BestSquared = Squared;
+                    OutCell = FIntPoint(X, Y);
+                    break;
+                }
+            }
+            for (int32 Run = Home + 1; Run < RowOffsets[X + 1]; ++Run)
+            {
+                const int32 Y = RunStarts[Run];
+                const int64 Squared = RowSquared + FMath::Square(int64(Y - From.Y));
+                if (Squared >= BestSquared)
+                {
+                    break;
+                }
+                if (RunBiomes[Run] == Biome)
+                {
+                    BestSquared = Squared;
+                    OutCell = FIntPoint(X, Y);
+                    break;
+                }
+            }
+        };
+
+    // Rows further from From.X than the best match so far cannot hold a closer cell
+    const int32 StartX = FMath::Clamp(From.X, 0, Size.X - 1);
+    for (int32 Lo = StartX, Hi = StartX + 1; Lo >= 0 || Hi < Size.X;)
+    {
+        const bool bLoAlive = Lo >= 0 && FMath::Square(int64(Lo - From.X)) < BestSquared;
+        const bool bHiAlive = Hi < Size.X && FMath::Square(int64(Hi - From.X)) < BestSquared;
+        if (!bLoAlive && !bHiAlive)
+        {
+            break;
+        }
+        if (bLoAlive)
+        {
+            SearchRow(Lo--);
+        }
+        if (bHiAlive)
+        {
+            SearchRow(Hi++);
+        }
+    }
+
+    return BestSquared <= MaxSquared;
+}
+
+
+TArray<uint8> FBiomeRunMap::MakeMask(const ADiamondSquare::FCellSet& Cells) const
+{
+    TArray<uint8> Mask;
+    Mask.SetNumUninitialized(Size.X * Size.Y);
+    ParallelFor(Size.X, [&](int32 X)
+        {
+            uint8* Row = Mask.GetData() + X * Size.Y;
+            for (int32 Run = RowOffsets[X]; Run < RowOffsets[X + 1]; ++Run)
+            {
+                FMemory::Memset(Row + RunStarts[Run], Cells.Contains(RunBiomes[Run]) ? 1 : 0, GetRunEnd(X, Run) - RunStarts[Run]);
+            }
+        });
+    return Mask;
+}
+
+
+int32 FBiomeRunMap::FindInRect(ECell Biome, const FIntRect& Rect, TArray<FBiomeSpan>& OutSpans) const
+{
+    const int32 MinX = FMath::Max(Rect.Min.X, 0);
+    const int32 MaxX = FMath::Min(Rect.Max.X, Size.X);
+    const int32 MinY = FMath::Max(Rect.Min.Y, 0);
+    const int32 MaxY = FMath::Min(Rect.Max.Y, Size.Y);
+    if (MinY >= MaxY)
+    {
+        return 0;
+    }
+
+    int32 NumCells = 0;
+    for (int32 X = MinX; X < MaxX; ++X)
+    {
+        for (int32 Run = FindRun(X, MinY); Run < RowOffsets[X + 1] && RunStarts[Run] < MaxY; ++Run)
+        {
+            if (RunBiomes[Run] == Biome)
+            {
+                FBiomeSpan& Span = OutSpans.AddDefaulted_GetRef();
+                Span.Row = X;
+                Span.Begin = FMath::Max(RunStarts[Run], MinY);
+                Span.End = FMath::Min(GetRunEnd(X, Run), MaxY);
+                NumCells += Span.End - Span.Begin;
+            }
+        }
+    }
+    return NumCells;
+}
@@ -0,0 +1,142 @@
+#include "BiomeTiles.h"
+#include "Async/ParallelFor.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+
+TArray<FIntPoint> FBiomeTiles::GetLevelSizes(const FIntPoint& InputSize, const TArray<FBiomeTileStage>& Stages)
+{
+    TArray<FIntPoint> Sizes;
+    Sizes.Reserve(Stages.Num() + 1);
+    Sizes.Add(InputSize);
+    for (const FBiomeTileStage& Stage : Stages)
+    {
+        Sizes.Add(Sizes.Last() * Stage.GetScaleFactor());
+    }
+    return Sizes;
+}
+
+
+FIntRect FBiomeTiles::GetInputRect(const FBiomeTileStage& Stage, const FIntRect& OutputRect, const FIntPoint& InputSize)
+{
+    // Both stages read at most one cell around each output cell
+    if (Stage.Kind == EBiomeTileStageKind::Zoom)
+    {
+        // The upscaled cells within one of the rectangle, then the input cells they were copied from
+        const FIntPoint OutputSize = InputSize * 2;
+        return FIntRect(
+            FMath::Max(OutputRect.Min.X - 1, 0) / 2,
+            FMath::Max(OutputRect.Min.Y - 1, 0) / 2,
+            (FMath::Min(OutputRect.Max.X + 1, OutputSize.X) - 1) / 2 + 1,
+            (FMath::Min(OutputRect.Max.Y + 1, OutputSize.Y) - 1) / 2 + 1);
+    }
+
+    return FIntRect(
+        FMath::Max(OutputRect.Min.X - 1, 0),
+        FMath::Max(OutputRect.Min.Y - 1, 0),
+        FMath::Min(OutputRect.Max.X + 1, InputSize.X),
+        FMath::Min(OutputRect.Max.Y + 1, InputSize.Y));
+}
+
+
+void FBiomeTiles::RunTile(const TArray<TArray<ECell>>& Input, const TArray<FBiomeTileStage>& Stages, const FIntRect& OutputRect, FBiomeTile& OutTile)
+{
+    const FIntPoint InputSize(Input.Num(), Input.Num() > 0 ? Input[0].Num() : 0);
+    const TArray<FIntPoint> Sizes = GetLevelSizes(InputSize, Stages);
+
+    // Walk back from the output to find the halo-padded rectangle every level has to provide
+    TArray<FIntRect> Rects;
+    Rects.SetNum(Stages.Num() + 1);
+    Rects[Stages.Num()] = OutputRect;
+    for (int32 Index = Stages.Num() - 1; Index >= 0; --Index)
+    {
+        Rects[Index] = GetInputRect(Stages[Index], Rects[Index + 1], Sizes[Index]);
+    }
+
+    FBiomeTile Current;
+    Current.Init(Rects[0]);
+    for (int32 R = Rects[0].Min.X; R < Rects[0].Max.X; ++R)
+    {
+        FMemory::Memcpy(&Current.At(R, Rects[0].Min.Y), &Input[R][Rects[0].Min.Y], Current.NumCols * sizeof(ECell));
+    }
+
+    // Every stage runs back to back on the small tile while it is still in cache
+    FBiomeTile Next;
+    for (int32 Index = 0; Index < Stages.Num(); ++Index)
+    {
+        const FBiomeTileStage& Stage = Stages[Index];
+        TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(Stage.Kind == EBiomeTileStageKind::Zoom ? TEXT("Zoom") : TEXT("Shore"));
+        const FIntRect& Rect = Rects[Index + 1];
+        const int32 Rows = Sizes[Index + 1].X;
+        const int32 Cols = Sizes[Index + 1].Y;
+        Next.Init(Rect);
+
+        if (Stage.Kind == EBiomeTileStageKind::Zoom)
+        {
+            auto Scaled = [&Current](int32 R, int32 C) { return Current.Get(R / 2, C / 2); };
+            for (int32 R = Rect.Min.X; R < Rect.Max.X; ++R)
+            {
+                for (int32 C = Rect.Min.Y; C < Rect.Max.Y; ++C)
+                {
+                    Next.At(R, C) = ZoomCell(Scaled, Rows, Cols, Stage.Seed, R, C);
+                }
+            }
+        }
+        else
+        {
+            auto Get = [&Current](int32 R, int32 C) { return Current.Get(R, C); };
+            for (int32 R = Rect.Min.X; R < Rect.Max.X; ++R)
+            {
+                for (int32 C = Rect.Min.Y; C < Rect.Max.Y; ++C)
+                {
+                    Next.At(R, C) = ShoreCell(Get, Rows, Cols, R, C);
+                }
+            }
+        }
+
+        Swap(Current, Next);
+    }
+
+    OutTile = MoveTemp(Current);
+}
+
+
+TArray<TArray<ADiamondSquare::ECell>> FBiomeTiles::Run(const TArray<TArray<ECell>>& Input, const TArray<FBiomeTileStage>& Stages, int32 TileSize)
+{
+    TArray<TArray<ECell>> Output;
+    if (Input.Num() == 0 || Input[0].Num() == 0)
+    {
+        return Output;
+    }
+
+    const FIntPoint OutputSize = GetLevelSizes(FIntPoint(Input.Num(), Input[0].Num()), Stages).Last();
+    Output.SetNum(OutputSize.X);
+    for (TArray<ECell>& Row : Output)
+    {
+        Row.SetNumUninitialized(OutputSize.Y);
+    }
+
+    TileSize = FMath::Max(TileSize, 1);
+    const int32 TilesX = FMath::DivideAndRoundUp(OutputSize.X, TileSize);
+    const int32 TilesY = FMath::DivideAndRoundUp(OutputSize.Y, TileSize);
+
+    // Tiles write disjoint parts of the preallocated rows, so they need no synchronisation
+    ParallelFor(TilesX * TilesY, [&](int32 TileIndex)
+        {
+            const int32 TileRow = TileIndex / TilesY;
+            const int32 TileCol = TileIndex % TilesY;
+            const FIntRect Rect(
+                TileRow * TileSize,
+                TileCol * TileSize,
+                FMath::Min((TileRow + 1) * TileSize, OutputSize.X),
+                FMath::Min((TileCol + 1) * TileSize, OutputSize.Y));
+
+            FBiomeTile Tile;
+            RunTile(Input, Stages, Rect, Tile);
+            for (int32 R = Rect.Min.X; R < Rect.Max.X; ++R)
+            {
+                FMemory::Memcpy(&Output[R][Rect.Min.Y], &Tile.At(R, Rect.Min.Y), Tile.NumCols * sizeof(ECell));
+            }
+        });
+
+    return Output;
+}
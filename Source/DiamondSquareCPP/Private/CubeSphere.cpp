@@ -0,0 +1,33 @@
+#include "CubeSphere.h"
+
+
+FVector FCubeSphere::GetCubePoint(int32 Face, double U, double V)
+{
+    switch (Face)
+    {
+    case 0: // +X
+        return FVector(1.0, U, V);
+    case 1: // -X
+        return FVector(-1.0, V, U);
+    case 2: // +Y
+        return FVector(V, 1.0, U);
+    case 3: // -Y
+        return FVector(U, -1.0, V);
+    case 4: // +Z
+        return FVector(U, V, 1.0);
+    default: // -Z
+        return FVector(V, U, -1.0);
+    }
+}
+
+
+FVector FCubeSphere::CubeToSphere(const FVector& CubePoint)
+{
+    const double X2 = CubePoint.X * CubePoint.X;
+    const double Y2 = CubePoint.Y * CubePoint.Y;
+    const double Z2 = CubePoint.Z * CubePoint.Z;
+    return FVector(
+        CubePoint.X * FMath::Sqrt(FMath::Max(1.0 - Y2 / 2.0 - Z2 / 2.0 + Y2 * Z2 / 3.0, 0.0)),
+        CubePoint.Y * FMath::Sqrt(FMath::Max(1.0 - Z2 / 2.0 - X2 / 2.0 + Z2 * X2 / 3.0, 0.0)),
+        CubePoint.Z * FMath::Sqrt(FMath::Max(1.0 - X2 / 2.0 - Y2 / 2.0 + X2 * Y2 / 3.0, 0.0)));
+}
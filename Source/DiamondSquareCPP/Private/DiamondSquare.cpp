@@ -1,14 +1,104 @@
 #include "DiamondSquare.h"
 #include "Engine/World.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformMemory.h"
 #include "HAL/PlatformTime.h"
+#include "Misc/ScopeLock.h"
 #include "Math/Color.h"
 #include "ProceduralMeshComponent.h"
 #include "KismetProceduralMeshLibrary.h"
-#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/Pawn.h"
+#include "Kismet/GameplayStatics.h"
+#include "HAL/PlatformFileManager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Misc/Paths.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "BiomeTiles.h"
+#include "BiomePipeline.h"
+#include "BiomeQuery.h"
+#include "BiomeDistance.h"
+#include "BiomeRegions.h"
+#include "BiomeRunMap.h"
+#include "TerrainBoxBlur.h"
+#include "TerrainHydrology.h"
+#include "TerrainHorizonAO.h"
+#include "TerrainWorldFile.h"
+#include "GenerationCoreAdapter.h"
+#include "DiamondSquareLog.h"
+#include "DiamondSquareCustomVersion.h"
+#include "Serialization/CustomVersion.h"
 
-DECLARE_LOG_CATEGORY_EXTERN(LogDiamondSquare, Log, All);
 DEFINE_LOG_CATEGORY(LogDiamondSquare);
 
+// "stat DiamondSquare" shows each generation step and the counters of the last build, and the same steps appear
+// in Unreal Insights with every biome stage under its own name. Run with -csvCategories=DiamondSquare to add the
+// steps, stages and counters to CSV profiles, so builds can be charted against each other over time.
+DECLARE_STATS_GROUP(TEXT("DiamondSquare"), STATGROUP_DiamondSquare, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Construction"), STAT_DiamondSquare_Construction, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Load world file"), STAT_DiamondSquare_LoadWorldFile, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Save world file"), STAT_DiamondSquare_SaveWorldFile, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Biome map"), STAT_DiamondSquare_BiomeMap, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Noise map"), STAT_DiamondSquare_NoiseMap, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Erosion"), STAT_DiamondSquare_Erosion, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Rivers"), STAT_DiamondSquare_Rivers, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Islands"), STAT_DiamondSquare_Islands, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Vertices"), STAT_DiamondSquare_Vertices, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Ambient occlusion"), STAT_DiamondSquare_AmbientOcclusion, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Height field"), STAT_DiamondSquare_HeightField, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Cave mask"), STAT_DiamondSquare_CaveMask, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Triangles"), STAT_DiamondSquare_Triangles, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Tangents"), STAT_DiamondSquare_Tangents, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Collision chunks"), STAT_DiamondSquare_CollisionChunks, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Mesh section"), STAT_DiamondSquare_MeshSection, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Caves"), STAT_DiamondSquare_Caves, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Foliage"), STAT_DiamondSquare_Foliage, STATGROUP_DiamondSquare);
+DECLARE_CYCLE_STAT(TEXT("Region tile stages"), STAT_DiamondSquare_RegionTileStages, STATGROUP_DiamondSquare);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cells processed"), STAT_DiamondSquare_CellsProcessed, STATGROUP_DiamondSquare);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Triangles emitted"), STAT_DiamondSquare_TrianglesEmitted, STATGROUP_DiamondSquare);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Instances placed"), STAT_DiamondSquare_InstancesPlaced, STATGROUP_DiamondSquare);
+
+CSV_DEFINE_CATEGORY(DiamondSquare, false);
+
+// Times one generation step as a cycle stat, which Insights also records, and as a CSV timing
+#define DIAMONDSQUARE_STEP_SCOPE(Step) \
+    SCOPE_CYCLE_COUNTER(STAT_DiamondSquare_##Step); \
+    CSV_SCOPED_TIMING_STAT(DiamondSquare, Step)
+
+// Counts the cells a biome step wrote and, while a CSV profile with the DiamondSquare category is capturing,
+// records its time in column Column. Steps of a plan set a column keyed by the index of their first stage, so
+// repeated stages such as Zoom and AddIsland keep a column each; steps that run many times a frame, such as
+// the region tile stages, accumulate into theirs.
+static void RecordBiomeStep(const FString& Column, double StartTime, int64 NumCells, bool bAccumulate = false)
+{
+    INC_DWORD_STAT_BY(STAT_DiamondSquare_CellsProcessed, NumCells);
+    CSV_CUSTOM_STAT(DiamondSquare, CellsProcessed, int32(NumCells), ECsvCustomStatOp::Accumulate);
+#if CSV_PROFILER
+    if (FCsvProfiler::Get()->IsCapturing())
+    {
+        FCsvProfiler::RecordCustomStat(FName(*Column), CSV_CATEGORY_INDEX(DiamondSquare), float((FPlatformTime::Seconds() - StartTime) * 1000.0),
+            bAccumulate ? ECsvCustomStatOp::Accumulate : ECsvCustomStatOp::Set);
+    }
+#endif
+}
+
+
+static FString GetBiomeStageColumn(int32 StageIndex, const FString& Name)
+{
+    return FString::Printf(TEXT("Biome%02d_%s"), StageIndex, *Name);
+}
+
+
+const FGuid FDiamondSquareCustomVersion::GUID(0x5B1E93A4, 0x2C7D4F08, 0x9A61E3D2, 0x47F0B8C5);
+static FCustomVersionRegistration GRegisterDiamondSquareCustomVersion(FDiamondSquareCustomVersion::GUID, FDiamondSquareCustomVersion::LatestVersion, TEXT("DiamondSquare"));
+
+// Section 0 renders the terrain, section 1 holds the hidden collision proxy, and the cave chunks follow
+static const int32 CollisionSectionIndex = 1;
+static const int32 FirstCaveSectionIndex = 2;
+
 
 ADiamondSquare::ADiamondSquare()
 {
@@ -16,23 +106,10 @@ ADiamondSquare::ADiamondSquare()
     ProceduralMesh = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("ProceduralMesh"));
     RootComponent = ProceduralMesh; // Set ProceduralMesh as the RootComponent
 
-    // Initialize and attach the tree mesh component to the ProceduralMesh
-    TreeMeshComponent = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("TreeMeshComponent"));
-    TreeMeshComponent->SetupAttachment(ProceduralMesh); // Attach to the root component
-
-    // Assign the static mesh asset to the TreeMeshComponent
-    /*static ConstructorHelpers::FObjectFinder<UStaticMesh> TreeMeshAsset(TEXT("/Game/Fantastic_Village_Pack/meshes/environment/SM_ENV_TREE_village_LOD0"));
-    if (TreeMeshAsset.Succeeded())
-    {
-        TreeMeshComponent->SetStaticMesh(TreeMeshAsset.Object);
-    }
-    else
-    {
-        UE_LOG(LogTemp, Warning, TEXT("Failed to load tree mesh."));
-    }*/
-
-    // PrimaryActorTick.bCanEverTick is set to false by default, but you can enable it if needed.
-    PrimaryActorTick.bCanEverTick = false;
+    // Ticking is only switched on in game, to stream collision chunks around the player
+    PrimaryActorTick.bCanEverTick = true;
+    PrimaryActorTick.bStartWithTickEnabled = false;
+    PrimaryActorTick.TickInterval = 0.25f;
 }
 
 
@@ -43,7 +120,7 @@ void ADiamondSquare::OnConstruction(const FTransform& Transform)
 
     // Check if the mesh needs to be recreated
     if (recreateMesh) {
-        if (!ProceduralMesh || !TreeMeshComponent)
+        if (!ProceduralMesh)
         {
             UE_LOG(LogTemp, Error, TEXT("Mesh components are not initialized properly."));
             return;
@@ -58,35 +135,97 @@ void ADiamondSquare::OnConstruction(const FTransform& Transform)
         Triangles.Reset();
         UV0.Reset();
         BiomeMap.Reset();
+        {
+            // TestIsland publishes the new map's query; a loaded world file leaves it to BeginPlay
+            FScopeLock Lock(&BiomeQueryLock);
+            BiomeQuery.Reset();
+        }
 
-        if (TreeMeshComponent)
+        if (!addProceduralObjects)
+        {
+            ResetFoliageClusters();
+        }
+        DIAMONDSQUARE_STEP_SCOPE(Construction);
+        SET_DWORD_STAT(STAT_DiamondSquare_CellsProcessed, 0);
+        SET_DWORD_STAT(STAT_DiamondSquare_TrianglesEmitted, 0);
+        SET_DWORD_STAT(STAT_DiamondSquare_InstancesPlaced, 0);
+        const double StartTime = FPlatformTime::Seconds();
+
+        TArray<TArray<float>> NoiseMap;
+        const bool bLoaded = bLoadWorldFile && LoadWorldFile(NoiseMap);
+        if (!bLoaded)
         {
-            TreeMeshComponent->ClearInstances();
+            NoiseMap = GenerateNoiseMap();
+            if (bSaveWorldFile)
+            {
+                DIAMONDSQUARE_STEP_SCOPE(SaveWorldFile);
+                SaveWorldFile(NoiseMap);
+            }
         }
-        double StartTimeOC = FPlatformTime::Seconds();
-        auto NoiseMap = GeneratePerlinNoiseMap();
+
+        // The biome lookups are built once, from the map erosion and rivers have finished, so none goes stale
+        PublishBiomeLookups();
 
         // Create vertices and triangles for the mesh
         CreateVertices(NoiseMap);
+        if (bBakeAmbientOcclusion)
+        {
+            BakeAmbientOcclusion(NoiseMap);
+        }
+
+        // Keep a compact copy of the vertex heights for GetHeightAt; the noise map is dropped after construction
+        if (XSize > 0 && YSize > 0)
+        {
+            DIAMONDSQUARE_STEP_SCOPE(HeightField);
+            TArray<float> Heights;
+            Heights.SetNumUninitialized(XSize * YSize);
+            for (int32 X = 0; X < XSize; ++X)
+            {
+                for (int32 Y = 0; Y < YSize; ++Y)
+                {
+                    Heights[X * YSize + Y] = GetVertexHeight(NoiseMap[X][Y]);
+                }
+            }
+            const TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe> NewField = MakeShared<FTerrainHeightField, ESPMode::ThreadSafe>(XSize, YSize, Scale, Heights);
+
+            FScopeLock Lock(&HeightFieldLock);
+            HeightField = NewField;
+        }
+        BuildCaveMask();
         CreateTriangles();
 
 
         // Calculate normals and tangents for the mesh
         if (CalculateTangents) {
+            DIAMONDSQUARE_STEP_SCOPE(Tangents);
             UKismetProceduralMeshLibrary::CalculateTangentsForMesh(Vertices, Triangles, UV0, Normals, Tangents);
         }
 
+        // Build the decimated collision proxy; without one the render section cooks its own collision
+        ProceduralMesh->bUseAsyncCooking = bUseAsyncCooking;
+        BuildCollisionChunks(NoiseMap);
+
         // Create the mesh section with the specified data and apply the material
-        ProceduralMesh->CreateMeshSection(0, Vertices, Triangles, Normals, UV0, Colors, Tangents, true);
-        ProceduralMesh->SetMaterial(0, Material);
+        {
+            DIAMONDSQUARE_STEP_SCOPE(MeshSection);
+            ProceduralMesh->CreateMeshSection(0, Vertices, Triangles, Normals, UV0, Colors, Tangents, CollisionChunks.Num() == 0);
+            ProceduralMesh->SetMaterial(0, Material);
+
+            // Every chunk keeps collision in the editor; in game Tick narrows it down to the player's surroundings
+            for (FTerrainCollisionChunk& Chunk : CollisionChunks)
+            {
+                Chunk.bEnabled = true;
+            }
+            CommitCollisionChunks();
+        }
+
+        BuildCaves(NoiseMap);
 
         if (addProceduralObjects) {
             PlaceEnvironmentObjects(NoiseMap);
         }
 
-        double EndTimeOC = FPlatformTime::Seconds();
-        double ElapsedTimeOC = EndTimeOC - StartTimeOC;
-        UE_LOG(LogTemp, Warning, TEXT("Construction took %f seconds"), ElapsedTimeOC);
+        UE_LOG(LogDiamondSquare, Log, TEXT("Built a %d x %d terrain with %d triangles in %f seconds"), XSize, YSize, Triangles.Num() / 3, FPlatformTime::Seconds() - StartTime);
 
         // Reset mesh data to prepare for new mesh creation
         Normals.Reset();
@@ -97,19 +236,114 @@ void ADiamondSquare::OnConstruction(const FTransform& Transform)
         Triangles.Reset();
         UV0.Reset();
         BiomeMap.Reset();
+        CaveMask.Reset();
 
         // Reset the flag to avoid unnecessary mesh recreation
         CalculateTangents = false;
         addProceduralObjects = false;
+        bSaveWorldFile = false;
+        bLoadWorldFile = false;
         recreateMesh = false;
     }
 }
 
 
+// Saves the lookup Shared points to, or replaces it with the one Ar holds. A loaded lookup that fails IsValid
+// is dropped, so its queries fail until the next rebuild.
+template <typename LookupType>
+static void SerializeLookup(FArchive& Ar, TSharedPtr<const LookupType, ESPMode::ThreadSafe>& Shared, FCriticalSection& Lock, const UObject* Owner, const TCHAR* What)
+{
+    TSharedPtr<const LookupType, ESPMode::ThreadSafe> Current;
+    {
+        FScopeLock ScopeLock(&Lock);
+        Current = Shared;
+    }
+    bool bHasLookup = Current.IsValid();
+    Ar << bHasLookup;
+    if (Ar.IsLoading())
+    {
+        TSharedPtr<LookupType, ESPMode::ThreadSafe> Loaded;
+        if (bHasLookup)
+        {
+            Loaded = MakeShared<LookupType, ESPMode::ThreadSafe>();
+            Ar << *Loaded;
+            if (!Loaded->IsValid())
+            {
+                UE_LOG(LogDiamondSquare, Error, TEXT("%s has a corrupt %s; its queries fail until the next rebuild"), *Owner->GetPathName(), What);
+                Loaded.Reset();
+            }
+        }
+        FScopeLock ScopeLock(&Lock);
+        Shared = Loaded;
+    }
+    else if (bHasLookup)
+    {
+        // Saving only reads the lookup
+        Ar << const_cast<LookupType&>(*Current);
+    }
+}
+
+
+void ADiamondSquare::Serialize(FArchive& Ar)
+{
+    Super::Serialize(Ar);
+    Ar.UsingCustomVersion(FDiamondSquareCustomVersion::GUID);
+
+    // Undo keeps the lookups it has, as it does the mesh sections built with them
+    if (Ar.IsObjectReferenceCollector() || Ar.IsTransacting())
+    {
+        return;
+    }
+    if (Ar.CustomVer(FDiamondSquareCustomVersion::GUID) >= FDiamondSquareCustomVersion::SavedHeightField)
+    {
+        SerializeLookup(Ar, HeightField, HeightFieldLock, this, TEXT("height plane"));
+    }
+    if (Ar.CustomVer(FDiamondSquareCustomVersion::GUID) >= FDiamondSquareCustomVersion::SavedBiomeRuns)
+    {
+        SerializeLookup(Ar, BiomeRuns, BiomeQueryLock, this, TEXT("biome map"));
+    }
+}
+
+
+void ADiamondSquare::PostLoad()
+{
+    Super::PostLoad();
+    RestoreIslands();
+}
+
+
+void ADiamondSquare::RestoreIslands()
+{
+    // Islands are cheap to label again from the saved biome runs, so they are not saved themselves
+    const TSharedPtr<const FBiomeRunMap, ESPMode::ThreadSafe> Runs = GetBiomeRuns();
+    if (Runs.IsValid() && !GetIslands().IsValid())
+    {
+        LabelIslands(*Runs);
+    }
+}
+
+
 void ADiamondSquare::BeginPlay()
 {
     Super::BeginPlay();
+    RestoreIslands();
 
+    // The query is not saved with the level. With the late stages tiled its root is a small early board, so it
+    // is cheap to prepare again.
+    if (GetBiomeRuns().IsValid() && !GetBiomeQuery().IsValid())
+    {
+        TArray<TArray<ECell>> Root;
+        TArray<FBiomeTileStage> Stages;
+        PrepareRegions(FIntPoint(XSize, YSize), Root, Stages);
+        PublishBiomeQuery(MoveTemp(Root), Stages);
+    }
+
+    // The collision section saved with the level was committed with every chunk enabled
+    for (FTerrainCollisionChunk& Chunk : CollisionChunks)
+    {
+        Chunk.bEnabled = true;
+    }
+    SetActorTickEnabled(CollisionRadius > 0.0f && CollisionChunks.Num() > 0);
 }
 
 
@@ -117,256 +351,1358 @@ void ADiamondSquare::Tick(float DeltaTime)
 {
     Super::Tick(DeltaTime);
 
+    if (const APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(this, 0))
+    {
+        UpdateCollisionChunks(PlayerPawn->GetActorLocation());
+    }
 }
 
-void ADiamondSquare::PlaceEnvironmentObjects(const TArray<TArray<float>>& NoiseMap)
+
+void ADiamondSquare::BuildCollisionChunks(const TArray<TArray<float>>& NoiseMap)
 {
-    for (int X = 0; X < XSize; ++X)
+    CollisionChunks.Reset();
+
+    // Full-resolution collision on every chunk is exactly the render mesh, so no proxy is needed
+    if ((CollisionResolution <= 1 && CollisionRadius <= 0.0f) || XSize < 2 || YSize < 2)
     {
-        for (int Y = 0; Y < YSize; ++Y)
+        return;
+    }
+
+    DIAMONDSQUARE_STEP_SCOPE(CollisionChunks);
+    const int32 Stride = FMath::Max(CollisionResolution, 1);
+    const int32 ChunkSize = FMath::Max(CollisionChunkSize, Stride);
+
+    for (int32 StartX = 0; StartX < XSize - 1; StartX += ChunkSize)
+    {
+        for (int32 StartY = 0; StartY < YSize - 1; StartY += ChunkSize)
         {
-            float Z = NoiseMap[X][Y] * ZMultiplier;
-            FVector Location(X * Scale, Y * Scale, Z);
-            FRotator Rotation = FRotator(0, FMath::RandRange(0, 360), 0); // Random rotation for variation
-            FVector VectorScale(5.0f, 5.0f, 5.0f); // Scale can be adjusted based on the object and biome
+            // Neighbouring chunks share their border samples so the proxy has no gaps
+            const int32 EndX = FMath::Min(StartX + ChunkSize, XSize - 1);
+            const int32 EndY = FMath::Min(StartY + ChunkSize, YSize - 1);
 
-            ECell Biome = BiomeMap[X][Y];
+            TArray<int32> SamplesX;
+            TArray<int32> SamplesY;
+            for (int32 X = StartX; X < EndX; X += Stride)
+            {
+                SamplesX.Add(X);
+            }
+            SamplesX.Add(EndX);
+            for (int32 Y = StartY; Y < EndY; Y += Stride)
+            {
+                SamplesY.Add(Y);
+            }
+            SamplesY.Add(EndY);
 
-            // Determine what object to place based on the biome
-            switch (Biome)
+            FTerrainCollisionChunk& Chunk = CollisionChunks.AddDefaulted_GetRef();
+            Chunk.Vertices.Reserve(SamplesX.Num() * SamplesY.Num());
+            for (int32 X : SamplesX)
             {
-            case ECell::Forest:
-                if (FMath::RandRange(0.0f, 1.0f) < 0.01f) // Low probability for buildings
-                {
-                    TreeMeshComponent->AddInstance(FTransform(Rotation, Location, VectorScale));
-                }
-            case ECell::Taiga:
-                // Add a tree instance
-                
-                break;
-            case ECell::Mountain:
-                if (FMath::RandRange(0.0f, 1.0f) < 0.01f) // Low probability for buildings
+                for (int32 Y : SamplesY)
                 {
-                    TreeMeshComponent->AddInstance(FTransform(Rotation, Location, VectorScale));
+                    const FVector Vertex(X * Scale, Y * Scale, GetVertexHeight(NoiseMap[X][Y]));
+                    Chunk.Vertices.Add(Vertex);
+                    Chunk.Bounds += Vertex;
                 }
-            case ECell::Highland:
-                if (FMath::RandRange(0.0f, 1.0f) < 0.01f) // Low probability for buildings
+            }
+
+            // Same winding as CreateTriangles, over the decimated sample grid
+            const int32 Columns = SamplesY.Num();
+            Chunk.Triangles.Reserve((SamplesX.Num() - 1) * (Columns - 1) * 6);
+            for (int32 I = 0; I < SamplesX.Num() - 1; ++I)
+            {
+                for (int32 J = 0; J < Columns - 1; ++J)
                 {
-                    TreeMeshComponent->AddInstance(FTransform(Rotation, Location, VectorScale));
+                    // The cave layer has its own surface where every render quad under this one was left out
+                    if (IsUnderCaves(SamplesX[I], SamplesY[J], SamplesX[I + 1], SamplesY[J + 1]))
+                    {
+                        continue;
+                    }
+
+                    int32 VertexIndex = I * Columns + J;
+
+                    Chunk.Triangles.Add(VertexIndex);
+                    Chunk.Triangles.Add(VertexIndex + Columns + 1);
+                    Chunk.Triangles.Add(VertexIndex + Columns);
+
+                    Chunk.Triangles.Add(VertexIndex);
+                    Chunk.Triangles.Add(VertexIndex + 1);
+                    Chunk.Triangles.Add(VertexIndex + Columns + 1);
                 }
-                // Add a rock instance
-                //RockMeshComponent->AddInstance(FTransform(Rotation, Location, Scale));
-                break;
-            case ECell::Plains:
-                if (FMath::RandRange(0.0f, 1.0f) < 0.01f) // Low probability for buildings
+            }
+            if (Chunk.Triangles.Num() == 0)
+            {
+                CollisionChunks.Pop();
+            }
+        }
+    }
+}
+
+
+bool ADiamondSquare::IsUnderCaves(int32 MinX, int32 MinY, int32 MaxX, int32 MaxY) const
+{
+    if (CaveMask.Num() == 0)
+    {
+        return false;
+    }
+
+    // Same rule as CreateTriangles: a quad is left out when its corners are all entirely under the layer
+    for (int32 X = MinX; X <= MaxX; ++X)
+    {
+        for (int32 Y = MinY; Y <= MaxY; ++Y)
+        {
+            if (CaveMask[X * YSize + Y] < 1.0f)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+
+void ADiamondSquare::CommitCollisionChunks()
+{
+    // Merge the enabled chunks into one hidden section so each change cooks a single body
+    TArray<FVector> CollisionVertices;
+    TArray<int32> CollisionTriangles;
+    for (const FTerrainCollisionChunk& Chunk : CollisionChunks)
+    {
+        if (!Chunk.bEnabled)
+        {
+            continue;
+        }
+
+        const int32 BaseIndex = CollisionVertices.Num();
+        CollisionVertices.Append(Chunk.Vertices);
+        for (int32 Index : Chunk.Triangles)
+        {
+            CollisionTriangles.Add(BaseIndex + Index);
+        }
+    }
+
+    if (CollisionTriangles.Num() == 0)
+    {
+        ProceduralMesh->ClearMeshSection(CollisionSectionIndex);
+        return;
+    }
+
+    ProceduralMesh->CreateMeshSection(CollisionSectionIndex, CollisionVertices, CollisionTriangles, TArray<FVector>(), TArray<FVector2D>(),
+        TArray<FColor>(), TArray<FProcMeshTangent>(), true);
+    ProceduralMesh->SetMeshSectionVisible(CollisionSectionIndex, false);
+}
+
+
+void ADiamondSquare::UpdateCollisionChunks(const FVector& FocusLocation)
+{
+    if (CollisionChunks.Num() == 0 || !ProceduralMesh)
+    {
+        return;
+    }
+
+    // Chunk bounds are in component space
+    const FVector LocalFocus = ProceduralMesh->GetComponentTransform().InverseTransformPosition(FocusLocation);
+    const float RadiusSquared = FMath::Square(CollisionRadius);
+
+    bool bChanged = false;
+    for (FTerrainCollisionChunk& Chunk : CollisionChunks)
+    {
+        const bool bWantEnabled = CollisionRadius <= 0.0f || Chunk.Bounds.ComputeSquaredDistanceToPoint(LocalFocus) <= RadiusSquared;
+        if (Chunk.bEnabled != bWantEnabled)
+        {
+            Chunk.bEnabled = bWantEnabled;
+            bChanged = true;
+        }
+    }
+
+    // Only recook when a chunk crossed the radius
+    if (bChanged)
+    {
+        CommitCollisionChunks();
+    }
+}
+
+void ADiamondSquare::PlaceEnvironmentObjects(const TArray<TArray<float>>& NoiseMap)
+{
+    if (NoiseMap.Num() < XSize || BiomeMap.Num() < XSize)
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("PlaceEnvironmentObjects needs the noise and biome maps of the current mesh."));
+        return;
+    }
+
+    DIAMONDSQUARE_STEP_SCOPE(Foliage);
+    RebuildFoliageRegion(FIntRect(0, 0, XSize, YSize),
+        [this, &NoiseMap](int32 X, int32 Y) { return GetVertexHeight(NoiseMap[X][Y]); },
+        [this](int32 X, int32 Y) { return BiomeMap[X][Y]; });
+}
+
+
+void ADiamondSquare::RegenerateRegion(FIntPoint Min, FIntPoint Max)
+{
+    // The noise and biome maps are dropped after construction, so the region is read back from their resident copies
+    const TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe> Field = GetHeightField();
+    const TSharedPtr<const FBiomeRunMap, ESPMode::ThreadSafe> Runs = GetBiomeRuns();
+    if (!Field.IsValid() || !Runs.IsValid() || Field->GetSizeX() != XSize || Field->GetSizeY() != YSize)
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("RegenerateRegion needs a terrain built at the current size."));
+        return;
+    }
+
+    DIAMONDSQUARE_STEP_SCOPE(Foliage);
+    RebuildFoliageRegion(FIntRect(Min, Max),
+        [&Field](int32 X, int32 Y) { return Field->GetSample(X, Y); },
+        [&Runs](int32 X, int32 Y)
+        {
+            ECell Biome = ECell::Ocean;
+            Runs->GetBiome(X, Y, Biome);
+            return Biome;
+        });
+}
+
+
+void ADiamondSquare::RebuildFoliageRegion(const FIntRect& CellRegion, TFunctionRef<float(int32, int32)> GetCellHeight, TFunctionRef<ECell(int32, int32)> GetCellBiome)
+{
+    const int32 ClusterSize = FMath::Max(FoliageClusterSize, 1);
+    const int32 NumClustersX = FMath::DivideAndRoundUp(XSize, ClusterSize);
+    const int32 NumClustersY = FMath::DivideAndRoundUp(YSize, ClusterSize);
+
+    // The cluster grid depends on the map size, so a resize invalidates every existing cluster
+    if (NumClustersX != FoliageClustersX || NumClustersY != FoliageClustersY)
+    {
+        ResetFoliageClusters();
+        FoliageClustersX = NumClustersX;
+        FoliageClustersY = NumClustersY;
+        FoliageClusters.SetNumZeroed(NumClustersX * NumClustersY * (int32)EFoliageKind::Num);
+    }
+
+    const int32 MinX = FMath::Max(CellRegion.Min.X, 0);
+    const int32 MinY = FMath::Max(CellRegion.Min.Y, 0);
+    const int32 MaxX = FMath::Min(CellRegion.Max.X, XSize);
+    const int32 MaxY = FMath::Min(CellRegion.Max.Y, YSize);
+    if (MinX >= MaxX || MinY >= MaxY)
+    {
+        return;
+    }
+
+    // Whole clusters are rebuilt so each one's instances and cluster tree stay consistent
+    for (int32 ClusterX = MinX / ClusterSize; ClusterX <= (MaxX - 1) / ClusterSize; ++ClusterX)
+    {
+        for (int32 ClusterY = MinY / ClusterSize; ClusterY <= (MaxY - 1) / ClusterSize; ++ClusterY)
+        {
+            const int32 StartX = ClusterX * ClusterSize;
+            const int32 StartY = ClusterY * ClusterSize;
+            const int32 EndX = FMath::Min(StartX + ClusterSize, XSize);
+            const int32 EndY = FMath::Min(StartY + ClusterSize, YSize);
+
+            for (int32 KindIndex = 0; KindIndex < (int32)EFoliageKind::Num; ++KindIndex)
+            {
+                const EFoliageKind Kind = (EFoliageKind)KindIndex;
+                UHierarchicalInstancedStaticMeshComponent* Cluster = FoliageClusters[GetFoliageClusterIndex(ClusterX, ClusterY, Kind)];
+
+                if (!GetFoliageMesh(Kind))
                 {
-                    TreeMeshComponent->AddInstance(FTransform(Rotation, Location, VectorScale));
+                    if (Cluster)
+                    {
+                        Cluster->ClearInstances();
+                    }
+                    continue;
                 }
-            case ECell::Savannah:
-                if (FMath::RandRange(0.0f, 1.0f) < 0.01f) // Low probability for buildings
+
+                // Seed each cluster independently so rebuilding one region reproduces the same layout
+                FRandomStream ClusterRng(HashCombine(HashCombine(GetTypeHash(Seed), GetTypeHash(FIntPoint(ClusterX, ClusterY))), GetTypeHash(KindIndex)));
+                TArray<FTransform> Transforms;
+                TMap<ECell, int32> BiomeInstanceCounts;
+
+                GenerationCore::ScatterFoliage(StartX, EndX, StartY, EndY,
+                    [this, Kind, &GetCellBiome](int32 X, int32 Y) { return GetFoliageDensity(GetCellBiome(X, Y), Kind); },
+                    ClusterRng,
+                    [this, &GetCellHeight, &GetCellBiome, &Transforms, &BiomeInstanceCounts](int32 X, int32 Y, float Yaw)
+                    {
+                        FVector Location(X * Scale, Y * Scale, GetCellHeight(X, Y));
+                        FRotator Rotation(0.0f, Yaw, 0.0f); // Random rotation for variation
+                        FVector VectorScale(5.0f, 5.0f, 5.0f); // Scale can be adjusted based on the object and biome
+                        Transforms.Add(FTransform(Rotation, Location, VectorScale));
+                        BiomeInstanceCounts.FindOrAdd(GetCellBiome(X, Y))++;
+                    });
+
+                if (Transforms.Num() == 0)
                 {
-                    TreeMeshComponent->AddInstance(FTransform(Rotation, Location, VectorScale));
+                    if (Cluster)
+                    {
+                        Cluster->ClearInstances();
+                    }
+                    continue;
                 }
-                // Add a building instance with some probability
-                if (FMath::RandRange(0.0f, 1.0f) < 0.01f) // Low probability for buildings
+
+                // Cull and LOD settings follow the biome that contributed most of the cluster's instances
+                ECell DominantBiome = ECell::Land;
+                int32 MaxCount = 0;
+                for (const auto& Kvp : BiomeInstanceCounts)
                 {
-                    //BuildingMeshComponent->AddInstance(FTransform(Rotation, Location, Scale));
+                    if (Kvp.Value > MaxCount)
+                    {
+                        DominantBiome = Kvp.Key;
+                        MaxCount = Kvp.Value;
+                    }
                 }
-                break;
+
+                int32 StartCull = 0;
+                int32 EndCull = 0;
+                float LODDistanceScale = 1.0f;
+                GetFoliageCullSettings(DominantBiome, Kind, StartCull, EndCull, LODDistanceScale);
+
+                Cluster = GetOrCreateFoliageCluster(ClusterX, ClusterY, Kind);
+                Cluster->ClearInstances();
+                Cluster->SetCullDistances(StartCull, EndCull);
+                Cluster->InstanceLODDistanceScale = LODDistanceScale;
+                Cluster->AddInstances(Transforms, false);
+                INC_DWORD_STAT_BY(STAT_DiamondSquare_InstancesPlaced, Transforms.Num());
+                CSV_CUSTOM_STAT(DiamondSquare, InstancesPlaced, Transforms.Num(), ECsvCustomStatOp::Accumulate);
+                Cluster->BuildTreeIfOutdated(true, false);
+            }
+        }
+    }
+}
+
+
+void ADiamondSquare::ResetFoliageClusters()
+{
+    for (UHierarchicalInstancedStaticMeshComponent* Cluster : FoliageClusters)
+    {
+        if (Cluster)
+        {
+            Cluster->DestroyComponent();
+        }
+    }
+    FoliageClusters.Reset();
+    FoliageClustersX = 0;
+    FoliageClustersY = 0;
+}
+
+
+int32 ADiamondSquare::GetFoliageClusterIndex(int32 ClusterX, int32 ClusterY, EFoliageKind Kind) const
+{
+    return (ClusterX * FoliageClustersY + ClusterY) * (int32)EFoliageKind::Num + (int32)Kind;
+}
+
+
+UHierarchicalInstancedStaticMeshComponent* ADiamondSquare::GetOrCreateFoliageCluster(int32 ClusterX, int32 ClusterY, EFoliageKind Kind)
+{
+    UHierarchicalInstancedStaticMeshComponent*& Cluster = FoliageClusters[GetFoliageClusterIndex(ClusterX, ClusterY, Kind)];
+    if (!Cluster)
+    {
+        const FName ClusterName = MakeUniqueObjectName(this, UHierarchicalInstancedStaticMeshComponent::StaticClass(),
+            *FString::Printf(TEXT("Foliage_%d_%d_%d"), ClusterX, ClusterY, (int32)Kind));
+        Cluster = NewObject<UHierarchicalInstancedStaticMeshComponent>(this, ClusterName, RF_Transactional);
+        Cluster->CreationMethod = EComponentCreationMethod::Instance;
+        // The tree is rebuilt once per cluster after all of its instances are added
+        Cluster->bAutoRebuildTreeOnInstanceChanges = false;
+        Cluster->SetupAttachment(ProceduralMesh);
+        AddInstanceComponent(Cluster);
+        Cluster->RegisterComponent();
+    }
+
+    UStaticMesh* Mesh = GetFoliageMesh(Kind);
+    if (Cluster->GetStaticMesh() != Mesh)
+    {
+        Cluster->SetStaticMesh(Mesh);
+    }
+    return Cluster;
+}
+
+
+UStaticMesh* ADiamondSquare::GetFoliageMesh(EFoliageKind Kind) const
+{
+    switch (Kind)
+    {
+    case EFoliageKind::Tree:
+        return TreeMesh;
+    case EFoliageKind::Rock:
+        return RockMesh;
+    case EFoliageKind::Building:
+        return BuildingMesh;
+    default:
+        return nullptr;
+    }
+}
+
+
+float ADiamondSquare::GetFoliageDensity(ECell BiomeType, EFoliageKind Kind) const
+{
+    // Probability per grid cell of placing an object of the given kind
+    switch (BiomeType)
+    {
+    case ECell::Forest:
+    case ECell::Taiga:
+        return Kind == EFoliageKind::Tree ? 0.01f : 0.0f;
+    case ECell::Mountain:
+    case ECell::Highland:
+        return Kind == EFoliageKind::Rock ? 0.01f : 0.0f;
+    case ECell::Plains:
+    case ECell::Savannah:
+        return Kind == EFoliageKind::Rock ? 0.0f : 0.01f; // Scattered trees and the odd building
+    default:
+        return 0.0f;
+    }
+}
+
+
+void ADiamondSquare::GetFoliageCullSettings(ECell BiomeType, EFoliageKind Kind, int32& StartCull, int32& EndCull, float& LODDistanceScale) const
+{
+    // Base distances are in grid cells so they scale with the terrain
+    float StartCells = 40.0f;
+    float EndCells = 70.0f;
+    LODDistanceScale = 1.0f;
+
+    switch (Kind)
+    {
+    case EFoliageKind::Rock:
+        StartCells = 60.0f;
+        EndCells = 120.0f;
+        break;
+    case EFoliageKind::Building:
+        StartCells = 80.0f;
+        EndCells = 160.0f;
+        LODDistanceScale = 1.5f;
+        break;
+    default:
+        break;
+    }
+
+    switch (BiomeType)
+    {
+    case ECell::Forest:
+    case ECell::Taiga:
+        // Dense canopy hides distant instances, so cull and drop LODs early
+        StartCells *= 0.6f;
+        EndCells *= 0.6f;
+        LODDistanceScale *= 0.75f;
+        break;
+    case ECell::Plains:
+    case ECell::Savannah:
+        // Open ground keeps objects visible much further out
+        StartCells *= 1.5f;
+        EndCells *= 1.5f;
+        break;
+    case ECell::Mountain:
+    case ECell::Highland:
+        StartCells *= 2.0f;
+        EndCells *= 2.0f;
+        LODDistanceScale *= 1.25f;
+        break;
+    default:
+        break;
+    }
+
+    StartCull = FMath::RoundToInt(StartCells * Scale);
+    EndCull = FMath::RoundToInt(EndCells * Scale);
+}
+
+
+float ADiamondSquare::GetVertexHeight(float NoiseValue) const
+{
+    return GenerationCore::GetVertexHeight(FGenerationCoreAdapter::MakeMeshSettings(*this), NoiseValue);
+}
+
+
+void ADiamondSquare::CreateTriangles()
+{
+    DIAMONDSQUARE_STEP_SCOPE(Triangles);
+
+    // Quads entirely under the cave layer are left out, as the cave layer has its own surface there
+    const int32 FirstIndex = Triangles.Num();
+    Triangles.AddUninitialized(int32(GenerationCore::GetMaxGridTriangleIndices(XSize, YSize)));
+    const int64 NumIndices = GenerationCore::BuildGridTriangles(XSize, YSize, CaveMask.Num() > 0 ? CaveMask.GetData() : nullptr, Triangles.GetData() + FirstIndex);
+    Triangles.SetNum(FirstIndex + int32(NumIndices), false);
+    INC_DWORD_STAT_BY(STAT_DiamondSquare_TrianglesEmitted, NumIndices / 3);
+    CSV_CUSTOM_STAT(DiamondSquare, TrianglesEmitted, int32(NumIndices / 3), ECsvCustomStatOp::Accumulate);
+}
+
+
+void ADiamondSquare::CreateVertices(const TArray<TArray<float>>& NoiseMap)
+{
+    DIAMONDSQUARE_STEP_SCOPE(Vertices);
+    // Prepare the Colors array for new data
+    Colors.Empty();
+    FLinearColor Color;
+    // Check if the ProceduralMesh is valid
+    if (ProceduralMesh)
+    {
+        // Positions and UVs come from the generation core, in rows on worker threads
+        const int32 NumVertices = XSize * YSize;
+        GenerationCore::TGrid<float> Noise(XSize, YSize);
+        for (int X = 0; X < XSize; ++X)
+        {
+            FMemory::Memcpy(Noise.Row(X), NoiseMap[X].GetData(), YSize * sizeof(float));
+        }
+        const GenerationCore::FGridMeshSettings MeshSettings = FGenerationCoreAdapter::MakeMeshSettings(*this);
+        TArray<float> Positions;
+        TArray<float> UVs;
+        Positions.SetNumUninitialized(NumVertices * 3);
+        UVs.SetNumUninitialized(NumVertices * 2);
+        ParallelFor(XSize, [&](int32 X)
+            {
+                GenerationCore::BuildGridVertices(Noise, MeshSettings, X, X + 1, Positions.GetData(), UVs.GetData());
+            });
+
+        Vertices.Reserve(NumVertices);
+        UV0.Reserve(NumVertices);
+        Colors.Reserve(NumVertices);
+        for (int X = 0; X < XSize; ++X)
+        {
+            for (int Y = 0; Y < YSize; ++Y)
+            {
+                // Determine the color based on biome and height
+                Color = GetColorBasedOnBiomeAndHeight(NoiseMap[X][Y], BiomeMap[X][Y]);
+                Colors.Add(Color.ToFColor(false));
+
+                const int32 Index = X * YSize + Y;
+                Vertices.Add(FVector(Positions[Index * 3], Positions[Index * 3 + 1], Positions[Index * 3 + 2]));
+                UV0.Add(FVector2D(UVs[Index * 2], UVs[Index * 2 + 1]));
+            }
+        }
+
+        // Initialize normals and tangents for the vertices
+        Normals.Init(FVector(0.0f, 0.0f, 1.0f), Vertices.Num());
+        Tangents.Init(FProcMeshTangent(1.0f, 0.0f, 0.0f), Vertices.Num());
+
+        // Create the mesh section with the generated data
+        //ProceduralMesh->CreateMeshSection(0, Vertices, Triangles, Normals, UV0, Colors, Tangents, true);
+    }
+}
+
+
+void ADiamondSquare::BakeAmbientOcclusion(const TArray<TArray<float>>& NoiseMap)
+{
+    if (Colors.Num() != XSize * YSize || Scale <= 0.0f)
+    {
+        return;
+    }
+    DIAMONDSQUARE_STEP_SCOPE(AmbientOcclusion);
+
+    // Horizons are angles, so heights go in the same units as the grid spacing
+    TArray<float> Heights;
+    Heights.SetNumUninitialized(XSize * YSize);
+    for (int32 X = 0; X < XSize; ++X)
+    {
+        for (int32 Y = 0; Y < YSize; ++Y)
+        {
+            Heights[X * YSize + Y] = GetVertexHeight(NoiseMap[X][Y]) / Scale;
+        }
+    }
+
+    TArray<float> Visibility;
+    FTerrainHorizonAO::Bake(Heights, XSize, YSize, AmbientOcclusionDirections, Visibility);
+    for (int32 Index = 0; Index < Colors.Num(); ++Index)
+    {
+        Colors[Index].A = uint8(FMath::RoundToInt(FMath::Clamp(Visibility[Index], 0.0f, 1.0f) * 255.0f));
+    }
+}
+
+
+float ADiamondSquare::GetBaseNoise(int32 X, int32 Y) const
+{
+    return GenerationCore::FractalNoise(FGenerationCoreAdapter::MakeNoiseSettings(*this), X, Y, FGenerationCoreAdapter::FEngineNoise());
+}
+
+
+TArray<TArray<float>> ADiamondSquare::GeneratePerlinNoiseMap()
+{
+
+    // Reset and create the BiomeMap
+    BiomeMap.Empty();
+    BiomeMap = TestIsland();
+    DIAMONDSQUARE_STEP_SCOPE(NoiseMap);
+
+    // Blur the per-biome height ranges so neighbouring biomes meet in a slope instead of a step
+    TArray<float> RangeLow;
+    TArray<float> RangeHigh;
+    const bool bBlendBiomes = BiomeBlendRadius > 0 && XSize > 0 && YSize > 0;
+    if (bBlendBiomes)
+    {
+        RangeLow.SetNumUninitialized(XSize * YSize);
+        RangeHigh.SetNumUninitialized(XSize * YSize);
+        for (int X = 0; X < XSize; ++X)
+        {
+            for (int Y = 0; Y < YSize; ++Y)
+            {
+                const FVector2f Range = GetBiomeHeightRange(BiomeMap[X][Y]);
+                RangeLow[X * YSize + Y] = Range.X;
+                RangeHigh[X * YSize + Y] = Range.Y;
+            }
+        }
+        FTerrainBoxBlur::Blur(RangeLow, XSize, YSize, BiomeBlendRadius, BiomeBlendPasses);
+        FTerrainBoxBlur::Blur(RangeHigh, XSize, YSize, BiomeBlendRadius, BiomeBlendPasses);
+    }
+
+    // Base noise of every vertex from the generation core, in rows on worker threads
+    GenerationCore::TGrid<float> BaseNoise(XSize, YSize);
+    const GenerationCore::FFractalNoiseSettings NoiseSettings = FGenerationCoreAdapter::MakeNoiseSettings(*this);
+    ParallelFor(XSize, [&](int32 X)
+        {
+            GenerationCore::FillFractalNoise(NoiseSettings, BaseNoise, X, X + 1, FGenerationCoreAdapter::FEngineNoise());
+        });
+
+    // Initialize the NoiseMap array
+    TArray<TArray<float>> NoiseMap;
+    NoiseMap.Init(TArray<float>(), XSize);
+
+    // Iterate over the grid to generate noise values
+    for (int X = 0; X < XSize; ++X)
+    {
+        NoiseMap[X].Init(0.0f, YSize);
+        for (int Y = 0; Y < YSize; ++Y)
+        {
+            float NoiseHeight = BaseNoise(X, Y);
+
+            // Adjust noise height based on biome
+            if (bBlendBiomes)
+            {
+                NoiseHeight = FMath::Lerp(RangeLow[X * YSize + Y], RangeHigh[X * YSize + Y], NoiseHeight);
+            }
+            else
+            {
+                ECell BiomeChar = BiomeMap[X][Y];
+                NoiseHeight = GetInterpolatedHeight(NoiseHeight, BiomeChar);
+            }
+
+            // Clamp the noise value to ensure it's within the expected range
+            NoiseMap[X][Y] = FMath::Clamp(NoiseHeight, 0.0f, 1.0f);
+        }
+    }
+    // Land rises from the waterline over ShoreFalloff cells instead of starting at its full height
+    if (ShoreFalloff > 0.0f && XSize > 0 && YSize > 0)
+    {
+        const TArray<uint8> Water = GetWaterMask();
+        const TArray<float> ToWater = FBiomeDistance::SquaredDistance(Water, XSize, YSize, false);
+        for (int X = 0; X < XSize; ++X)
+        {
+            for (int Y = 0; Y < YSize; ++Y)
+            {
+                NoiseMap[X][Y] *= FMath::SmoothStep(0.0f, ShoreFalloff, FMath::Sqrt(ToWater[X * YSize + Y]));
+            }
+        }
+    }
+
+    // Return the generated Perlin noise map
+    return NoiseMap;
+}
+
+
+TArray<uint8> ADiamondSquare::GetWaterMask() const
+{
+    TArray<uint8> Water;
+    Water.SetNumUninitialized(XSize * YSize);
+    for (int X = 0; X < XSize; ++X)
+    {
+        for (int Y = 0; Y < YSize; ++Y)
+        {
+            Water[X * YSize + Y] = (OceanCells | DeepOceanCells).Contains(BiomeMap[X][Y]) ? 1 : 0;
+        }
+    }
+    return Water;
+}
+
+
+void ADiamondSquare::PublishBiomeLookups()
+{
+    // The full map is only held during construction; the runs keep it for lookups at a fraction of the size
+    const TSharedPtr<const FBiomeRunMap, ESPMode::ThreadSafe> Runs = MakeShared<FBiomeRunMap, ESPMode::ThreadSafe>(BiomeMap);
+    UE_LOG(LogDiamondSquare, Verbose, TEXT("Biome map: %d x %d cells in %d runs of %llu bytes"), Runs->GetSize().X, Runs->GetSize().Y, Runs->GetNumRuns(), uint64(Runs->GetAllocatedSize()));
+    {
+        FScopeLock Lock(&BiomeQueryLock);
+        BiomeRuns = Runs;
+    }
+    LabelIslands(*Runs);
+}
+
+
+void ADiamondSquare::LabelIslands(const FBiomeRunMap& Runs)
+{
+    DIAMONDSQUARE_STEP_SCOPE(Islands);
+    TArray<uint8> Land = Runs.MakeMask(IslandWaterCells);
+    for (uint8& Class : Land)
+    {
+        Class ^= 1;
+    }
+    const FIntPoint Size = Runs.GetSize();
+    const TSharedPtr<const FBiomeRegions, ESPMode::ThreadSafe> NewIslands = MakeShared<FBiomeRegions, ESPMode::ThreadSafe>(FBiomeRegions::Label(Land, Size.X, Size.Y));
+    UE_LOG(LogDiamondSquare, Verbose, TEXT("Labelled %d land and water regions"), NewIslands->Regions.Num());
+
+    FScopeLock Lock(&BiomeQueryLock);
+    Islands = NewIslands;
+}
+
+
+// Relative paths are taken from the project's Saved directory
+static FString GetSavedPath(const FString& Path)
+{
+    return FPaths::ConvertRelativePathToFull(FPaths::IsRelative(Path) ? FPaths::ProjectSavedDir() / Path : Path);
+}
+
+
+void ADiamondSquare::MakeWorldPlanes(const TArray<TArray<float>>& NoiseMap, FTerrainWorldPlanes& OutWorld) const
+{
+    OutWorld.Init(XSize, YSize);
+    for (int32 X = 0; X < XSize; ++X)
+    {
+        for (int32 Y = 0; Y < YSize; ++Y)
+        {
+            OutWorld.Heights[X * YSize + Y] = uint16(FMath::RoundToInt(FMath::Clamp(NoiseMap[X][Y], 0.0f, 1.0f) * 65535.0f));
+            OutWorld.Biomes[X * YSize + Y] = uint8(BiomeMap[X][Y]);
+        }
+    }
+}
+
+
+bool ADiamondSquare::SaveWorldFile(const TArray<TArray<float>>& NoiseMap) const
+{
+    FTerrainWorldPlanes World;
+    MakeWorldPlanes(NoiseMap, World);
+    return FTerrainWorldFile::Save(GetSavedPath(WorldFilePath), World, WorldFileChunkSize);
+}
+
+
+TArray<TArray<float>> ADiamondSquare::GenerateNoiseMap()
+{
+    TArray<TArray<float>> NoiseMap = GeneratePerlinNoiseMap();
+    if (Erosion.bEnabled)
+    {
+        ErodeNoiseMap(NoiseMap);
+    }
+    if (bGenerateRivers)
+    {
+        CarveRivers(NoiseMap);
+    }
+    return NoiseMap;
+}
+
+
+void ADiamondSquare::GenerateWorld(FTerrainWorldPlanes& OutWorld)
+{
+    const TArray<TArray<float>> NoiseMap = GenerateNoiseMap();
+    MakeWorldPlanes(NoiseMap, OutWorld);
+    BiomeMap.Reset();
+}
+
+
+bool ADiamondSquare::LoadWorldFile(TArray<TArray<float>>& OutNoiseMap)
+{
+    DIAMONDSQUARE_STEP_SCOPE(LoadWorldFile);
+    const FString Path = GetSavedPath(WorldFilePath);
+
+    FTerrainWorldFile File;
+    if (!File.Open(Path))
+    {
+        return false;
+    }
+    if (File.GetRows() > 2048 || File.GetCols() > 2048)
+    {
+        UE_LOG(LogTemp, Error, TEXT("%s holds a %d x %d world, larger than the mesh grid allows"), *Path, File.GetRows(), File.GetCols());
+        return false;
+    }
+
+    FTerrainWorldPlanes World;
+    if (!File.LoadAll(World))
+    {
+        return false;
+    }
+    for (const uint8 Biome : World.Biomes)
+    {
+        if (Biome > uint8(ECell::Mesa))
+        {
+            UE_LOG(LogTemp, Error, TEXT("%s holds an unknown biome %d"), *Path, Biome);
+            return false;
+        }
+    }
+
+    XSize = World.Rows;
+    YSize = World.Cols;
+    InitializeSeed();
+    OutNoiseMap.Init(TArray<float>(), XSize);
+    BiomeMap.Init(TArray<ECell>(), XSize);
+    for (int32 X = 0; X < XSize; ++X)
+    {
+        OutNoiseMap[X].SetNumUninitialized(YSize);
+        BiomeMap[X].SetNumUninitialized(YSize);
+        for (int32 Y = 0; Y < YSize; ++Y)
+        {
+            OutNoiseMap[X][Y] = World.Heights[X * YSize + Y] / 65535.0f;
+            BiomeMap[X][Y] = ECell(World.Biomes[X * YSize + Y]);
+        }
+    }
+
+    UE_LOG(LogDiamondSquare, Log, TEXT("Loaded %d x %d world from %s"), XSize, YSize, *Path);
+    return true;
+}
+
+
+void ADiamondSquare::GenerateOffline()
+{
+    GenerateToDisk(GetSavedPath(OfflineOutputPath), OfflineXSize, OfflineYSize, int64(OfflineMemoryBudgetMB) * 1024 * 1024);
+}
+
+
+bool ADiamondSquare::GenerateToDisk(const FString& BasePath, int32 SizeX, int32 SizeY, int64 MemoryBudgetBytes)
+{
+    double StartTime = FPlatformTime::Seconds();
+    if (SizeX <= 0 || SizeY <= 0)
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Offline map size %d x %d is empty"), SizeX, SizeY);
+        return false;
+    }
+
+    // The stages before the trailing tile stages run in memory as usual; extra zooms below make up the size
+    InitializeSeed();
+    FBiomePipelinePlan Plan;
+    PlanBiomePipeline(FIntPoint::ZeroValue, Plan);
+
+    // Their board is a fixed fraction of the pipeline's output, so its memory does not grow with the map.
+    // A few boards of its size are alive at once while the pipeline runs.
+    int32 RootSize = Plan.OutputSize;
+    if (Plan.Steps.Num() > 0 && Plan.Steps.Last().Kind == EBiomePlanStepKind::Tiled)
+    {
+        for (const FBiomeStageDesc& Desc : Plan.Steps.Last().Stages)
+        {
+            RootSize /= Desc.Stage == EBiomeStage::Zoom ? 2 : 1;
+        }
+    }
+    const int64 RootBytes = 4 * int64(RootSize) * RootSize * sizeof(ECell);
+
+    // Rows around each strip that the biome blend and the shore falloff read, so strips match a whole-map run
+    const int32 Halo = GetRegionHalo();
+    int64 StripRows = (MemoryBudgetBytes - RootBytes) / (int64(SizeY) * GetRegionBytesPerCell()) - 2 * Halo;
+    StripRows = FMath::Min<int64>(StripRows, FMath::Min<int64>(SizeX, MAX_int32 / SizeY - 2 * Halo));
+    if (StripRows < 1)
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("A %lld MB budget cannot hold a %d x %d biome board and a strip of %d columns with %d halo rows"),
+            MemoryBudgetBytes / (1024 * 1024), RootSize, RootSize, SizeY, Halo);
+        return false;
+    }
+
+    TArray<TArray<ECell>> Root;
+    TArray<FBiomeTileStage> TrailingStages;
+    RunRegionPipeline(Plan, FIntPoint(SizeX, SizeY), Root, TrailingStages);
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(BasePath));
+    const FString HeightsPath = BasePath + TEXT(".r16");
+    const FString BiomesPath = BasePath + TEXT(".biome");
+    TUniquePtr<IFileHandle> HeightsFile(PlatformFile.OpenWrite(*HeightsPath));
+    TUniquePtr<IFileHandle> BiomesFile(PlatformFile.OpenWrite(*BiomesPath));
+    if (!HeightsFile || !BiomesFile)
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Cannot open %s or %s for writing"), *HeightsPath, *BiomesPath);
+        return false;
+    }
+
+    TArray<ECell> Biomes;
+    TArray<uint16> Heights;
+    int32 NumStrips = 0;
+    const uint64 StartUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+    for (int32 Start = 0; Start < SizeX; Start += int32(StripRows))
+    {
+        double StripStartTime = FPlatformTime::Seconds();
+        const int32 End = FMath::Min(Start + int32(StripRows), SizeX);
+        GenerateRegion(Root, TrailingStages, FIntPoint(SizeX, SizeY), FIntRect(Start, 0, End, SizeY), Biomes, Heights);
+
+        // The estimate of GetRegionBytesPerCell sized the strips; the first one shows whether it holds here
+        if (NumStrips == 0)
+        {
+            const uint64 UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+            const int64 StripBytes = UsedPhysical > StartUsedPhysical ? int64(UsedPhysical - StartUsedPhysical) : 0;
+            if (RootBytes + StripBytes > MemoryBudgetBytes)
+            {
+                UE_LOG(LogDiamondSquare, Warning, TEXT("The first strip grew the process by %lld MB, past the %lld MB budget; lower the budget to keep within it"),
+                    StripBytes / (1024 * 1024), MemoryBudgetBytes / (1024 * 1024));
+            }
+        }
+
+        // Strips are made one after another; each is written at its own rows, which also makes the files full size
+        const int64 FirstCell = int64(Start) * SizeY;
+        const int64 NumCells = int64(End - Start) * SizeY;
+        const bool bWritten = HeightsFile->Seek(FirstCell * sizeof(uint16))
+            && HeightsFile->Write(reinterpret_cast<const uint8*>(Heights.GetData()), NumCells * sizeof(uint16))
+            && BiomesFile->Seek(FirstCell * sizeof(ECell))
+            && BiomesFile->Write(reinterpret_cast<const uint8*>(Biomes.GetData()), NumCells * sizeof(ECell));
+        if (!bWritten)
+        {
+            UE_LOG(LogDiamondSquare, Error, TEXT("Writing rows %d to %d of %s failed"), Start, End, *BasePath);
+            return false;
+        }
+
+        ++NumStrips;
+        double StripEndTime = FPlatformTime::Seconds();
+        UE_LOG(LogDiamondSquare, Verbose, TEXT("Offline: rows %d to %d of %d in %f seconds"), Start, End, SizeX, StripEndTime - StripStartTime);
+    }
+
+    // Closing the handles flushes them
+    HeightsFile.Reset();
+    BiomesFile.Reset();
+
+    double EndTime = FPlatformTime::Seconds();
+    UE_LOG(LogDiamondSquare, Log, TEXT("GenerateToDisk wrote %d x %d cells in %d strips of %lld rows to %s in %f seconds"),
+        SizeX, SizeY, NumStrips, StripRows, *BasePath, EndTime - StartTime);
+    return true;
+}
+
+
+void ADiamondSquare::PrepareRegions(const FIntPoint& MapSize, TArray<TArray<ECell>>& OutRoot, TArray<FBiomeTileStage>& OutStages)
+{
+    InitializeSeed();
+    FBiomePipelinePlan Plan;
+    PlanBiomePipeline(FIntPoint::ZeroValue, Plan);
+    RunRegionPipeline(Plan, MapSize, OutRoot, OutStages);
+}
+
+
+void ADiamondSquare::RunRegionPipeline(const FBiomePipelinePlan& Plan, const FIntPoint& MapSize, TArray<TArray<ECell>>& OutRoot, TArray<FBiomeTileStage>& OutStages)
+{
+    OutStages.Reset();
+    OutRoot = RunBiomePipeline(Plan, OutStages);
+
+    // Past the planner's largest board, further tiled Zoom stages grow the map to the requested size
+    int32 OutputSize = Plan.OutputSize;
+    while (OutputSize < FMath::Max(MapSize.X, MapSize.Y))
+    {
+        FBiomeTileStage& Stage = OutStages.AddDefaulted_GetRef();
+        Stage.Kind = EBiomeTileStageKind::Zoom;
+        Stage.Seed = NextZoomSeed();
+        OutputSize *= 2;
+    }
+}
+
+
+int32 ADiamondSquare::GetRegionHalo() const
+{
+    return FMath::Max(BiomeBlendRadius > 0 ? BiomeBlendRadius * BiomeBlendPasses : 0, ShoreFalloff > 0.0f ? FMath::CeilToInt(ShoreFalloff) : 0);
+}
+
+
+int64 ADiamondSquare::GetRegionBytesPerCell() const
+{
+    // The window's biomes, and the tiles the column blocks are made in with the smaller levels before them
+    int64 Bytes = 3 * sizeof(ECell);
+    if (BiomeBlendRadius > 0)
+    {
+        // Both height ranges, and the summed-area table each is blurred through in turn
+        Bytes += 2 * sizeof(float) + sizeof(double);
+    }
+    if (ShoreFalloff > 0.0f)
+    {
+        // The water mask and its squared distances
+        Bytes += sizeof(uint8) + sizeof(float);
+    }
+
+    // The region's heights and biomes
+    return Bytes + sizeof(uint16) + sizeof(ECell);
+}
+
+
+void ADiamondSquare::GenerateRegion(const TArray<TArray<ECell>>& Root, const TArray<FBiomeTileStage>& Stages, const FIntPoint& MapSize, const FIntRect& Region, TArray<ECell>& OutBiomes, TArray<uint16>& OutHeights) const
+{
+    // The window is the region plus the halo the biome blend and the shore falloff read, clipped to the map
+    const int32 Halo = GetRegionHalo();
+    const FIntRect Window(
+        FMath::Max(Region.Min.X - Halo, 0),
+        FMath::Max(Region.Min.Y - Halo, 0),
+        FMath::Min(Region.Max.X + Halo, MapSize.X),
+        FMath::Min(Region.Max.Y + Halo, MapSize.Y));
+    const int32 WindowRows = Window.Max.X - Window.Min.X;
+    const int32 WindowCols = Window.Max.Y - Window.Min.Y;
+    const int32 WindowCells = WindowRows * WindowCols;
+    const int32 RegionRows = Region.Max.X - Region.Min.X;
+    const int32 RegionCols = Region.Max.Y - Region.Min.Y;
+
+    // Biomes of the window, in column blocks on worker threads. The tile server and the offline strips run many
+    // regions a frame, so their time accumulates into one CSV column; Insights shows each stage of each block.
+    TArray<ECell> Biomes;
+    Biomes.SetNumUninitialized(WindowCells);
+    {
+        DIAMONDSQUARE_STEP_SCOPE(RegionTileStages);
+        const double StepStartTime = FPlatformTime::Seconds();
+        const int32 BlockCols = FMath::Max(BiomeTileSize, 1);
+        ParallelFor(FMath::DivideAndRoundUp(WindowCols, BlockCols), [&](int32 Block)
+            {
+                const FIntRect Rect(Window.Min.X, Window.Min.Y + Block * BlockCols, Window.Max.X, FMath::Min(Window.Min.Y + (Block + 1) * BlockCols, Window.Max.Y));
+                FBiomeTile Tile;
+                FBiomeTiles::RunTile(Root, Stages, Rect, Tile);
+                for (int32 R = Rect.Min.X; R < Rect.Max.X; ++R)
+                {
+                    FMemory::Memcpy(&Biomes[(R - Window.Min.X) * WindowCols + (Rect.Min.Y - Window.Min.Y)], &Tile.At(R, Rect.Min.Y), Tile.NumCols * sizeof(ECell));
+                }
+            });
+        RecordBiomeStep(TEXT("BiomeRegionTileStages"), StepStartTime, WindowCells, true);
+    }
+
+    const bool bBlendBiomes = BiomeBlendRadius > 0;
+    TArray<float> RangeLow;
+    TArray<float> RangeHigh;
+    if (bBlendBiomes)
+    {
+        RangeLow.SetNumUninitialized(WindowCells);
+        RangeHigh.SetNumUninitialized(WindowCells);
+        for (int32 Index = 0; Index < WindowCells; ++Index)
+        {
+            const FVector2f Range = GetBiomeHeightRange(Biomes[Index]);
+            RangeLow[Index] = Range.X;
+            RangeHigh[Index] = Range.Y;
+        }
+        FTerrainBoxBlur::Blur(RangeLow, WindowRows, WindowCols, BiomeBlendRadius, BiomeBlendPasses);
+        FTerrainBoxBlur::Blur(RangeHigh, WindowRows, WindowCols, BiomeBlendRadius, BiomeBlendPasses);
+    }
+    TArray<float> ToWater;
+    if (ShoreFalloff > 0.0f)
+    {
+        TArray<uint8> Water;
+        Water.SetNumUninitialized(WindowCells);
+        for (int32 Index = 0; Index < WindowCells; ++Index)
+        {
+            Water[Index] = (OceanCells | DeepOceanCells).Contains(Biomes[Index]) ? 1 : 0;
+        }
+        ToWater = FBiomeDistance::SquaredDistance(Water, WindowRows, WindowCols, false);
+    }
+
+    // Same steps as GeneratePerlinNoiseMap, quantized to the full uint16 range
+    OutBiomes.SetNumUninitialized(RegionRows * RegionCols);
+    OutHeights.SetNumUninitialized(RegionRows * RegionCols);
+    ParallelFor(RegionRows, [&](int32 Row)
+        {
+            for (int32 Col = 0; Col < RegionCols; ++Col)
+            {
+                const int32 X = Region.Min.X + Row;
+                const int32 Y = Region.Min.Y + Col;
+                const int32 Index = (X - Window.Min.X) * WindowCols + (Y - Window.Min.Y);
+                float NoiseHeight = GetBaseNoise(X, Y);
+                if (bBlendBiomes)
+                {
+                    NoiseHeight = FMath::Lerp(RangeLow[Index], RangeHigh[Index], NoiseHeight);
+                }
+                else
+                {
+                    const FVector2f Range = GetBiomeHeightRange(Biomes[Index]);
+                    NoiseHeight = FMath::Lerp(Range.X, Range.Y, NoiseHeight);
+                }
+                NoiseHeight = FMath::Clamp(NoiseHeight, 0.0f, 1.0f);
+                if (ShoreFalloff > 0.0f)
+                {
+                    NoiseHeight *= FMath::SmoothStep(0.0f, ShoreFalloff, FMath::Sqrt(ToWater[Index]));
+                }
+                OutHeights[Row * RegionCols + Col] = uint16(FMath::RoundToInt(NoiseHeight * 65535.0f));
+                OutBiomes[Row * RegionCols + Col] = Biomes[Index];
+            }
+        });
+}
+
+
+void ADiamondSquare::ErodeNoiseMap(TArray<TArray<float>>& NoiseMap) const
+{
+    if (XSize < 2 || YSize < 2 || ZMultiplier <= 0.0f || ZExpo <= 0.0f)
+    {
+        return;
+    }
+
+    DIAMONDSQUARE_STEP_SCOPE(Erosion);
+
+    // Erode the shape the mesh will have: vertex heights over the grid spacing, so slopes are true slopes
+    TArray<float> Heights;
+    Heights.SetNumUninitialized(XSize * YSize);
+    for (int32 X = 0; X < XSize; ++X)
+    {
+        for (int32 Y = 0; Y < YSize; ++Y)
+        {
+            Heights[X * YSize + Y] = FMath::Pow(NoiseMap[X][Y] * ZMultiplier, ZExpo);
+        }
+    }
+
+    const FTerrainErosionStats Stats = FTerrainErosion::Erode(Heights, XSize, YSize, Erosion);
+    UE_LOG(LogDiamondSquare, Verbose, TEXT("Erosion ran %d hydraulic and %d thermal iterations"), Stats.HydraulicIterations, Stats.ThermalIterations);
+    if (Stats.HydraulicIterations < Erosion.HydraulicIterations || Stats.ThermalIterations < Erosion.ThermalIterations)
+    {
+        UE_LOG(LogDiamondSquare, Warning, TEXT("Erosion stopped at its %.1f second budget, so this terrain depends on machine speed; set Erosion.MaxSeconds to 0 for repeatable results"), Erosion.MaxSeconds);
+    }
+
+    const float InvExpo = 1.0f / ZExpo;
+    for (int32 X = 0; X < XSize; ++X)
+    {
+        for (int32 Y = 0; Y < YSize; ++Y)
+        {
+            NoiseMap[X][Y] = FMath::Clamp(FMath::Pow(FMath::Max(Heights[X * YSize + Y], 0.0f), InvExpo) / ZMultiplier, 0.0f, 1.0f);
+        }
+    }
+}
+
+
+void ADiamondSquare::CarveRivers(TArray<TArray<float>>& NoiseMap)
+{
+    if (XSize < 2 || YSize < 2)
+    {
+        return;
+    }
+    DIAMONDSQUARE_STEP_SCOPE(Rivers);
+
+    TArray<float> Heights;
+    TArray<uint8> Sea;
+    Heights.SetNumUninitialized(XSize * YSize);
+    Sea.SetNumUninitialized(XSize * YSize);
+    for (int32 X = 0; X < XSize; ++X)
+    {
+        for (int32 Y = 0; Y < YSize; ++Y)
+        {
+            Heights[X * YSize + Y] = NoiseMap[X][Y];
+            Sea[X * YSize + Y] = (OceanCells | DeepOceanCells).Contains(BiomeMap[X][Y]) ? 1 : 0;
+        }
+    }
+
+    const FTerrainFlow Flow = FTerrainHydrology::ComputeFlow(Heights, Sea, XSize, YSize);
+    TArray<uint8> Rivers;
+    FTerrainHydrology::CarveRivers(Flow, RiverThreshold, RiverDepth, Heights, Rivers);
+
+    int32 NumRiverCells = 0;
+    for (int32 X = 0; X < XSize; ++X)
+    {
+        for (int32 Y = 0; Y < YSize; ++Y)
+        {
+            if (Rivers[X * YSize + Y])
+            {
+                NoiseMap[X][Y] = FMath::Max(Heights[X * YSize + Y], 0.0f);
+                BiomeMap[X][Y] = ECell::River;
+                ++NumRiverCells;
             }
         }
     }
+
+    UE_LOG(LogDiamondSquare, Verbose, TEXT("Rivers: %d cells"), NumRiverCells);
 }
 
 
-void ADiamondSquare::CreateTriangles()
+void ADiamondSquare::BuildCaveMask()
 {
-    double StartTime = FPlatformTime::Seconds();
-    for (int X = 0; X < XSize - 1; ++X)
+    CaveMask.Reset();
+    if (!Caves.bEnabled || XSize < 2 || YSize < 2)
     {
-        for (int Y = 0; Y < YSize - 1; ++Y)
-        {
-            int VertexIndex = X * YSize + Y;
-
-            // First triangle (clockwise winding order)
-            Triangles.Add(VertexIndex);                  // Bottom left
-            Triangles.Add(VertexIndex + YSize + 1);      // Top right
-            Triangles.Add(VertexIndex + YSize);          // Top left
+        return;
+    }
+    DIAMONDSQUARE_STEP_SCOPE(CaveMask);
 
-            // Second triangle (clockwise winding order)
-            Triangles.Add(VertexIndex);                  // Bottom left
-            Triangles.Add(VertexIndex + 1);              // Bottom right
-            Triangles.Add(VertexIndex + YSize + 1);      // Top right
+    bool bAnyCaves = false;
+    CaveMask.SetNumUninitialized(XSize * YSize);
+    for (int32 X = 0; X < XSize; ++X)
+    {
+        for (int32 Y = 0; Y < YSize; ++Y)
+        {
+            const bool bCave = CaveCells.Contains(BiomeMap[X][Y]);
+            CaveMask[X * YSize + Y] = bCave ? 1.0f : 0.0f;
+            bAnyCaves |= bCave;
         }
     }
-    double EndTime = FPlatformTime::Seconds();
-    double ElapsedTime = EndTime - StartTime;
-    UE_LOG(LogTemp, Warning, TEXT("CreateTriangles took %f seconds"), ElapsedTime);
+    if (!bAnyCaves)
+    {
+        CaveMask.Reset();
+        return;
+    }
+
+    // A single box pass is a linear ramp, exactly 1 from BlendRadius inside the biomes and exactly 0 from
+    // BlendRadius outside, so the heightmap and the cave layer overlap across the ramp instead of leaving a gap
+    FTerrainBoxBlur::Blur(CaveMask, XSize, YSize, Caves.BlendRadius, 1);
 }
 
 
-void ADiamondSquare::CreateVertices(const TArray<TArray<float>>& NoiseMap)
+void ADiamondSquare::BuildCaves(const TArray<TArray<float>>& NoiseMap)
 {
-    double StartTimeCV = FPlatformTime::Seconds();
-    // Prepare the Colors array for new data
-    Colors.Empty();
-    FLinearColor Color;
-    // Check if the ProceduralMesh is valid
-    if (ProceduralMesh)
+    // Drop the chunks of the previous build, however many there were
+    for (int32 SectionIndex = FirstCaveSectionIndex; SectionIndex < ProceduralMesh->GetNumSections(); ++SectionIndex)
     {
-        // Iterate over each grid point to create vertices
-        for (int X = 0; X < XSize; ++X)
+        ProceduralMesh->ClearMeshSection(SectionIndex);
+    }
+    if (CaveMask.Num() == 0 || Scale <= 0.0f)
+    {
+        return;
+    }
+    DIAMONDSQUARE_STEP_SCOPE(Caves);
+
+    FTerrainCaveField Field;
+    Field.Rows = XSize;
+    Field.Cols = YSize;
+    Field.Mask = CaveMask;
+    Field.Colors = Colors;
+    Field.CellSize = Scale;
+    Field.UVScale = UVScale;
+    Field.Heights.SetNumUninitialized(XSize * YSize);
+    for (int32 X = 0; X < XSize; ++X)
+    {
+        for (int32 Y = 0; Y < YSize; ++Y)
         {
-            for (int Y = 0; Y < YSize; ++Y)
-            {
-                float Z = NoiseMap[X][Y]; // Height value from the noise map
-                ECell BiomeChar = BiomeMap[X][Y];
-                Color = GetColorBasedOnBiomeAndHeight(Z, BiomeChar);
-                Colors.Add(Color.ToFColor(false));
-                // Determine the color based on biome and heigh
-
-                // Add vertex with calculated position and UV coordinates
-                Z *= ZMultiplier;
-                Z = pow(Z, ZExpo);
-                Vertices.Add(FVector(X * Scale, Y * Scale, Z * Scale));
-                UV0.Add(FVector2D(X * UVScale, Y * UVScale));
-            }
+            Field.Heights[X * YSize + Y] = GetVertexHeight(NoiseMap[X][Y]) / Scale;
         }
-
-        // Initialize normals and tangents for the vertices
-        Normals.Init(FVector(0.0f, 0.0f, 1.0f), Vertices.Num());
-        Tangents.Init(FProcMeshTangent(1.0f, 0.0f, 0.0f), Vertices.Num());
-
-        // Create the mesh section with the generated data
-        //ProceduralMesh->CreateMeshSection(0, Vertices, Triangles, Normals, UV0, Colors, Tangents, true);
     }
-    double EndTimeCV = FPlatformTime::Seconds();
-    double ElapsedTimeCV = EndTimeCV - StartTimeCV;
-    UE_LOG(LogTemp, Warning, TEXT("CreateVertices took %f seconds"), ElapsedTimeCV);
-}
-
-
-TArray<TArray<float>> ADiamondSquare::GeneratePerlinNoiseMap()
-{
-
-    // Reset and create the BiomeMap
-    BiomeMap.Empty();
-    BiomeMap = TestIsland();
-    double StartTimeGP = FPlatformTime::Seconds();
-    // Initialize the NoiseMap array
-    TArray<TArray<float>> NoiseMap;
-    NoiseMap.Init(TArray<float>(), XSize);
+    FRandomStream NoiseRng(HashCombine(GetTypeHash(Seed), GetTypeHash(FirstCaveSectionIndex)));
+    Field.NoiseOffset = FVector(NoiseRng.FRandRange(0.0f, 256.0f), NoiseRng.FRandRange(0.0f, 256.0f), NoiseRng.FRandRange(0.0f, 256.0f));
 
-    // Iterate over the grid to generate noise values
-    for (int X = 0; X < XSize; ++X)
+    // Only chunks reaching into the mask are meshed
+    const int32 ChunkSize = FMath::Max(Caves.ChunkSize, 1);
+    TArray<FIntRect> ChunkCells;
+    for (int32 StartX = 0; StartX < XSize - 1; StartX += ChunkSize)
     {
-        NoiseMap[X].Init(0.0f, YSize);
-        for (int Y = 0; Y < YSize; ++Y)
+        for (int32 StartY = 0; StartY < YSize - 1; StartY += ChunkSize)
         {
-            // Initialize variables for noise calculation
-            float Amplitude = 1.0f;
-            float Frequency = 1.0f;
-            float NoiseHeight = 0.0f;
-
-            // Calculate noise value across multiple octaves
-            for (int Octave = 0; Octave < Octaves; ++Octave)
+            const FIntRect Cells(StartX, StartY, FMath::Min(StartX + ChunkSize, XSize - 1), FMath::Min(StartY + ChunkSize, YSize - 1));
+            bool bMasked = false;
+            for (int32 X = Cells.Min.X; X < Cells.Max.X && !bMasked; ++X)
             {
-                // Determine sample coordinates based on frequency and scale
-                float SampleX = X / Scale * Frequency;
-                float SampleY = Y / Scale * Frequency;
-
-                // Generate Perlin noise value
-                float PerlinValue = FMath::PerlinNoise2D(FVector2D(SampleX, SampleY));
-                NoiseHeight += PerlinValue * Amplitude;
-
-                // Adjust amplitude and frequency for next octave
-                Amplitude *= Persistence;
-                Frequency *= Lacunarity;
+                for (int32 Y = Cells.Min.Y; Y < Cells.Max.Y && !bMasked; ++Y)
+                {
+                    bMasked = CaveMask[X * YSize + Y] > 0.0f;
+                }
+            }
+            if (bMasked)
+            {
+                ChunkCells.Add(Cells);
             }
+        }
+    }
 
-            // Adjust noise height based on biome
-            ECell BiomeChar = BiomeMap[X][Y];
-            NoiseHeight = GetInterpolatedHeight(NoiseHeight, BiomeChar);
+    TArray<FTerrainCaveMesh> Meshes;
+    Meshes.SetNum(ChunkCells.Num());
+    ParallelFor(ChunkCells.Num(), [&](int32 ChunkIndex)
+        {
+            FTerrainCaves::BuildChunk(Field, ChunkCells[ChunkIndex], Caves, Meshes[ChunkIndex]);
+        });
 
-            // Clamp the noise value to ensure it's within the expected range
-            NoiseMap[X][Y] = FMath::Clamp(NoiseHeight, 0.0f, 1.0f);
-        }
+    int64 NumVoxels = 0;
+    int32 NumTriangles = 0;
+    for (int32 ChunkIndex = 0; ChunkIndex < Meshes.Num(); ++ChunkIndex)
+    {
+        const FTerrainCaveMesh& Mesh = Meshes[ChunkIndex];
+        UE_LOG(LogDiamondSquare, Verbose, TEXT("Caves: chunk at (%d, %d) meshed %lld voxels into %d triangles in %f seconds (%.2f Mvoxels/s)"),
+            ChunkCells[ChunkIndex].Min.X, ChunkCells[ChunkIndex].Min.Y, Mesh.NumVoxels, Mesh.Triangles.Num() / 3, Mesh.Seconds,
+            Mesh.Seconds > 0.0 ? Mesh.NumVoxels / Mesh.Seconds / 1.0e6 : 0.0);
+        NumVoxels += Mesh.NumVoxels;
+        NumTriangles += Mesh.Triangles.Num() / 3;
     }
-    double EndTimeGP = FPlatformTime::Seconds();
-    double ElapsedTimeGP = EndTimeGP - StartTimeGP;
-    UE_LOG(LogTemp, Warning, TEXT("GeneratePerlinNoiseMap took %f seconds"), ElapsedTimeGP);
 
-    // Return the generated Perlin noise map
-    return NoiseMap;
+    // Each section is a draw call and, with collision, a body of its own, so runs of neighbouring chunks are
+    // merged into at most Caves.MaxSections of them. ChunkCells runs along rows of chunks, so each run is a band
+    // of the map and the sections still cull separately.
+    const int32 NumSections = FMath::Min(FMath::Max(Caves.MaxSections, 1), Meshes.Num());
+    for (int32 SectionOffset = 0; SectionOffset < NumSections; ++SectionOffset)
+    {
+        const int32 FirstChunk = Meshes.Num() * SectionOffset / NumSections;
+        const int32 EndChunk = Meshes.Num() * (SectionOffset + 1) / NumSections;
+
+        FTerrainCaveMesh Section;
+        FTerrainCaves::MergeMeshes(MakeArrayView(Meshes.GetData() + FirstChunk, EndChunk - FirstChunk), Section);
+
+        const int32 SectionIndex = FirstCaveSectionIndex + SectionOffset;
+        ProceduralMesh->CreateMeshSection(SectionIndex, Section.Vertices, Section.Triangles, Section.Normals, Section.UV0, Section.Colors, TArray<FProcMeshTangent>(), Caves.bCreateCollision);
+        ProceduralMesh->SetMaterial(SectionIndex, Material);
+    }
+    INC_DWORD_STAT_BY(STAT_DiamondSquare_TrianglesEmitted, NumTriangles);
+    CSV_CUSTOM_STAT(DiamondSquare, TrianglesEmitted, NumTriangles, ECsvCustomStatOp::Accumulate);
+    UE_LOG(LogDiamondSquare, Verbose, TEXT("Caves: %d chunks in %d sections, %lld voxels, %d triangles"), Meshes.Num(), NumSections, NumVoxels, NumTriangles);
 }
 
 
 float ADiamondSquare::GetInterpolatedHeight(float HeightValue, ECell BiomeType)
+{
+    const FVector2f Range = GetBiomeHeightRange(BiomeType);
+    return FMath::Lerp(Range.X, Range.Y, HeightValue);
+}
+
+
+FVector2f ADiamondSquare::GetBiomeHeightRange(ECell BiomeType)
 {
     switch (BiomeType)
     {
     case ECell::Ocean: // Ocean
-        return FMath::Clamp(HeightValue, 0.0f, 0.0f);
+        return FVector2f(0.0f, 0.0f);
     case ECell::DeepOcean: // DeepOcean
-        return FMath::Lerp(0.0f, 0.0f, HeightValue);
+        return FVector2f(0.0f, 0.0f);
     case ECell::SnowyForest: // SnowyForest
-        return FMath::Lerp(0.2f, 0.7f, HeightValue);
+        return FVector2f(0.2f, 0.7f);
     case ECell::Mountain: // Mountain
-        return FMath::Lerp(0.7f, 1.0f, HeightValue);
+        return FVector2f(0.7f, 1.0f);
     case ECell::Plains: // Plains
-        return FMath::Lerp(0.2f, 0.5f, HeightValue);
+        return FVector2f(0.2f, 0.5f);
     case ECell::Beach: // Beach
-        return FMath::Lerp(0.03f, 0.3f, HeightValue);
+        return FVector2f(0.03f, 0.3f);
     case ECell::ColdBeach: // Beach
-        return FMath::Lerp(0.03f, 0.3f, HeightValue);
+        return FVector2f(0.03f, 0.3f);
     case ECell::Desert: // Desert
-        return FMath::Lerp(0.2f, 0.6f, HeightValue);
+        return FVector2f(0.2f, 0.6f);
     case ECell::River: // River
-        return FMath::Lerp(0.1f, 0.4f, HeightValue);
+        return FVector2f(0.1f, 0.4f);
     case ECell::Taiga: // Taiga
-        return FMath::Lerp(0.25f, 0.65f, HeightValue);
+        return FVector2f(0.25f, 0.65f);
     case ECell::Forest: // Forest
-        return FMath::Lerp(0.2f, 0.7f, HeightValue);
+        return FVector2f(0.2f, 0.7f);
     case ECell::Swamp: // Swamp
-        return FMath::Lerp(0.05f, 0.2f, HeightValue);
+        return FVector2f(0.05f, 0.2f);
     case ECell::Tundra: // Tundra
-        return FMath::Lerp(0.25f, 0.65f, HeightValue);
+        return FVector2f(0.25f, 0.65f);
     case ECell::Rainforest: // Rainforest
-        return FMath::Lerp(0.2f, 0.55f, HeightValue);
+        return FVector2f(0.2f, 0.55f);
     case ECell::Woodland: // Woodland
-        return FMath::Lerp(0.3f, 0.5f, HeightValue);
+        return FVector2f(0.3f, 0.5f);
     case ECell::Savannah: // Savannah
-        return FMath::Lerp(0.2f, 0.5f, HeightValue);
+        return FVector2f(0.2f, 0.5f);
     case ECell::Highland: // Highland
-        return FMath::Lerp(0.5f, 0.99f, HeightValue);
+        return FVector2f(0.5f, 0.99f);
     case ECell::IcePlains: // IcePlains
-        return FMath::Lerp(0.1f, 0.5f, HeightValue);
+        return FVector2f(0.1f, 0.5f);
     case ECell::Ice: // Ice
-        return FMath::Lerp(0.2f, 0.9f, HeightValue);
+        return FVector2f(0.2f, 0.9f);
     case ECell::SwampShore: // SwampShore
-        return FMath::Lerp(0.05f, 0.25f, HeightValue);
+        return FVector2f(0.05f, 0.25f);
     case ECell::SandDunes:
-        return FMath::Lerp(0.3f, 0.5f, HeightValue); // Slightly elevated
+        return FVector2f(0.3f, 0.5f); // Slightly elevated
     case ECell::Grassland:
-        return FMath::Lerp(0.2f, 0.4f, HeightValue); // Generally flat
+        return FVector2f(0.2f, 0.4f); // Generally flat
     case ECell::Marsh:
-        return FMath::Lerp(0.0f, 0.2f, HeightValue); // Low and wet
+        return FVector2f(0.0f, 0.2f); // Low and wet
     case ECell::Volcanic:
-        return FMath::Lerp(0.3f, 1.0f, HeightValue); // Ranges from high to very high
+        return FVector2f(0.3f, 1.0f); // Ranges from high to very high
     case ECell::Oasis:
-        return FMath::Lerp(0.1f, 0.2f, HeightValue); // Very small elevation changes
+        return FVector2f(0.1f, 0.2f); // Very small elevation changes
     case ECell::Steppe:
-        return FMath::Lerp(0.2f, 0.6f, HeightValue); // Elevated plains
+        return FVector2f(0.2f, 0.6f); // Elevated plains
     case ECell::Mesa:
-        return FMath::Lerp(0.4f, 0.8f, HeightValue); // High plate
+        return FVector2f(0.4f, 0.8f); // High plate
     default:
-        // For unrecognized biomes, return the original height
-        return HeightValue;
+        // For unrecognized biomes, keep the original height
+        return FVector2f(0.0f, 1.0f);
     }
 }
 
 
 FLinearColor ADiamondSquare::GetColorBasedOnBiomeAndHeight(float Z, ECell BiomeType)
+{
+    FLinearColor Color = GetBiomeBaseColor(Z, BiomeType);
+
+    // Generate random variations in the RGB components
+    float variation = 0.05f; // Adjust this value for more or less variation
+    Color.R = FMath::Clamp(Color.R + Rng.FRandRange(-variation, variation), 0.0f, 1.0f);
+    Color.G = FMath::Clamp(Color.G + Rng.FRandRange(-variation, variation), 0.0f, 1.0f);
+    Color.B = FMath::Clamp(Color.B + Rng.FRandRange(-variation, variation), 0.0f, 1.0f);
+
+    return Color;
+}
+
+
+const TCHAR* ADiamondSquare::GetCellName(ECell Cell)
+{
+    static const TCHAR* const Names[] = {
+        TEXT("Land"), TEXT("Ocean"), TEXT("Warm"), TEXT("Cold"), TEXT("Freezing"), TEXT("Temperate"),
+        TEXT("DeepOcean"), TEXT("Desert"), TEXT("SandDunes"), TEXT("Plains"), TEXT("Grassland"), TEXT("Rainforest"),
+        TEXT("Savannah"), TEXT("Swamp"), TEXT("Marsh"), TEXT("Woodland"), TEXT("Forest"), TEXT("Highland"),
+        TEXT("Taiga"), TEXT("SnowyForest"), TEXT("Tundra"), TEXT("IcePlains"), TEXT("Mountain"), TEXT("Volcanic"),
+        TEXT("Beach"), TEXT("River"), TEXT("SwampShore"), TEXT("Ice"), TEXT("ColdBeach"), TEXT("Oasis"),
+        TEXT("Steppe"), TEXT("Mesa") };
+    static_assert(UE_ARRAY_COUNT(Names) == uint8(ECell::Mesa) + 1, "Every ECell needs a name");
+    return uint8(Cell) < UE_ARRAY_COUNT(Names) ? Names[uint8(Cell)] : TEXT("Unknown");
+}
+
+
+FLinearColor ADiamondSquare::GetBiomeBaseColor(float Z, ECell BiomeType)
 {
     FLinearColor Color; // Declare the color variable
 
@@ -465,667 +1801,756 @@ FLinearColor ADiamondSquare::GetColorBasedOnBiomeAndHeight(float Z, ECell BiomeT
         Color = FLinearColor::Red;
     }
 
-    // Generate random variations in the RGB components
-    float variation = 0.05f; // Adjust this value for more or less variation
-    Color.R = FMath::Clamp(Color.R + Rng.FRandRange(-variation, variation), 0.0f, 1.0f);
-    Color.G = FMath::Clamp(Color.G + Rng.FRandRange(-variation, variation), 0.0f, 1.0f);
-    Color.B = FMath::Clamp(Color.B + Rng.FRandRange(-variation, variation), 0.0f, 1.0f);
-
     return Color;
 }
 
 
 
+static FString GetBiomeStageName(EBiomeStage Stage)
+{
+    return StaticEnum<EBiomeStage>()->GetNameStringByValue(int64(Stage));
+}
+
+
+// Fused passes are named after every stage they run, in order
+static FString GetBiomeStepName(const FBiomePlanStep& Step)
+{
+    FString Name;
+    for (const FBiomeStageDesc& Desc : Step.Stages)
+    {
+        if (!Name.IsEmpty())
+        {
+            Name += TEXT("+");
+        }
+        Name += GetBiomeStageName(Desc.Stage);
+    }
+    return Name;
+}
+
+
+static int64 GetNumCells(const TArray<TArray<ADiamondSquare::ECell>>& Board)
+{
+    return Board.Num() > 0 ? int64(Board.Num()) * Board[0].Num() : 0;
+}
+
+
+// Index within the plan of the first stage of step StepIndex
+static int32 GetFirstStageIndex(const FBiomePipelinePlan& Plan, int32 StepIndex)
+{
+    int32 StageIndex = 0;
+    for (int32 Index = 0; Index < StepIndex; ++Index)
+    {
+        StageIndex += Plan.Steps[Index].Stages.Num();
+    }
+    return StageIndex;
+}
+
+
 // Example usage within the ADiamondSquare class
 TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::TestIsland()
 {
-    double StartTimeTI = FPlatformTime::Seconds();
-    TArray<TArray<ECell>> Board;
+    DIAMONDSQUARE_STEP_SCOPE(BiomeMap);
     InitializeSeed();
-    Island(Board); // Adjust Island function to return the board
-    Board = FuzzyZoom(Board);;
-    Board = AddIsland(Board);
-    Board = Zoom(Board);
-    Board = AddIsland(Board);
-    Board = AddIsland(Board);
-    Board = AddIsland(Board);
-    Board = RemoveTooMuchOcean(Board);
-    Board = AddTemps(Board);
-    Board = AddIsland2(Board);
-    Board = WarmToTemperate(Board);
-    Board = FreezingToCold(Board);
-    Board = Zoom(Board);
-    Board = AddIsland2(Board);
-    if (SurroundMapWithOcean) {
-        Board = SurroundWithOcean(Board);
-    }
-    Board = Zoom(Board);
-    Board = TemperatureToBiome(Board);
-    Board = DeepOcean(Board);
-    Board = Zoom(Board);
-    Board = Zoom(Board);
-    Board = Zoom(Board);
-    //Board = AddIsland2(Board);
-    Board = Zoom(Board);
-    Board = Shore(Board);
-    Board = Zoom(Board);
-    //Board = Zoom(Board);
-    //Board = Zoom(Board);
-
-    if (Board.Num() > 0)
-    {
-        int NumRows = Board.Num();
-        int NumColumns = Board[0].Num();  // Assuming all rows are of the same length
-        UE_LOG(LogTemp, Warning, TEXT("Board Size: %d x %d"), NumRows, NumColumns);
-    }
-    else
-    {
-        UE_LOG(LogTemp, Warning, TEXT("Board is empty"));
+
+    FBiomePipelinePlan Plan;
+    PlanBiomePipeline(FIntPoint(XSize, YSize), Plan);
+
+    // The board before the trailing tile stages, with those stages, is what PrepareRegions returns for this map;
+    // GetBiomeAt keeps it to make the cells beyond the grid on demand
+    TArray<FBiomeTileStage> TrailingStages;
+    TArray<TArray<ECell>> Board = RunBiomePipeline(Plan, TrailingStages);
+    PublishBiomeQuery(CopyTemp(Board), TrailingStages);
+    if (TrailingStages.Num() > 0)
+    {
+        const int32 StepIndex = Plan.Steps.Num() - 1;
+        const FString StepName = GetBiomeStepName(Plan.Steps[StepIndex]);
+        TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(*StepName);
+        const double StepStartTime = FPlatformTime::Seconds();
+        Board = FBiomeTiles::Run(Board, TrailingStages, BiomeTileSize);
+        RecordBiomeStep(GetBiomeStageColumn(GetFirstStageIndex(Plan, StepIndex), StepName), StepStartTime, GetNumCells(Board));
     }
+
     //PrintBoard(Board); // Print the resulting board
-    double EndTimeTI = FPlatformTime::Seconds();
-    double ElapsedTimeTI = EndTimeTI - StartTimeTI;
-    UE_LOG(LogTemp, Warning, TEXT("BiomeMap took %f seconds"), ElapsedTimeTI);
     return Board;
 }
 
 
-void ADiamondSquare::InitializeSeed()
+void ADiamondSquare::PlanBiomePipeline(const FIntPoint& GridSize, FBiomePipelinePlan& OutPlan)
+{
+    FString PlanError;
+    bool bPlanned = false;
+    if (BiomePipeline)
+    {
+        bPlanned = FBiomePipelinePlanner::Plan(ResolveStageDefaults(BiomePipeline->Stages), bTiledBiomeStages, OutPlan, PlanError);
+        if (bPlanned && OutPlan.OutputSize < FMath::Max(GridSize.X, GridSize.Y))
+        {
+            PlanError = FString::Printf(TEXT("its %d x %d map is smaller than the %d x %d grid"), OutPlan.OutputSize, OutPlan.OutputSize, GridSize.X, GridSize.Y);
+            bPlanned = false;
+        }
+        if (!bPlanned)
+        {
+            UE_LOG(LogDiamondSquare, Error, TEXT("Biome pipeline %s cannot run, using the default stages instead: %s"), *BiomePipeline->GetName(), *PlanError);
+        }
+    }
+    if (!bPlanned)
+    {
+        verify(FBiomePipelinePlanner::Plan(ResolveStageDefaults(FBiomePipelinePlanner::GetDefaultStages(SurroundMapWithOcean)), bTiledBiomeStages, OutPlan, PlanError));
+    }
+    UE_LOG(LogDiamondSquare, Verbose, TEXT("Biome pipeline: %d stages in %d passes"), OutPlan.NumStages, OutPlan.NumPasses);
+}
+
+
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::RunBiomePipeline(const FBiomePipelinePlan& Plan, TArray<FBiomeTileStage>& OutTrailingStages)
+{
+    FBiomeBitboard Bits;
+    TArray<TArray<ECell>> Board;
+    bool bOnBitboard = true;
+    OutTrailingStages.Reset();
+
+    // Index within the plan of the first stage of the current step
+    int32 StageIndex = 0;
+    for (int32 StepIndex = 0; StepIndex < Plan.Steps.Num(); StageIndex += Plan.Steps[StepIndex].Stages.Num(), ++StepIndex)
+    {
+        const FBiomePlanStep& Step = Plan.Steps[StepIndex];
+        if (Step.Kind == EBiomePlanStepKind::Bitboard)
+        {
+            for (int32 Offset = 0; Offset < Step.Stages.Num(); ++Offset)
+            {
+                const FString StageName = GetBiomeStageName(Step.Stages[Offset].Stage);
+                TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(*StageName);
+                const double StageStartTime = FPlatformTime::Seconds();
+                Bits = RunBitboardStage(Step.Stages[Offset], Bits);
+                RecordBiomeStep(GetBiomeStageColumn(StageIndex + Offset, StageName), StageStartTime, int64(Bits.Rows) * Bits.Cols);
+            }
+            continue;
+        }
+
+        if (bOnBitboard)
+        {
+            // Later stages can make more values than Land and Ocean, so switch to one byte per cell from here on
+            Board = ExpandBitboard(Bits);
+            bOnBitboard = false;
+        }
+
+        // The trailing tile stages are only collected here; TestIsland and GenerateRegion run them
+        if (Step.Kind == EBiomePlanStepKind::Tiled && StepIndex == Plan.Steps.Num() - 1)
+        {
+            OutTrailingStages = MakeTileStages(Step.Stages);
+            continue;
+        }
+
+        const FString StepName = GetBiomeStepName(Step);
+        TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(*StepName);
+        const double StepStartTime = FPlatformTime::Seconds();
+        switch (Step.Kind)
+        {
+        case EBiomePlanStepKind::CellPass:
+        {
+            TOptional<EBiomeStage> PointStage;
+            TArray<const FBiomeCellRule*, TInlineAllocator<8>> Rules;
+            for (const FBiomeStageDesc& Desc : Step.Stages)
+            {
+                if (FBiomePipelinePlanner::IsPointStage(Desc.Stage))
+                {
+                    PointStage = Desc.Stage;
+                }
+                else
+                {
+                    Rules.Add(FBiomePipelinePlanner::GetCellRule(Desc.Stage));
+                }
+            }
+            Board = RunCellPass(Board, PointStage, Rules);
+            break;
+        }
+        case EBiomePlanStepKind::Tiled:
+            Board = FBiomeTiles::Run(Board, MakeTileStages(Step.Stages), BiomeTileSize);
+            break;
+        default:
+            Board = RunStage(Step.Stages[0], Board);
+            break;
+        }
+        RecordBiomeStep(GetBiomeStageColumn(StageIndex, StepName), StepStartTime, GetNumCells(Board));
+    }
+
+    return bOnBitboard ? ExpandBitboard(Bits) : Board;
+}
+
+
+FBiomeBitboard ADiamondSquare::RunBitboardStage(const FBiomeStageDesc& Desc, const FBiomeBitboard& Board)
+{
+    TGuardValue<float> LandGuard(ProbabilityOfLand, Desc.LandProbability >= 0.0f ? Desc.LandProbability : ProbabilityOfLand);
+
+    switch (Desc.Stage)
+    {
+    case EBiomeStage::Island:
+        return IslandBits();
+    case EBiomeStage::FuzzyZoom:
+        return FuzzyZoomBits(Board);
+    case EBiomeStage::AddIsland:
+        return AddIslandBits(Board);
+    case EBiomeStage::Zoom:
+        return ZoomBits(Board);
+    case EBiomeStage::RemoveTooMuchOcean:
+        return RemoveTooMuchOceanBits(Board);
+    default:
+        checkNoEntry();
+        return Board;
+    }
+}
+
+
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::RunStage(const FBiomeStageDesc& Desc, const TArray<TArray<ECell>>& Board)
+{
+    TGuardValue<float> LandGuard(ProbabilityOfLand, Desc.LandProbability >= 0.0f ? Desc.LandProbability : ProbabilityOfLand);
+
+    TArray<TArray<ECell>> Result = Board;
+    switch (Desc.Stage)
+    {
+    case EBiomeStage::Island:
+        return Island(Result);
+    case EBiomeStage::FuzzyZoom:
+        return FuzzyZoom(Board);
+    case EBiomeStage::AddIsland:
+        return AddIsland(Board);
+    case EBiomeStage::AddIsland2:
+        return AddIsland2(Board);
+    case EBiomeStage::Zoom:
+        return Zoom(Board);
+    case EBiomeStage::RemoveTooMuchOcean:
+        return RemoveTooMuchOcean(Board);
+    case EBiomeStage::SurroundWithOcean:
+        return SurroundWithOcean(Result);
+    case EBiomeStage::AddTemps:
+        return AddTemps(Board);
+    case EBiomeStage::WarmToTemperate:
+        return WarmToTemperate(Board);
+    case EBiomeStage::FreezingToCold:
+        return FreezingToCold(Board);
+    case EBiomeStage::TemperatureToBiome:
+        return TemperatureToBiome(Board);
+    case EBiomeStage::DeepOcean:
+        return DeepOcean(Board, Desc.Radius);
+    case EBiomeStage::Shore:
+        return Shore(Board, Desc.Radius);
+    case EBiomeStage::RemoveSpecks:
+        return RemoveSpecks(Board, Desc.MinArea);
+    default:
+        checkNoEntry();
+        return Result;
+    }
+}
+
+
+TArray<FBiomeStageDesc> ADiamondSquare::ResolveStageDefaults(const TArray<FBiomeStageDesc>& Stages) const
+{
+    // The planner picks between neighbourhood rules and the distance transform by radius, so it needs them all filled in
+    TArray<FBiomeStageDesc> Resolved = Stages;
+    for (FBiomeStageDesc& Desc : Resolved)
+    {
+        if (Desc.Radius < 0.0f && Desc.Stage == EBiomeStage::DeepOcean)
+        {
+            Desc.Radius = DeepOceanDistance;
+        }
+        else if (Desc.Radius < 0.0f && Desc.Stage == EBiomeStage::Shore)
+        {
+            Desc.Radius = ShoreWidth;
+        }
+        if (Desc.MinArea < 0)
+        {
+            Desc.MinArea = MinIslandArea;
+        }
+    }
+    return Resolved;
+}
+
+
+TArray<FBiomeTileStage> ADiamondSquare::MakeTileStages(const TArray<FBiomeStageDesc>& Stages)
+{
+    TArray<FBiomeTileStage> TileStages;
+    for (const FBiomeStageDesc& Desc : Stages)
+    {
+        FBiomeTileStage& TileStage = TileStages.AddDefaulted_GetRef();
+        TileStage.Kind = Desc.Stage == EBiomeStage::Zoom ? EBiomeTileStageKind::Zoom : EBiomeTileStageKind::Shore;
+
+        // Hand out Zoom seeds in the same order the untiled path would
+        if (TileStage.Kind == EBiomeTileStageKind::Zoom)
+        {
+            TileStage.Seed = NextZoomSeed();
+        }
+    }
+    return TileStages;
+}
+
+
+bool ADiamondSquare::GetBiomeAt(int32 X, int32 Y, ECell& OutBiome) const
+{
+    TSharedPtr<const FBiomeRunMap, ESPMode::ThreadSafe> Runs;
+    TSharedPtr<FBiomeQuery, ESPMode::ThreadSafe> Query;
+    {
+        FScopeLock Lock(&BiomeQueryLock);
+        Runs = BiomeRuns;
+        Query = BiomeQuery;
+    }
+
+    // The runs hold the grid as it was finished, rivers included, so they answer first
+    if (Runs.IsValid() && Runs->GetBiome(X, Y, OutBiome))
+    {
+        return true;
+    }
+    return Query.IsValid() && Query->GetBiome(X, Y, OutBiome);
+}
+
+
+bool ADiamondSquare::FindNearestBiome(ECell Biome, const FIntPoint& From, FIntPoint& OutCell, int32 MaxDistance) const
+{
+    const TSharedPtr<const FBiomeRunMap, ESPMode::ThreadSafe> Runs = GetBiomeRuns();
+    return Runs.IsValid() && Runs->FindNearest(Biome, From, OutCell, MaxDistance);
+}
+
+
+bool ADiamondSquare::GetBiomeAtLocation(const FVector& WorldLocation, ECell& OutBiome) const
+{
+    check(IsInGameThread());
+    if (Scale <= 0.0f)
+    {
+        return false;
+    }
+
+    // Grid vertex (X, Y) sits at (X * Scale, Y * Scale) in actor space
+    const FVector Local = GetActorTransform().InverseTransformPosition(WorldLocation);
+    return GetBiomeAt(FMath::RoundToInt(Local.X / Scale), FMath::RoundToInt(Local.Y / Scale), OutBiome);
+}
+
+
+TSharedPtr<FBiomeQuery, ESPMode::ThreadSafe> ADiamondSquare::GetBiomeQuery() const
+{
+    FScopeLock Lock(&BiomeQueryLock);
+    return BiomeQuery;
+}
+
+
+void ADiamondSquare::PublishBiomeQuery(TArray<TArray<ECell>>&& Root, const TArray<FBiomeTileStage>& Stages)
+{
+    const TSharedPtr<FBiomeQuery, ESPMode::ThreadSafe> Query = MakeShared<FBiomeQuery, ESPMode::ThreadSafe>(MoveTemp(Root), Stages, BiomeTileSize, MaxCachedBiomeTiles);
+    FScopeLock Lock(&BiomeQueryLock);
+    BiomeQuery = Query;
+}
+
+
+TSharedPtr<const FBiomeRunMap, ESPMode::ThreadSafe> ADiamondSquare::GetBiomeRuns() const
+{
+    FScopeLock Lock(&BiomeQueryLock);
+    return BiomeRuns;
+}
+
+
+TSharedPtr<const FBiomeRegions, ESPMode::ThreadSafe> ADiamondSquare::GetIslands() const
+{
+    FScopeLock Lock(&BiomeQueryLock);
+    return Islands;
+}
+
+
+bool ADiamondSquare::FindSpawnCellOnMainIsland(FRandomStream& Random, FIntPoint& OutCell) const
+{
+    const TSharedPtr<const FBiomeRegions, ESPMode::ThreadSafe> Regions = GetIslands();
+    const int32 MainIsland = Regions.IsValid() ? Regions->FindLargest(1) : INDEX_NONE;
+    if (MainIsland == INDEX_NONE)
+    {
+        return false;
+    }
+    OutCell = Regions->GetRandomCell(MainIsland, Random);
+    return true;
+}
+
+
+// World Z of the ground under WorldLocation, measured along the actor's up axis
+static bool SampleGroundHeight(const FTerrainHeightField& Field, const FTransform& ActorToWorld, const FVector& WorldLocation, ETerrainSampleFilter Filter, float& OutHeight)
+{
+    const FVector Local = ActorToWorld.InverseTransformPosition(WorldLocation);
+    const FVector2D Local2D(Local.X, Local.Y);
+    OutHeight = float(ActorToWorld.TransformPosition(FVector(Local.X, Local.Y, Field.GetHeight(Local2D, Filter))).Z);
+    return Field.IsInside(Local2D);
+}
+
+
+static bool SampleGroundNormal(const FTerrainHeightField& Field, const FTransform& ActorToWorld, const FVector& WorldLocation, ETerrainSampleFilter Filter, FVector& OutNormal)
+{
+    const FVector Local = ActorToWorld.InverseTransformPosition(WorldLocation);
+    const FVector2D Local2D(Local.X, Local.Y);
+
+    // Normals take the inverse scale, so non-uniform actor scale still tilts them the right way
+    const FVector LocalNormal = Field.GetNormal(Local2D, Filter);
+    OutNormal = ActorToWorld.TransformVectorNoScale(LocalNormal / ActorToWorld.GetScale3D()).GetSafeNormal(SMALL_NUMBER, FVector::UpVector);
+    return Field.IsInside(Local2D);
+}
+
+
+bool ADiamondSquare::GetHeightFieldSnapshot(TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe>& OutField, FTransform& OutTransform) const
 {
-    Rng.Initialize(Seed);
-    UE_LOG(LogTemp, Warning, TEXT("Random Number Generator Seeded with: %d"), Seed);
+    OutField = GetHeightField();
+    OutTransform = GetActorTransform();
+    return OutField.IsValid();
 }
 
 
-TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::DeepOcean(const TArray<TArray<ADiamondSquare::ECell>>& Board) {
-    // Make a copy of the board to modify and return.
-    TArray<TArray<ECell>> ModifiedBoard = Board;
+TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe> ADiamondSquare::GetHeightField() const
+{
+    FScopeLock Lock(&HeightFieldLock);
+    return HeightField;
+}
 
-    // Helper lambda to check if a cell is within bounds and is an Ocean.
-    auto IsOcean = [&](int32 Row, int32 Col) -> bool {
-        return Row >= 0 && Row < Board.Num() && Col >= 0 && Col < Board[Row].Num() && Board[Row][Col] == ECell::Ocean;
-        };
 
-    // Iterate over each cell in the board, this time considering the extended radius for checking.
-    for (int32 Row = 0; Row < Board.Num(); ++Row) {
-        for (int32 Col = 0; Col < Board[Row].Num(); ++Col) {
-            // Check if the current cell is Ocean.
-            if (Board[Row][Col] == ECell::Ocean) {
-                bool bIsSurroundedByOcean = true;
-
-                // Check cells within a radius of 2 around the current cell.
-                for (int32 dRow = -1; dRow <= 1 && bIsSurroundedByOcean; ++dRow) {
-                    for (int32 dCol = -1; dCol <= 1; ++dCol) {
-                        // Skip the check for the current cell itself.
-                        if (dRow == 0 && dCol == 0) continue;
-
-                        // If any cell within the radius is not ocean, mark as not surrounded.
-                        if (!IsOcean(Row + dRow, Col + dCol)) {
-                            bIsSurroundedByOcean = false;
-                            break; // Break inner loop
-                        }
-                    }
-                }
+bool ADiamondSquare::GetHeightAt(const FVector& WorldLocation, float& OutHeight, ETerrainSampleFilter Filter) const
+{
+    TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe> Field;
+    FTransform ActorToWorld;
+    return GetHeightFieldSnapshot(Field, ActorToWorld) && SampleGroundHeight(*Field, ActorToWorld, WorldLocation, Filter, OutHeight);
+}
 
-                // If the cell is surrounded by ocean within a radius of 2, change it to DeepOcean.
-                if (bIsSurroundedByOcean) {
-                    ModifiedBoard[Row][Col] = ECell::DeepOcean;
-                }
-            }
-        }
-    }
 
-    // Return the modified board.
-    return ModifiedBoard;
+bool ADiamondSquare::GetNormalAt(const FVector& WorldLocation, FVector& OutNormal, ETerrainSampleFilter Filter) const
+{
+    TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe> Field;
+    FTransform ActorToWorld;
+    return GetHeightFieldSnapshot(Field, ActorToWorld) && SampleGroundNormal(*Field, ActorToWorld, WorldLocation, Filter, OutNormal);
 }
 
 
-TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::AddTemps(const TArray<TArray<ECell>>& Board)
+int32 ADiamondSquare::GetHeightsAt(TArrayView<const FVector> WorldLocations, TArrayView<float> OutHeights, ETerrainSampleFilter Filter) const
 {
-    const int32 Rows = Board.Num();
-    const int32 Cols = Board[0].Num();
-    TArray<TArray<ECell>> NewBoard = Board;
+    check(OutHeights.Num() >= WorldLocations.Num());
+    TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe> Field;
+    FTransform ActorToWorld;
+    if (!GetHeightFieldSnapshot(Field, ActorToWorld))
+    {
+        return 0;
+    }
 
-    for (int32 i = 0; i < Rows; ++i)
+    int32 NumInside = 0;
+    for (int32 Index = 0; Index < WorldLocations.Num(); ++Index)
     {
-        for (int32 j = 0; j < Cols; ++j)
-        {
-            if (NewBoard[i][j] == ECell::Ocean) continue;
+        NumInside += SampleGroundHeight(*Field, ActorToWorld, WorldLocations[Index], Filter, OutHeights[Index]) ? 1 : 0;
+    }
+    return NumInside;
+}
 
-            // Generate a random number to determine the temperature
-            int32 Temp = Rng.RandRange(1, 6); // Generates a number between 1 and 6
 
-            if (Temp <= 4) // 1-4 are warm
-            {
-                NewBoard[i][j] = ECell::Warm;
-            }
-            else if (Temp == 5) // 5 is cold
-            {
-                NewBoard[i][j] = ECell::Cold;
-            }
-            else // 6 is freezing
-            {
-                NewBoard[i][j] = ECell::Freezing;
-            }
-        }
+int32 ADiamondSquare::GetNormalsAt(TArrayView<const FVector> WorldLocations, TArrayView<FVector> OutNormals, ETerrainSampleFilter Filter) const
+{
+    check(OutNormals.Num() >= WorldLocations.Num());
+    TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe> Field;
+    FTransform ActorToWorld;
+    if (!GetHeightFieldSnapshot(Field, ActorToWorld))
+    {
+        return 0;
     }
 
-    return NewBoard;
+    int32 NumInside = 0;
+    for (int32 Index = 0; Index < WorldLocations.Num(); ++Index)
+    {
+        NumInside += SampleGroundNormal(*Field, ActorToWorld, WorldLocations[Index], Filter, OutNormals[Index]) ? 1 : 0;
+    }
+    return NumInside;
 }
 
 
-TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::Zoom(const TArray<TArray<ECell>>& Board)
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::RunCellPass(const TArray<TArray<ECell>>& Board, TOptional<EBiomeStage> PointStage, TArrayView<const FBiomeCellRule* const> Rules)
 {
-    int32 Rows = Board.Num();
-    int32 Cols = Board[0].Num();
-    TArray<TArray<ECell>> ScaledBoard;
+    const int32 Rows = Board.Num();
+    const int32 Cols = Rows > 0 ? Board[0].Num() : 0;
+    TArray<TArray<ECell>> Output;
+    Output.SetNum(Rows);
+
+    // Point stage output for rows R - 1 to R + 1, indexed by row modulo 3
+    TArray<ECell> Window[3];
+    auto ProduceRow = [this, &Board, &PointStage](int32 R, TArray<ECell>& OutRow)
+        {
+            OutRow = Board[R];
+            if (PointStage.IsSet())
+            {
+                for (ECell& Cell : OutRow)
+                {
+                    Cell = ApplyPointStage(PointStage.GetValue(), Cell);
+                }
+            }
+        };
 
-    // Scale the board by a factor of 2
-    ScaledBoard.Reserve(Rows * 2);
-    for (int32 i = 0; i < Rows; ++i)
+    if (Rows > 0)
+    {
+        ProduceRow(0, Window[0]);
+    }
+    for (int32 R = 0; R < Rows; ++R)
     {
-        TArray<ECell> NewRow;
-        NewRow.Reserve(Cols * 2);
-        for (int32 j = 0; j < Cols; ++j)
+        if (R + 1 < Rows)
         {
-            NewRow.Add(Board[i][j]);
-            NewRow.Add(Board[i][j]);
+            ProduceRow(R + 1, Window[(R + 1) % 3]);
         }
-        ScaledBoard.Add(NewRow);
-        ScaledBoard.Add(NewRow);
-    }
+        const ECell* Up = R > 0 ? Window[(R + 2) % 3].GetData() : nullptr;
+        const ECell* Mid = Window[R % 3].GetData();
+        const ECell* Down = R + 1 < Rows ? Window[(R + 1) % 3].GetData() : nullptr;
 
-    int32 ScaledRows = ScaledBoard.Num();
-    int32 ScaledCols = ScaledBoard[0].Num();
-    TArray<int32> Indexes = { -1, -1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1 };
-
-    for (int32 i = 0; i < ScaledRows; ++i)
-    {
-        for (int32 j = 0; j < ScaledCols; ++j)
+        TArray<ECell>& OutRow = Output[R];
+        OutRow = Window[R % 3];
+        for (int32 C = 0; C < Cols; ++C)
         {
-            if (IsEdgeCell(ScaledBoard, i, j))
+            // Each rule sees the centre as the rules before it left it, and the neighbours as the point
+            // stage left them, which the planner only allows where the two agree
+            ECell Cell = OutRow[C];
+            for (const FBiomeCellRule* Rule : Rules)
             {
-                // Introduce more randomness in how we choose to modify the cell
-                int32 RandIndex = FMath::RandRange(0, Indexes.Num() - 1);
-                int32 xoff = Indexes[RandIndex];
-                RandIndex = FMath::RandRange(0, Indexes.Num() - 1);
-                int32 yoff = Indexes[RandIndex];
-
-                int32 new_i = FMath::Clamp(i + xoff, 0, ScaledRows - 1);
-                int32 new_j = FMath::Clamp(j + yoff, 0, ScaledCols - 1);
-
-                ScaledBoard[i][j] = ScaledBoard[new_i][new_j];
+                if (Rule->Source.Contains(Cell) && Rule->MatchesNeighbours(Up, Mid, Down, C, Cols))
+                {
+                    Cell = Rule->Target;
+                }
             }
+            OutRow[C] = Cell;
         }
     }
 
-    return ScaledBoard;
+    return Output;
 }
 
 
-TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::AddIsland(const TArray<TArray<ADiamondSquare::ECell>>& Board)
+ADiamondSquare::ECell ADiamondSquare::ApplyPointStage(EBiomeStage Stage, ECell Cell)
 {
-    const int32 Rows = Board.Num();
-    const int32 Cols = Board[0].Num();
-    TArray<TArray<ECell>> NextBoard = Board; // Copy the original board to modify
+    return Stage == EBiomeStage::AddTemps ? AddTempsCell(Cell) : TemperatureToBiomeCell(Cell);
+}
 
-    for (int32 i = 0; i < Rows; ++i) {
-        for (int32 j = 0; j < Cols; ++j) {
-            if (IsEdgeCell(Board, i, j) && CanTransform(Board[i][j])) {
-                ECell NewState = Rng.FRand() < ProbabilityOfLand ? ECell::Land : ECell::Ocean;
-                NextBoard[i][j] = NewState;
-            }
-        }
-    }
 
-    return NextBoard;
+void ADiamondSquare::InitializeSeed()
+{
+    Rng.Initialize(Seed);
+    ZoomStageIndex = 0;
+    UE_LOG(LogDiamondSquare, Verbose, TEXT("Random Number Generator Seeded with: %d"), Seed);
 }
 
 
-TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::AddIsland2(const TArray<TArray<ADiamondSquare::ECell>>& Board)
+uint32 ADiamondSquare::NextZoomSeed()
 {
-    const int32 Rows = Board.Num();
-    const int32 Cols = Board[0].Num(); // Assuming the board is at least 1x1
-    TArray<TArray<ECell>> NextBoard = Board; // Assuming you have a way to deep copy
-
-    // Directions to check: Up, Down, Left, Right
-    TArray<FIntPoint> Directions = {
-        FIntPoint(-1, 0), // Up
-        FIntPoint(1, 0),  // Down
-        FIntPoint(0, -1), // Left
-        FIntPoint(0, 1)   // Right
-    };
-
-    for (int32 i = 0; i < Rows; ++i) {
-        for (int32 j = 0; j < Cols; ++j) {
-            // Use the IsEdgeCell function
-            if (IsEdgeCell(Board, i, j) && CanTransform(Board[i][j])) {
-                // Map to count the occurrences of each ECell type, excluding Ocean
-                TMap<ECell, int32> CellTypeCounts;
-
-                for (const FIntPoint& Dir : Directions) {
-                    int32 NR = i + Dir.X;
-                    int32 NC = j + Dir.Y;
-
-                    // Ensure the neighbor is within bounds
-                    if (NR >= 0 && NR < Rows && NC >= 0 && NC < Cols) {
-                        ECell NeighborCell = Board[NR][NC];
-                        // Increment count if not Ocean
-                        if (NeighborCell != ECell::Ocean) {
-                            CellTypeCounts.FindOrAdd(NeighborCell)++;
-                        }
-                    }
-                }
+    // Each Zoom gets its own seed, in pipeline order, so its jitter is a pure function of the cell
+    return HashCombine(GetTypeHash(Seed), GetTypeHash(ZoomStageIndex++));
+}
 
-                // Determine the majority cell type, excluding Ocean
-                ECell MajorityType = ECell::Ocean; // Default to Ocean if no majority found
-                int32 MaxCount = 0;
-                for (const auto& Kvp : CellTypeCounts) {
-                    if (Kvp.Value > MaxCount) {
-                        MajorityType = Kvp.Key;
-                        MaxCount = Kvp.Value;
-                    }
-                }
 
-                // If a majority type is found, update the cell
-                if (MajorityType != ECell::Ocean && Rng.FRand() <= ProbabilityOfLand) {
-                    NextBoard[i][j] = MajorityType;
-                }
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::DeepOcean(const TArray<TArray<ADiamondSquare::ECell>>& Board, float Distance) {
+    if (FBiomePipelinePlanner::IsStencilRadius(Distance)) {
+        // Ocean becomes DeepOcean when all eight neighbours are ocean; cells on the border never qualify
+        const FBiomeCellRule* const Rule = FBiomePipelinePlanner::GetCellRule(EBiomeStage::DeepOcean);
+        return RunCellPass(Board, {}, MakeArrayView(&Rule, 1));
+    }
 
+    // Ocean further than Distance from every other cell and from the map edge becomes DeepOcean
+    TArray<TArray<ECell>> ModifiedBoard = Board;
+    const int32 Rows = Board.Num();
+    const int32 Cols = Rows > 0 ? Board[0].Num() : 0;
+    const TArray<float> ToCoast = FBiomeDistance::SquaredDistance(
+        FBiomeDistance::MakeFeatures(Board, [](ECell Cell) { return Cell != ECell::Ocean; }), Rows, Cols, true);
+
+    const float MinSquared = Distance * Distance;
+    for (int32 Row = 0; Row < Rows; ++Row) {
+        for (int32 Col = 0; Col < Cols; ++Col) {
+            if (Board[Row][Col] == ECell::Ocean && ToCoast[Row * Cols + Col] > MinSquared) {
+                ModifiedBoard[Row][Col] = ECell::DeepOcean;
             }
         }
     }
-
-    return NextBoard;
+    return ModifiedBoard;
 }
 
 
-// CanTransform checks if a cell of a given type is eligible for transformation.
-// It returns true if the cell can be transformed, and false otherwise.
-bool ADiamondSquare::CanTransform(ECell CellType) const {
-    // Define which cell types should not be transformed.
-    // Assuming TempCold, TempWarm, etc., represent temperature states that should be preserved.
-    TArray<ECell> NonTransformableTypes = { ECell::Temperate, ECell::Warm, ECell::Cold, ECell::Freezing, ECell::Temperate, };
-
-    // Check if the cell type is in the list of types that should not be transformed.
-    return !NonTransformableTypes.Contains(CellType);
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::AddTemps(const TArray<TArray<ECell>>& Board)
+{
+    return RunCellPass(Board, EBiomeStage::AddTemps, {});
 }
 
 
-TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::FuzzyZoom(const TArray<TArray<ADiamondSquare::ECell>>& Board)
+ADiamondSquare::ECell ADiamondSquare::AddTempsCell(ECell Cell)
 {
-    const int32 Rows = Board.Num();
-    const int32 Cols = Board[0].Num();
-    TArray<TArray<ECell>> ScaledBoard;
-
-    // Scale the board by a factor of 2
-    ScaledBoard.SetNum(Rows * 2);
-    for (int32 i = 0; i < Rows * 2; ++i)
-    {
-        ScaledBoard[i].SetNum(Cols * 2);
-        for (int32 j = 0; j < Cols * 2; ++j)
-        {
-            ScaledBoard[i][j] = Board[i / 2][j / 2];
-        }
-    }
+    return FGenerationCoreAdapter::FromCore(GenerationCore::AddTempsCell(FGenerationCoreAdapter::ToCore(Cell), Rng));
+}
 
-    for (int32 i = 0; i < Rows * 2; ++i)
-    {
-        for (int32 j = 0; j < Cols * 2; ++j)
-        {
-            if (IsEdgeCell(ScaledBoard, i, j))
-            {
-                // Generate xoff and yoff uniformly from [-1, 0, 1]
-                int32 xoff = Rng.RandRange(-1, 1);
-                int32 yoff = Rng.RandRange(-1, 1);
-
-                // Update the cell value, ensuring we stay within bounds
-                int32 new_i = FMath::Clamp(i + xoff, 0, Rows * 2 - 1);
-                int32 new_j = FMath::Clamp(j + yoff, 0, Cols * 2 - 1);
-                ScaledBoard[i][j] = ScaledBoard[new_i][new_j];
-            }
-        }
-    }
 
-    return ScaledBoard;
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::Zoom(const TArray<TArray<ECell>>& Board)
+{
+    const uint32 StageSeed = NextZoomSeed();
+    return FGenerationCoreAdapter::FromCore(GenerationCore::Zoom(FGenerationCoreAdapter::ToCore(Board), StageSeed));
 }
 
 
-bool ADiamondSquare::IsEdgeCell(const TArray<TArray<ECell>>& Board, int32 R, int32 C)
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::AddIsland(const TArray<TArray<ADiamondSquare::ECell>>& Board)
 {
-    // Assuming Board is a valid 2D array with dimensions already checked elsewhere
-    if (Board.Num() == 0 || Board[0].Num() == 0)
-    {
-        return false; // Early exit if the board is empty or not properly initialized
-    }
-
-    int32 Dims = Board.Num(); // Assuming square board for simplicity
-    ECell Key = Board[R][C];
+    return FGenerationCoreAdapter::FromCore(GenerationCore::AddIsland(FGenerationCoreAdapter::ToCore(Board), ProbabilityOfLand, Rng));
+}
 
-    // Directions to check: Up, Down, Left, Right
-    TArray<FIntPoint> Directions = {
-        FIntPoint(-1, 0), // Up
-        FIntPoint(1, 0),  // Down
-        FIntPoint(0, -1), // Left
-        FIntPoint(0, 1)   // Right
-    };
 
-    for (FIntPoint Dir : Directions)
-    {
-        int32 NR = R + Dir.X;
-        int32 NC = C + Dir.Y;
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::AddIsland2(const TArray<TArray<ADiamondSquare::ECell>>& Board)
+{
+    return FGenerationCoreAdapter::FromCore(GenerationCore::AddIsland2(FGenerationCoreAdapter::ToCore(Board), ProbabilityOfLand, Rng));
+}
 
-        // Check if the new row and column are within the board bounds
-        if (NR >= 0 && NR < Dims && NC >= 0 && NC < Dims)
-        {
-            // Check if the adjacent cell is different from the current cell
-            if (Board[NR][NC] != Key)
-            {
-                return true; // This is an edge cell
-            }
-        }
-    }
 
-    return false; // Not an edge cell
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::FuzzyZoom(const TArray<TArray<ADiamondSquare::ECell>>& Board)
+{
+    return FGenerationCoreAdapter::FromCore(GenerationCore::FuzzyZoom(FGenerationCoreAdapter::ToCore(Board), Rng));
 }
 
 
 TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::Island(TArray<TArray<ECell>>& Board)
 {
-    // Assuming ECell is the enum with Land and Ocean
-    const float ProbLand = 0.1f;
-    Board.SetNum(4);
+    Board = FGenerationCoreAdapter::FromCore(GenerationCore::Island(Rng));
+    return Board;
+}
 
-    // Initialize the board with ocean cells
-    for (int32 i = 0; i < 4; ++i)
-    {
-        Board[i].SetNum(4);
-        for (int32 j = 0; j < 4; ++j)
-        {
-            Board[i][j] = ECell::Ocean;
-        }
-    }
 
-    // Populate the board with land cells based on ProbLand
+FBiomeBitboard ADiamondSquare::IslandBits()
+{
+    const float ProbLand = 0.1f;
+    FBiomeBitboard Board;
+    Board.Init(4, 4);
+
+    // Same draws, in the same order, as Island
     for (int32 i = 0; i < 4; ++i)
     {
         for (int32 j = 0; j < 4; ++j)
         {
-            if (Rng.FRand() <= ProbLand) // FRand() returns a float between 0.0 and 1.0
+            if (Rng.FRand() <= ProbLand)
             {
-                Board[i][j] = ECell::Land;
+                Board.Set(i, j, true);
             }
         }
     }
     return Board;
-
-    // At this point, Board is filled with cells. You can return it or use it as needed.
-    // Note: Adjustments might be needed based on how you plan to use the board.
 }
 
 
-TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::RemoveTooMuchOcean(const TArray<TArray<ADiamondSquare::ECell>>& Board)
+FBiomeBitboard ADiamondSquare::FuzzyZoomBits(const FBiomeBitboard& Board)
 {
-    const float PLand = 0.35f; // Probability of changing an ocean cell to land
+    FBiomeBitboard ScaledBoard = Board.Upscale2x();
+    const int32 ScaledRows = ScaledBoard.Rows;
+    const int32 ScaledCols = ScaledBoard.Cols;
 
-    TArray<TArray<ECell>> NewBoard = Board; // Assuming deep copy isn't needed
-
-    for (int32 i = 0; i < Board.Num(); ++i)
-    {
-        for (int32 j = 0; j < Board[i].Num(); ++j)
+    ScaledBoard.JitterEdges([this, ScaledRows, ScaledCols](int32 i, int32 j)
         {
-            if (Board[i][j] == ECell::Ocean && IsSurroundedByOcean(Board, i, j))
-            {
-                if (Rng.FRand() < PLand) // Chance to convert to land
-                {
-                    NewBoard[i][j] = ECell::Land;
-                }
-            }
-        }
-    }
+            // Generate xoff and yoff uniformly from [-1, 0, 1]
+            int32 xoff = Rng.RandRange(-1, 1);
+            int32 yoff = Rng.RandRange(-1, 1);
+            return FIntPoint(FMath::Clamp(i + xoff, 0, ScaledRows - 1), FMath::Clamp(j + yoff, 0, ScaledCols - 1));
+        });
 
-    return NewBoard;
+    return ScaledBoard;
 }
 
 
-bool ADiamondSquare::IsSurroundedByOcean(const TArray<TArray<ADiamondSquare::ECell>>& Board, int32 i, int32 j)
+FBiomeBitboard ADiamondSquare::ZoomBits(const FBiomeBitboard& Board)
 {
-    const int32 Rows = Board.Num();
-    const int32 Cols = Board[0].Num();
-
-    if (i > 0 && Board[i - 1][j] != ECell::Ocean) return false; // Check up
-    if (i < Rows - 1 && Board[i + 1][j] != ECell::Ocean) return false; // Check down
-    if (j > 0 && Board[i][j - 1] != ECell::Ocean) return false; // Check left
-    if (j < Cols - 1 && Board[i][j + 1] != ECell::Ocean) return false; // Check right
+    const uint32 StageSeed = NextZoomSeed();
+    const FBiomeBitboard Scaled = Board.Upscale2x();
+    const int32 ScaledRows = Scaled.Rows;
+    const int32 ScaledCols = Scaled.Cols;
+    FBiomeBitboard ScaledBoard = Scaled;
+
+    // Same rule as FBiomeTiles::ZoomCell: edge cells copy a jittered cell of the upscaled input
+    Scaled.ForEachCell(
+        [&Scaled](int32 R, int32 WordIndex) { return Scaled.EdgeWord(R, WordIndex); },
+        [&Scaled, &ScaledBoard, StageSeed, ScaledRows, ScaledCols](int32 i, int32 j)
+        {
+            const FIntPoint Offset = FBiomeTiles::ZoomOffset(StageSeed, i, j);
+            ScaledBoard.Set(i, j, Scaled.Get(FMath::Clamp(i + Offset.X, 0, ScaledRows - 1), FMath::Clamp(j + Offset.Y, 0, ScaledCols - 1)));
+        });
 
-    return true; // Surrounded by ocean
+    return ScaledBoard;
 }
 
 
-bool ADiamondSquare::IsAdjacentToGroup(const TArray<TArray<ECell>>& Board, int32 X, int32 Y, const TSet<ECell>& GroupA, const TSet<ECell>& GroupB)
+FBiomeBitboard ADiamondSquare::AddIslandBits(const FBiomeBitboard& Board)
 {
-    const int32 Rows = Board.Num();
-    const int32 Cols = Board[0].Num();
+    FBiomeBitboard NextBoard = Board;
 
-    for (int32 i = FMath::Max(0, X - 1); i <= FMath::Min(X + 1, Rows - 1); ++i)
-    {
-        for (int32 j = FMath::Max(0, Y - 1); j <= FMath::Min(Y + 1, Cols - 1); ++j)
-        {
-            if (i == X && j == Y) continue; // Skip the cell itself
-            if (GroupA.Contains(Board[X][Y]) && GroupB.Contains(Board[i][j]))
-                return true;
-        }
-    }
+    // Land and Ocean can always transform, so every edge cell is redrawn
+    Board.ForEachCell(
+        [&Board](int32 R, int32 WordIndex) { return Board.EdgeWord(R, WordIndex); },
+        [this, &NextBoard](int32 i, int32 j) { NextBoard.Set(i, j, Rng.FRand() < ProbabilityOfLand); });
 
-    return false;
+    return NextBoard;
 }
 
 
-TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::WarmToTemperate(const TArray<TArray<ECell>>& Board)
+FBiomeBitboard ADiamondSquare::RemoveTooMuchOceanBits(const FBiomeBitboard& Board)
 {
-    // First, create a copy of the Board to modify and return
-    TArray<TArray<ECell>> ModifiedBoard = Board;
-
-    // Get the number of rows and columns
-    int32 Rows = Board.Num();
-    int32 Columns = Board[0].Num();
+    const float PLand = 0.35f; // Probability of changing an ocean cell to land
+    FBiomeBitboard NewBoard = Board;
 
-    // Iterate over each cell in the Board
-    for (int32 Row = 0; Row < Rows; ++Row)
-    {
-        for (int32 Column = 0; Column < Columns; ++Column)
+    Board.ForEachCell(
+        [&Board](int32 R, int32 WordIndex) { return Board.SurroundedByOceanWord(R, WordIndex); },
+        [this, &NewBoard, PLand](int32 i, int32 j)
         {
-            // Check if the current cell is Warm
-            if (Board[Row][Column] == ECell::Warm)
+            if (Rng.FRand() < PLand) // Chance to convert to land
             {
-                // Check adjacent cells for Cold or Freezing
-                bool AdjacentToCooler = false;
-
-                // Check above
-                if (Row > 0 && (Board[Row - 1][Column] == ECell::Cold || Board[Row - 1][Column] == ECell::Freezing))
-                {
-                    AdjacentToCooler = true;
-                }
-
-                // Check below
-                if (Row < Rows - 1 && (Board[Row + 1][Column] == ECell::Cold || Board[Row + 1][Column] == ECell::Freezing))
-                {
-                    AdjacentToCooler = true;
-                }
-
-                // Check left
-                if (Column > 0 && (Board[Row][Column - 1] == ECell::Cold || Board[Row][Column - 1] == ECell::Freezing))
-                {
-                    AdjacentToCooler = true;
-                }
-
-                // Check right
-                if (Column < Columns - 1 && (Board[Row][Column + 1] == ECell::Cold || Board[Row][Column + 1] == ECell::Freezing))
-                {
-                    AdjacentToCooler = true;
-                }
-
-                // If adjacent to cooler cell, change to Temperate
-                if (AdjacentToCooler)
-                {
-                    ModifiedBoard[Row][Column] = ECell::Temperate;
-                }
+                NewBoard.Set(i, j, true);
             }
-        }
-    }
+        });
 
-    // Return the modified board
-    return ModifiedBoard;
+    return NewBoard;
 }
 
 
-void ADiamondSquare::SetBoardRegion(TArray<TArray<ECell>>& Board, int32 CenterX, int32 CenterY, int32 Radius, ECell NewState)
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::ExpandBitboard(const FBiomeBitboard& Board) const
 {
-    const int32 Rows = Board.Num();
-    const int32 Cols = Board[0].Num();
-
-    for (int32 i = FMath::Max(0, CenterX - Radius); i <= FMath::Min(CenterX + Radius, Rows - 1); ++i)
+    TArray<TArray<ECell>> Cells;
+    Cells.SetNum(Board.Rows);
+    for (int32 i = 0; i < Board.Rows; ++i)
     {
-        for (int32 j = FMath::Max(0, CenterY - Radius); j <= FMath::Min(CenterY + Radius, Cols - 1); ++j)
+        Cells[i].SetNumUninitialized(Board.Cols);
+        for (int32 j = 0; j < Board.Cols; ++j)
         {
-            Board[i][j] = NewState;
+            Cells[i][j] = Board.Get(i, j) ? ECell::Land : ECell::Ocean;
         }
     }
+    return Cells;
 }
 
 
-// Main function to convert freezing land adjacent to warm or temperate regions to cold
-TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::FreezingToCold(const TArray<TArray<ECell>>& Board)
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::RemoveTooMuchOcean(const TArray<TArray<ADiamondSquare::ECell>>& Board)
 {
-    TArray<TArray<ECell>> NextBoard = Board; // Copy board
-    int32 Rows = Board.Num();
-    int32 Cols = Board[0].Num(); // Assuming all rows are the same length
-
-    for (int32 Row = 0; Row < Rows; ++Row)
-    {
-        for (int32 Column = 0; Column < Cols; ++Column)
-        {
-            // Check if the current cell is Freezing
-            if (Board[Row][Column] == ECell::Freezing)
-            {
-                // Check adjacent cells for Warm or Temperate
-                bool AdjacentToWarmer = false;
-
-                // Directions: Up, Down, Left, Right
-                TArray<FIntPoint> Directions = {
-                    FIntPoint(-1, 0), // Up
-                    FIntPoint(1, 0),  // Down
-                    FIntPoint(0, -1), // Left
-                    FIntPoint(0, 1)   // Right
-                };
-
-                for (const FIntPoint& Dir : Directions)
-                {
-                    int32 AdjRow = Row + Dir.X;
-                    int32 AdjCol = Column + Dir.Y;
-
-                    // Check bounds and then check for Warm or Temperate
-                    if (AdjRow >= 0 && AdjRow < Rows && AdjCol >= 0 && AdjCol < Cols &&
-                        (Board[AdjRow][AdjCol] == ECell::Warm || Board[AdjRow][AdjCol] == ECell::Temperate))
-                    {
-                        AdjacentToWarmer = true;
-                        break; // Break as we only need one match
-                    }
-                }
+    return FGenerationCoreAdapter::FromCore(GenerationCore::RemoveTooMuchOcean(FGenerationCoreAdapter::ToCore(Board), Rng));
+}
 
-                // If adjacent to a warmer cell, change to Cold
-                if (AdjacentToWarmer)
-                {
-                    NextBoard[Row][Column] = ECell::Cold;
-                }
-            }
-        }
-    }
 
-    return NextBoard;
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::WarmToTemperate(const TArray<TArray<ECell>>& Board)
+{
+    // Warm cells next to Cold or Freezing become Temperate
+    const FBiomeCellRule* const Rule = FBiomePipelinePlanner::GetCellRule(EBiomeStage::WarmToTemperate);
+    return RunCellPass(Board, {}, MakeArrayView(&Rule, 1));
 }
 
 
-ADiamondSquare::ECell ADiamondSquare::SelectBiome(const TArray<ECell>& Biomes, const TArray<float>& Odds)
+// Main function to convert freezing land adjacent to warm or temperate regions to cold
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::FreezingToCold(const TArray<TArray<ECell>>& Board)
 {
-    float Roll = Rng.FRand(); // Roll a random number between 0.0 and 1.0
-    float Cumulative = 0.0f;
-    for (int32 Index = 0; Index < Biomes.Num(); ++Index)
-    {
-        Cumulative += Odds[Index];
-        if (Roll < Cumulative)
-        {
-            return Biomes[Index];
-        }
-    }
-    return Biomes.Last(); // Default to the last biome if none selected
+    // Freezing cells next to Warm or Temperate become Cold
+    const FBiomeCellRule* const Rule = FBiomePipelinePlanner::GetCellRule(EBiomeStage::FreezingToCold);
+    return RunCellPass(Board, {}, MakeArrayView(&Rule, 1));
 }
 
 
 TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::TemperatureToBiome(const TArray<TArray<ECell>>& Board)
 {
-    TArray<TArray<ECell>> NewBoard = Board;
+    return RunCellPass(Board, EBiomeStage::TemperatureToBiome, {});
+}
 
-    for (int32 Row = 0; Row < Board.Num(); ++Row)
-    {
-        for (int32 Col = 0; Col < Board[Row].Num(); ++Col)
-        {
-            if (Board[Row][Col] != ECell::Ocean)
-            {
-                // Example mapping for Warm temperature to biomes
-                if (Board[Row][Col] == ECell::Warm)
-                {
-                    TArray<ECell> Biomes = { ECell::Desert, ECell::Plains, ECell::Rainforest, ECell::Savannah, ECell::Swamp, ECell::Steppe, ECell::Mesa, ECell::Grassland };
-                    TArray<float> Odds = { 0.2f, 0.3f, 0.05f, 0.15f, 0.02f, 0.1f, 0.05f, 0.13f };
-                    NewBoard[Row][Col] = SelectBiome(Biomes, Odds);
-                }
-                else if (Board[Row][Col] == ECell::Temperate)
-                {
-                    TArray<ECell> Biomes = { ECell::Woodland, ECell::Forest, ECell::Highland, ECell::Marsh };
-                    TArray<float> Odds = { 0.2f, 0.5f, 0.2f, 0.1f };
-                    NewBoard[Row][Col] = SelectBiome(Biomes, Odds);
-                }
-                else if (Board[Row][Col] == ECell::Cold)
-                {
-                    TArray<ECell> Biomes = { ECell::Taiga, ECell::SnowyForest, ECell::Highland, ECell::Volcanic };
-                    TArray<float> Odds = { 0.4f, 0.3f, 0.25f, 0.05f };
-                    NewBoard[Row][Col] = SelectBiome(Biomes, Odds);
-                }
-                else if (Board[Row][Col] == ECell::Freezing)
-                {
-                    TArray<ECell> Biomes = { ECell::Tundra, ECell::IcePlains, ECell::Ice, ECell::SnowyForest};
-                    TArray<float> Odds = { 0.4f, 0.3f, 0.15f, 0.1f, 0.05f };
-                    NewBoard[Row][Col] = SelectBiome(Biomes, Odds);
-                }
-            }
-        }
-    }
 
-    return NewBoard;
+ADiamondSquare::ECell ADiamondSquare::TemperatureToBiomeCell(ECell Cell)
+{
+    return FGenerationCoreAdapter::FromCore(GenerationCore::TemperatureToBiomeCell(FGenerationCoreAdapter::ToCore(Cell), Rng));
 }
 
 
 TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::SurroundWithOcean(TArray<TArray<ECell>>& Board)
 {
-    int32 Rows = Board.Num();
-    if (Rows == 0) return Board;
-
-    int32 Cols = Board[0].Num();
-
-    // Set the top and bottom rows to Ocean
-    for (int32 Col = 0; Col < Cols; ++Col)
-    {
-        Board[0][Col] = ECell::Ocean;
-        Board[Rows - 1][Col] = ECell::Ocean;
-    }
-
-    // Set the first and last columns to Ocean
-    for (int32 Row = 0; Row < Rows; ++Row)
-    {
-        Board[Row][0] = ECell::Ocean;
-        Board[Row][Cols - 1] = ECell::Ocean;
-    }
-
+    GenerationCore::FBiomeBoard CoreBoard = FGenerationCoreAdapter::ToCore(Board);
+    GenerationCore::SurroundWithOcean(CoreBoard);
+    Board = FGenerationCoreAdapter::FromCore(CoreBoard);
     return Board;
 }
 
@@ -1208,38 +2633,59 @@ void ADiamondSquare::PrintBoard(const TArray<TArray<ECell>>& Board)
 }
 
 
-TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::Shore(const TArray<TArray<ADiamondSquare::ECell>>& Board) {
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::Shore(const TArray<TArray<ADiamondSquare::ECell>>& Board, float Width) {
     TArray<TArray<ECell>> ModifiedBoard = Board; // Make a copy of the board to modify and return.
+    const int32 Rows = Board.Num();
+    const int32 Cols = Board[0].Num();
 
-    int ShoreDepth = 0; // Assuming we want beaches to be 1 cell wide
-
-    TSet<ECell> IgnoreSet = { ECell::Tundra, ECell::IcePlains, ECell::Taiga, ECell::SnowyForest, ECell::DeepOcean, ECell::Ice };
-    TSet<ECell> OceanSet = { ECell::Ocean }; 
-    TSet<ECell> DeepOceanSet = { ECell::DeepOcean };
-
-    for (int32 Row = 0; Row < Board.Num(); ++Row) {
-        for (int32 Col = 0; Col < Board[Row].Num(); ++Col) {
-            ECell CurrentCell = Board[Row][Col];
-            // Check adjacency to Ocean and ensure it is not adjacent to Deep Ocean
-            if (CurrentCell != ECell::Ocean && IsAdjacentToGroup(Board, Row, Col, { CurrentCell }, OceanSet) &&
-                !IsAdjacentToGroup(Board, Row, Col, { CurrentCell }, DeepOceanSet)) {
-                if (IgnoreSet.Contains(CurrentCell)) {
-                    // Set cells from IgnoreSet that are adjacent to ocean but not adjacent to deep ocean to ColdBeach
-                    SetBoardRegion(ModifiedBoard, Row, Col, ShoreDepth, ECell::ColdBeach);
-                }
-                else if (CurrentCell == ECell::Swamp) {
-                    // Special treatment for swamp cells adjacent to ocean
-                    SetBoardRegion(ModifiedBoard, Row, Col, ShoreDepth, ECell::SwampShore);
-                }
-                else {
-                    // Standard treatment for other land cells adjacent to ocean
-                    SetBoardRegion(ModifiedBoard, Row, Col, ShoreDepth, ECell::Beach);
-                }
+    if (FBiomePipelinePlanner::IsStencilRadius(Width)) {
+        auto Get = [&Board](int32 R, int32 C) { return Board[R][C]; };
+
+        // Beaches are one cell wide: land next to Ocean but not next to DeepOcean
+        for (int32 Row = 0; Row < Rows; ++Row) {
+            for (int32 Col = 0; Col < Cols; ++Col) {
+                ModifiedBoard[Row][Col] = FBiomeTiles::ShoreCell(Get, Rows, Cols, Row, Col);
+            }
+        }
+        return ModifiedBoard;
+    }
+
+    // Land within Width of Ocean becomes beach, unless DeepOcean is just as close
+    const TArray<float> ToOcean = FBiomeDistance::SquaredDistance(
+        FBiomeDistance::MakeFeatures(Board, [](ECell Cell) { return Cell == ECell::Ocean; }), Rows, Cols, false);
+    const TArray<float> ToDeepOcean = FBiomeDistance::SquaredDistance(
+        FBiomeDistance::MakeFeatures(Board, [](ECell Cell) { return Cell == ECell::DeepOcean; }), Rows, Cols, false);
+
+    const float MaxSquared = Width * Width;
+    for (int32 Row = 0; Row < Rows; ++Row) {
+        for (int32 Col = 0; Col < Cols; ++Col) {
+            const int32 Index = Row * Cols + Col;
+            if (Board[Row][Col] != ECell::Ocean && ToOcean[Index] <= MaxSquared && ToDeepOcean[Index] > MaxSquared) {
+                ModifiedBoard[Row][Col] = FBiomeTiles::ShoreBiome(Board[Row][Col]);
             }
         }
     }
+    return ModifiedBoard;
+}
+
+
+TArray<TArray<ADiamondSquare::ECell>> ADiamondSquare::RemoveSpecks(const TArray<TArray<ADiamondSquare::ECell>>& Board, int32 MinArea) {
+    TArray<TArray<ECell>> ModifiedBoard = Board;
+    const int32 Rows = Board.Num();
+    const int32 Cols = Rows > 0 ? Board[0].Num() : 0;
 
+    // Class 1 is land; any land region below MinArea sinks, however it is shaped
+    const FBiomeRegions Regions = FBiomeRegions::Label(
+        FBiomeRegions::MakeClasses(Board, [](ECell Cell) { return (OceanCells | DeepOceanCells).Contains(Cell) ? 0 : 1; }), Rows, Cols);
 
+    for (int32 Row = 0; Row < Rows; ++Row) {
+        for (int32 Col = 0; Col < Cols; ++Col) {
+            const FBiomeRegion& Region = Regions.Regions[Regions.Labels[Row * Cols + Col]];
+            if (Region.Class == 1 && Region.Area < MinArea) {
+                ModifiedBoard[Row][Col] = ECell::Ocean;
+            }
+        }
+    }
     return ModifiedBoard;
 }
 
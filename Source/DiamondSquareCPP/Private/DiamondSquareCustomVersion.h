@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/Guid.h"
+
+// Versions of the data ADiamondSquare::Serialize writes after its properties
+struct FDiamondSquareCustomVersion
+{
+    enum Type
+    {
+        // Only the properties were saved
+        BeforeCustomVersionWasAdded = 0,
+
+        // The quantized height plane follows the properties
+        SavedHeightField,
+
+        // The run-length biome map follows the height plane
+        SavedBiomeRuns,
+
+        VersionPlusOne,
+        LatestVersion = VersionPlusOne - 1
+    };
+
+    static const FGuid GUID;
+};
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Log category of the DiamondSquareCPP module; defined in DiamondSquare.cpp
+DECLARE_LOG_CATEGORY_EXTERN(LogDiamondSquare, Log, All);
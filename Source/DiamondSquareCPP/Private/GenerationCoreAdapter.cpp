@@ -0,0 +1,79 @@
+#include "GenerationCoreAdapter.h"
+
+// The cell enums are converted by value, so every value has to line up
+static constexpr bool CellsMatch()
+{
+    using ECell = ADiamondSquare::ECell;
+    using ECoreCell = GenerationCore::ECell;
+    const ECell Cells[] = {
+        ECell::Land, ECell::Ocean, ECell::Warm, ECell::Cold, ECell::Freezing, ECell::Temperate,
+        ECell::DeepOcean, ECell::Desert, ECell::SandDunes, ECell::Plains, ECell::Grassland, ECell::Rainforest,
+        ECell::Savannah, ECell::Swamp, ECell::Marsh, ECell::Woodland, ECell::Forest, ECell::Highland,
+        ECell::Taiga, ECell::SnowyForest, ECell::Tundra, ECell::IcePlains, ECell::Mountain, ECell::Volcanic,
+        ECell::Beach, ECell::River, ECell::SwampShore, ECell::Ice, ECell::ColdBeach, ECell::Oasis,
+        ECell::Steppe, ECell::Mesa };
+    const ECoreCell CoreCells[] = {
+        ECoreCell::Land, ECoreCell::Ocean, ECoreCell::Warm, ECoreCell::Cold, ECoreCell::Freezing, ECoreCell::Temperate,
+        ECoreCell::DeepOcean, ECoreCell::Desert, ECoreCell::SandDunes, ECoreCell::Plains, ECoreCell::Grassland, ECoreCell::Rainforest,
+        ECoreCell::Savannah, ECoreCell::Swamp, ECoreCell::Marsh, ECoreCell::Woodland, ECoreCell::Forest, ECoreCell::Highland,
+        ECoreCell::Taiga, ECoreCell::SnowyForest, ECoreCell::Tundra, ECoreCell::IcePlains, ECoreCell::Mountain, ECoreCell::Volcanic,
+        ECoreCell::Beach, ECoreCell::River, ECoreCell::SwampShore, ECoreCell::Ice, ECoreCell::ColdBeach, ECoreCell::Oasis,
+        ECoreCell::Steppe, ECoreCell::Mesa };
+    for (int32 Index = 0; Index < int32(UE_ARRAY_COUNT(Cells)); ++Index)
+    {
+        if (uint8(Cells[Index]) != Index || uint8(CoreCells[Index]) != Index)
+        {
+            return false;
+        }
+    }
+    return int32(UE_ARRAY_COUNT(Cells)) == GenerationCore::NumCells;
+}
+static_assert(CellsMatch(), "ADiamondSquare::ECell and GenerationCore::ECell must list the same cells in the same order");
+
+
+GenerationCore::FBiomeBoard FGenerationCoreAdapter::ToCore(const TArray<TArray<ECell>>& Board)
+{
+    const int32 Rows = Board.Num();
+    const int32 Cols = Rows > 0 ? Board[0].Num() : 0;
+    GenerationCore::FBiomeBoard Result(Rows, Cols);
+    for (int32 Row = 0; Row < Rows; ++Row)
+    {
+        FMemory::Memcpy(Result.Row(Row), Board[Row].GetData(), Cols * sizeof(ECell));
+    }
+    return Result;
+}
+
+
+TArray<TArray<ADiamondSquare::ECell>> FGenerationCoreAdapter::FromCore(const GenerationCore::FBiomeBoard& Board)
+{
+    TArray<TArray<ECell>> Result;
+    Result.SetNum(Board.Rows);
+    for (int32 Row = 0; Row < Board.Rows; ++Row)
+    {
+        Result[Row].SetNumUninitialized(Board.Cols);
+        FMemory::Memcpy(Result[Row].GetData(), Board.Row(Row), Board.Cols * sizeof(ECell));
+    }
+    return Result;
+}
+
+
+GenerationCore::FFractalNoiseSettings FGenerationCoreAdapter::MakeNoiseSettings(const ADiamondSquare& Terrain)
+{
+    GenerationCore::FFractalNoiseSettings Settings;
+    Settings.Octaves = Terrain.Octaves;
+    Settings.Scale = Terrain.Scale;
+    Settings.Persistence = Terrain.Persistence;
+    Settings.Lacunarity = Terrain.Lacunarity;
+    return Settings;
+}
+
+
+GenerationCore::FGridMeshSettings FGenerationCoreAdapter::MakeMeshSettings(const ADiamondSquare& Terrain)
+{
+    GenerationCore::FGridMeshSettings Settings;
+    Settings.Scale = Terrain.Scale;
+    Settings.UVScale = Terrain.UVScale;
+    Settings.ZMultiplier = Terrain.ZMultiplier;
+    Settings.ZExpo = Terrain.ZExpo;
+    return Settings;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DiamondSquare.h"
+#include "GenerationCore/BiomeStages.h"
+#include "GenerationCore/Foliage.h"
+#include "GenerationCore/GridMesh.h"
+#include "GenerationCore/Noise.h"
+
+// Converts between the actor's boards and settings and the engine-independent GenerationCore types
+struct FGenerationCoreAdapter
+{
+    using ECell = ADiamondSquare::ECell;
+    using ECoreCell = GenerationCore::ECell;
+
+    static FORCEINLINE ECoreCell ToCore(ECell Cell)
+    {
+        return ECoreCell(uint8(Cell));
+    }
+
+    static FORCEINLINE ECell FromCore(ECoreCell Cell)
+    {
+        return ECell(uint8(Cell));
+    }
+
+    static GenerationCore::FBiomeBoard ToCore(const TArray<TArray<ECell>>& Board);
+    static TArray<TArray<ECell>> FromCore(const GenerationCore::FBiomeBoard& Board);
+
+    static GenerationCore::FFractalNoiseSettings MakeNoiseSettings(const ADiamondSquare& Terrain);
+    static GenerationCore::FGridMeshSettings MakeMeshSettings(const ADiamondSquare& Terrain);
+
+    // The engine's Perlin noise, so the core's fractal sum gives the same heights as before
+    struct FEngineNoise
+    {
+        float operator()(float X, float Y) const
+        {
+            return FMath::PerlinNoise2D(FVector2D(X, Y));
+        }
+    };
+};
@@ -0,0 +1,395 @@
+#include "PlanetTerrain.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformTime.h"
+#include "ProceduralMeshComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "CubeSphere.h"
+#include "DiamondSquareLog.h"
+
+
+FVector FPlanetShape::GetNoiseOffset(int32 Salt) const
+{
+    // Perlin noise repeats every 256 units, so offsets within that range give independent fields
+    FRandomStream Stream(HashCombine(GetTypeHash(Seed), GetTypeHash(Salt)));
+    return FVector(Stream.FRandRange(0.0f, 256.0f), Stream.FRandRange(0.0f, 256.0f), Stream.FRandRange(0.0f, 256.0f));
+}
+
+
+float FPlanetShape::GetElevation(const FVector& Direction) const
+{
+    const FVector Offset = GetNoiseOffset(0);
+    float Amplitude = 1.0f;
+    float OctaveFrequency = Frequency;
+    float NoiseHeight = 0.0f;
+    float TotalAmplitude = 0.0f;
+    for (int32 Octave = 0; Octave < Octaves; ++Octave)
+    {
+        NoiseHeight += FMath::PerlinNoise3D(Direction * OctaveFrequency + Offset) * Amplitude;
+        TotalAmplitude += Amplitude;
+        Amplitude *= Persistence;
+        OctaveFrequency *= Lacunarity;
+    }
+
+    // Summed octaves rarely reach their bounds, so stretch them before mapping to [0, 1]
+    return FMath::Clamp(0.5f + NoiseHeight / FMath::Max(TotalAmplitude, KINDA_SMALL_NUMBER), 0.0f, 1.0f);
+}
+
+
+ADiamondSquare::ECell FPlanetShape::GetBiome(const FVector& Direction, float Elevation) const
+{
+    using ECell = ADiamondSquare::ECell;
+
+    // Warmest at the equator, cooling with latitude and altitude
+    const float Altitude = (Elevation - SeaLevel) / FMath::Max(1.0f - SeaLevel, KINDA_SMALL_NUMBER);
+    const float Latitude = FMath::Abs(float(Direction.Z));
+    const float Temperature = 1.0f - Latitude - FMath::Max(Altitude, 0.0f) * 0.4f
+        + 0.1f * FMath::PerlinNoise3D(Direction * 4.0f + GetNoiseOffset(1));
+    const float Moisture = 0.5f + FMath::PerlinNoise3D(Direction * 3.0f + GetNoiseOffset(2));
+
+    if (Altitude < 0.0f)
+    {
+        if (Temperature < 0.15f)
+        {
+            return ECell::Ice;
+        }
+        return Elevation < SeaLevel * 0.85f ? ECell::DeepOcean : ECell::Ocean;
+    }
+    if (Altitude < 0.02f)
+    {
+        return Temperature < 0.3f ? ECell::ColdBeach : ECell::Beach;
+    }
+    if (Altitude > 0.7f)
+    {
+        return ECell::Mountain;
+    }
+    if (Altitude > 0.5f)
+    {
+        return ECell::Highland;
+    }
+
+    if (Temperature < 0.15f)
+    {
+        return ECell::Ice;
+    }
+    if (Temperature < 0.3f)
+    {
+        return ECell::Tundra;
+    }
+    if (Temperature < 0.45f)
+    {
+        return Moisture > 0.5f ? ECell::SnowyForest : ECell::Taiga;
+    }
+    if (Temperature < 0.7f)
+    {
+        if (Moisture > 0.7f && Altitude < 0.08f)
+        {
+            return ECell::Swamp;
+        }
+        return Moisture > 0.6f ? ECell::Forest : (Moisture > 0.35f ? ECell::Plains : ECell::Grassland);
+    }
+    return Moisture > 0.65f ? ECell::Rainforest : (Moisture > 0.4f ? ECell::Savannah : ECell::Desert);
+}
+
+
+void FPlanetChunkMesh::Build(const FPlanetShape& Shape, int32 Face, int32 ChunkX, int32 ChunkY, int32 ChunksPerFace, int32 Resolution, float SkirtDepth)
+{
+    const int32 Samples = Resolution + 1;
+    const int32 FaceSamples = ChunksPerFace * Resolution;
+
+    // Surface points with a one-sample ring around the chunk, so normals on its border match its neighbours'
+    const int32 Padded = Samples + 2;
+    TArray<FVector> Points;
+    Points.SetNumUninitialized(Padded * Padded);
+    Vertices.Reset(Samples * Samples + 4 * Samples);
+    Normals.Reset(Samples * Samples + 4 * Samples);
+    UV0.Reset(Samples * Samples + 4 * Samples);
+    Colors.Reset(Samples * Samples + 4 * Samples);
+    TArray<FVector> Directions;
+    Directions.SetNumUninitialized(Samples * Samples);
+
+    for (int32 I = -1; I <= Samples; ++I)
+    {
+        const double U = FCubeSphere::GetFaceParameter(ChunkX * Resolution + I, FaceSamples);
+        for (int32 J = -1; J <= Samples; ++J)
+        {
+            const double V = FCubeSphere::GetFaceParameter(ChunkY * Resolution + J, FaceSamples);
+            const FVector Direction = FCubeSphere::GetSpherePoint(Face, U, V).GetSafeNormal();
+            const float Elevation = Shape.GetElevation(Direction);
+            Points[(I + 1) * Padded + (J + 1)] = Shape.GetSurfacePoint(Direction, Elevation);
+
+            if (I >= 0 && J >= 0 && I < Samples && J < Samples)
+            {
+                Directions[I * Samples + J] = Direction;
+                const FLinearColor Color = ADiamondSquare::GetBiomeBaseColor(Elevation, Shape.GetBiome(Direction, Elevation));
+                Colors.Add(Color.ToFColor(false));
+                UV0.Add(FVector2D(0.5 * U + 0.5, 0.5 * V + 0.5));
+            }
+        }
+    }
+
+    auto Point = [&Points, Padded](int32 I, int32 J) { return Points[(I + 1) * Padded + (J + 1)]; };
+    for (int32 I = 0; I < Samples; ++I)
+    {
+        for (int32 J = 0; J < Samples; ++J)
+        {
+            Vertices.Add(Point(I, J));
+            Normals.Add(FVector::CrossProduct(Point(I + 1, J) - Point(I - 1, J), Point(I, J + 1) - Point(I, J - 1)).GetSafeNormal());
+        }
+    }
+
+    // Same winding as the flat terrain, with U as its X and V as its Y
+    Triangles.Reset(6 * Resolution * Resolution + 48 * Resolution);
+    for (int32 I = 0; I < Resolution; ++I)
+    {
+        for (int32 J = 0; J < Resolution; ++J)
+        {
+            const int32 VertexIndex = I * Samples + J;
+            Triangles.Append({ VertexIndex, VertexIndex + Samples + 1, VertexIndex + Samples });
+            Triangles.Append({ VertexIndex, VertexIndex + 1, VertexIndex + Samples + 1 });
+        }
+    }
+
+    // Skirts drop each border edge straight down towards the centre. They are seen from both sides depending
+    // on which neighbour is coarser, so they get both windings.
+    auto AddSkirt = [&](int32 First, int32 Stride)
+        {
+            const int32 Base = Vertices.Num();
+            for (int32 K = 0; K < Samples; ++K)
+            {
+                // Copies first: TArray::Add refuses references into the array it grows
+                const int32 Edge = First + K * Stride;
+                const FVector Normal = Normals[Edge];
+                const FVector2D UV = UV0[Edge];
+                const FColor Color = Colors[Edge];
+                Vertices.Add(Vertices[Edge] - Directions[Edge] * SkirtDepth);
+                Normals.Add(Normal);
+                UV0.Add(UV);
+                Colors.Add(Color);
+            }
+            for (int32 K = 0; K < Resolution; ++K)
+            {
+                const int32 A = First + K * Stride;
+                const int32 B = A + Stride;
+                const int32 LowA = Base + K;
+                const int32 LowB = LowA + 1;
+                Triangles.Append({ A, B, LowB, A, LowB, LowA });
+                Triangles.Append({ A, LowB, B, A, LowA, LowB });
+            }
+        };
+    AddSkirt(0, 1);
+    AddSkirt(Resolution * Samples, 1);
+    AddSkirt(0, Samples);
+    AddSkirt(Resolution, Samples);
+}
+
+
+APlanetTerrain::APlanetTerrain()
+{
+    ProceduralMesh = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("ProceduralMesh"));
+    RootComponent = ProceduralMesh;
+
+    // Ticking is only switched on in game, to follow the camera with the chunk levels of detail
+    PrimaryActorTick.bCanEverTick = true;
+    PrimaryActorTick.bStartWithTickEnabled = false;
+    PrimaryActorTick.TickInterval = 0.25f;
+}
+
+
+void APlanetTerrain::OnConstruction(const FTransform& Transform)
+{
+    Super::OnConstruction(Transform);
+
+    if (recreateMesh)
+    {
+        if (!ProceduralMesh)
+        {
+            UE_LOG(LogTemp, Error, TEXT("Mesh components are not initialized properly."));
+            return;
+        }
+
+        ResetChunks();
+
+        // The editor has no viewer to follow, so every chunk gets the same moderate detail
+        TArray<int32> TargetLODs;
+        TArray<int32> Order;
+        TargetLODs.Init(FMath::Min(ConstructionLOD, GetMaxLOD()), Chunks.Num());
+        for (int32 Index = 0; Index < Chunks.Num(); ++Index)
+        {
+            Order.Add(Index);
+        }
+        BuildChunks(TargetLODs, Order, Chunks.Num());
+
+        recreateMesh = false;
+    }
+}
+
+
+void APlanetTerrain::BeginPlay()
+{
+    Super::BeginPlay();
+
+    // The sections are saved with the level but the chunk bookkeeping is not. Rebuilding it from the levels the
+    // sections were built at shows the planet at once, and only the chunks the camera needs finer are rebuilt.
+    if (Chunks.Num() == 0)
+    {
+        InitChunks();
+        if (SectionLODs.Num() == Chunks.Num() && ProceduralMesh->GetNumSections() == Chunks.Num())
+        {
+            for (int32 Index = 0; Index < Chunks.Num(); ++Index)
+            {
+                Chunks[Index].LOD = SectionLODs[Index];
+            }
+        }
+        else
+        {
+            // Saved with other chunk settings, or never built
+            ResetChunks();
+        }
+    }
+    SetActorTickEnabled(true);
+}
+
+
+void APlanetTerrain::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    if (const APlayerCameraManager* CameraManager = UGameplayStatics::GetPlayerCameraManager(this, 0))
+    {
+        UpdateLOD(CameraManager->GetCameraLocation());
+    }
+}
+
+
+int32 APlanetTerrain::GetMaxLOD() const
+{
+    // Coarsest level keeps two quads per chunk side
+    return FMath::Max(int32(FMath::FloorLog2(uint32(ChunkResolution))) - 1, 0);
+}
+
+
+void APlanetTerrain::ResetChunks()
+{
+    ProceduralMesh->ClearAllMeshSections();
+    InitChunks();
+    SectionLODs.Init(INDEX_NONE, Chunks.Num());
+}
+
+
+void APlanetTerrain::InitChunks()
+{
+    Chunks.Reset();
+
+    const int32 FaceSamples = ChunksPerFace * 2;
+    for (int32 Face = 0; Face < FCubeSphere::NumFaces; ++Face)
+    {
+        for (int32 X = 0; X < ChunksPerFace; ++X)
+        {
+            for (int32 Y = 0; Y < ChunksPerFace; ++Y)
+            {
+                FChunk& Chunk = Chunks.AddDefaulted_GetRef();
+                Chunk.Face = Face;
+                Chunk.X = X;
+                Chunk.Y = Y;
+                Chunk.Center = FCubeSphere::GetSpherePoint(Face, FCubeSphere::GetFaceParameter(2 * X + 1, FaceSamples), FCubeSphere::GetFaceParameter(2 * Y + 1, FaceSamples)) * Shape.Radius;
+
+                float CornerDistance = 0.0f;
+                for (int32 Corner = 0; Corner < 4; ++Corner)
+                {
+                    const double U = FCubeSphere::GetFaceParameter(2 * (X + (Corner & 1)), FaceSamples);
+                    const double V = FCubeSphere::GetFaceParameter(2 * (Y + (Corner >> 1)), FaceSamples);
+                    CornerDistance = FMath::Max(CornerDistance, float(FVector::Dist(FCubeSphere::GetSpherePoint(Face, U, V) * Shape.Radius, Chunk.Center)));
+                }
+                Chunk.BoundRadius = CornerDistance + Shape.HeightScale;
+            }
+        }
+    }
+}
+
+
+void APlanetTerrain::UpdateLOD(const FVector& ViewLocation)
+{
+    if (Chunks.Num() == 0)
+    {
+        return;
+    }
+
+    const FVector LocalView = GetActorTransform().InverseTransformPosition(ViewLocation);
+    const int32 MaxLOD = GetMaxLOD();
+
+    TArray<float> Distances;
+    TArray<int32> TargetLODs;
+    TArray<int32> Order;
+    Distances.SetNumUninitialized(Chunks.Num());
+    TargetLODs.SetNumUninitialized(Chunks.Num());
+    for (int32 Index = 0; Index < Chunks.Num(); ++Index)
+    {
+        const FChunk& Chunk = Chunks[Index];
+        const float Distance = FMath::Max(float(FVector::Dist(LocalView, Chunk.Center)) - Chunk.BoundRadius, 0.0f);
+        Distances[Index] = Distance;
+        TargetLODs[Index] = Distance < LODDistance ? 0 : FMath::Min(int32(FMath::FloorLog2(uint32(Distance / LODDistance))) + 1, MaxLOD);
+        Order.Add(Index);
+    }
+
+    // Nearest chunks first, so the detail under the camera arrives before the horizon's
+    Order.Sort([&Distances](int32 A, int32 B) { return Distances[A] < Distances[B]; });
+    BuildChunks(TargetLODs, Order, MaxChunkBuildsPerUpdate);
+}
+
+
+void APlanetTerrain::BuildChunks(const TArray<int32>& TargetLODs, const TArray<int32>& Order, int32 MaxBuilds)
+{
+    TArray<int32> Pending;
+    for (int32 Index : Order)
+    {
+        if (Chunks[Index].LOD != TargetLODs[Index])
+        {
+            Pending.Add(Index);
+            if (Pending.Num() == MaxBuilds)
+            {
+                break;
+            }
+        }
+    }
+    if (Pending.Num() == 0)
+    {
+        return;
+    }
+
+    double StartTime = FPlatformTime::Seconds();
+
+    // Chunks only read the shape, so they build on all workers; the sections are handed over afterwards
+    TArray<FPlanetChunkMesh> Meshes;
+    Meshes.SetNum(Pending.Num());
+    const FPlanetShape BuildShape = Shape;
+    const float Skirt = SkirtDepth * Shape.HeightScale;
+    ParallelFor(Pending.Num(), [&](int32 PendingIndex)
+        {
+            const FChunk& Chunk = Chunks[Pending[PendingIndex]];
+            const int32 Resolution = FMath::Max(ChunkResolution >> TargetLODs[Pending[PendingIndex]], 2);
+            Meshes[PendingIndex].Build(BuildShape, Chunk.Face, Chunk.X, Chunk.Y, ChunksPerFace, Resolution, Skirt);
+        });
+
+    int32 NumVertices = 0;
+    for (int32 PendingIndex = 0; PendingIndex < Pending.Num(); ++PendingIndex)
+    {
+        const int32 Index = Pending[PendingIndex];
+        FPlanetChunkMesh& Mesh = Meshes[PendingIndex];
+        ProceduralMesh->CreateMeshSection(Index, Mesh.Vertices, Mesh.Triangles, Mesh.Normals, Mesh.UV0, Mesh.Colors, TArray<FProcMeshTangent>(), bCreateCollision);
+        ProceduralMesh->SetMaterial(Index, Material);
+        Chunks[Index].LOD = TargetLODs[Index];
+        SectionLODs[Index] = TargetLODs[Index];
+        NumVertices += Mesh.Vertices.Num();
+    }
+
+    double EndTime = FPlatformTime::Seconds();
+    UE_LOG(LogDiamondSquare, Verbose, TEXT("Planet: built %d chunks (%d vertices) in %f seconds"), Pending.Num(), NumVertices, EndTime - StartTime);
+}
+
+
+ADiamondSquare::ECell APlanetTerrain::GetBiomeAt(const FVector& Direction) const
+{
+    const FVector LocalDirection = GetActorTransform().InverseTransformVectorNoScale(Direction).GetSafeNormal();
+    return Shape.GetBiome(LocalDirection, Shape.GetElevation(LocalDirection));
+}
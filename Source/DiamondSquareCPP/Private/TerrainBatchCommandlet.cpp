@@ -0,0 +1,270 @@
+#include "TerrainBatchCommandlet.h"
+#include "Async/Async.h"
+#include "Dom/JsonObject.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformTime.h"
+#include "JsonObjectConverter.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/QueuedThreadPool.h"
+#include "Misc/ScopeLock.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/Package.h"
+#include "UObject/StrongObjectPtr.h"
+#include "DiamondSquare.h"
+#include "TerrainWorldFile.h"
+#include "DiamondSquareLog.h"
+
+// Stack of each batch worker; the biome stages recurse through ParallelFor and need more than the pool default
+static const uint32 BatchWorkerStackSize = 256 * 1024;
+
+static const int32 NumCellKinds = int32(ADiamondSquare::ECell::Mesa) + 1;
+
+// Peak memory of a job per cell of its map: the noise map, the biome map and the world planes, plus the float
+// scratch planes of erosion, rivers and the distance transforms that live at the same time
+static const int64 BatchJobBytesPerCell = 64;
+
+// Outcome of one seed
+struct FTerrainBatchResult
+{
+    int32 Seed = 0;
+    bool bWritten = false;
+    int32 Rows = 0;
+    int32 Cols = 0;
+    float LandFraction = 0.0f;
+    TArray<int64> Histogram;
+    double GenerateSeconds = 0.0;
+    double WriteSeconds = 0.0;
+};
+
+
+static bool WritePlane(const FString& Path, const void* Data, int64 NumBytes)
+{
+    TUniquePtr<IFileHandle> File(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Path));
+    return File && File->Write(static_cast<const uint8*>(Data), NumBytes);
+}
+
+
+static FTerrainBatchResult RunSeed(ADiamondSquare& Terrain, int32 Seed, const FString& OutputDir, bool bRaw)
+{
+    FTerrainBatchResult Result;
+    Result.Seed = Seed;
+    Result.Histogram.Init(0, NumCellKinds);
+
+    double StartTime = FPlatformTime::Seconds();
+    Terrain.Seed = Seed;
+    FTerrainWorldPlanes World;
+    Terrain.GenerateWorld(World);
+    double GeneratedTime = FPlatformTime::Seconds();
+    Result.GenerateSeconds = GeneratedTime - StartTime;
+    Result.Rows = World.Rows;
+    Result.Cols = World.Cols;
+
+    int64 NumLand = 0;
+    for (const uint8 Biome : World.Biomes)
+    {
+        const ADiamondSquare::ECell Cell = ADiamondSquare::ECell(Biome);
+        Result.Histogram[FMath::Min(int32(Biome), NumCellKinds - 1)]++;
+        NumLand += (ADiamondSquare::OceanCells | ADiamondSquare::DeepOceanCells).Contains(Cell) ? 0 : 1;
+    }
+    Result.LandFraction = World.Biomes.Num() > 0 ? float(double(NumLand) / World.Biomes.Num()) : 0.0f;
+
+    const FString BasePath = OutputDir / FString::Printf(TEXT("Seed_%d"), Seed);
+    if (bRaw)
+    {
+        Result.bWritten = WritePlane(BasePath + TEXT(".r16"), World.Heights.GetData(), World.Heights.Num() * sizeof(uint16))
+            && WritePlane(BasePath + TEXT(".biome"), World.Biomes.GetData(), World.Biomes.Num());
+    }
+    else
+    {
+        Result.bWritten = FTerrainWorldFile::Save(BasePath + TEXT(".dsw"), World);
+    }
+    Result.WriteSeconds = FPlatformTime::Seconds() - GeneratedTime;
+
+    FString Histogram;
+    for (int32 Kind = 0; Kind < NumCellKinds; ++Kind)
+    {
+        if (Result.Histogram[Kind] > 0)
+        {
+            Histogram += FString::Printf(TEXT("%s\"%s\":%lld"), Histogram.IsEmpty() ? TEXT("") : TEXT(","), ADiamondSquare::GetCellName(ADiamondSquare::ECell(Kind)), Result.Histogram[Kind]);
+        }
+    }
+    const FString Stats = FString::Printf(
+        TEXT("{\"seed\":%d,\"rows\":%d,\"cols\":%d,\"landFraction\":%.6f,\"biomes\":{%s},\"generateSeconds\":%.6f,\"writeSeconds\":%.6f}\n"),
+        Seed, Result.Rows, Result.Cols, Result.LandFraction, *Histogram, Result.GenerateSeconds, Result.WriteSeconds);
+    Result.bWritten &= FFileHelper::SaveStringToFile(Stats, *(BasePath + TEXT(".json")));
+
+    UE_LOG(LogDiamondSquare, Verbose, TEXT("Batch: seed %d, %.1f%% land, generated in %f seconds, written in %f seconds"),
+        Seed, 100.0f * Result.LandFraction, Result.GenerateSeconds, Result.WriteSeconds);
+    return Result;
+}
+
+
+UTerrainBatchCommandlet::UTerrainBatchCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+
+int32 UTerrainBatchCommandlet::Main(const FString& Params)
+{
+    double StartTime = FPlatformTime::Seconds();
+
+    FString SeedsText = TEXT("0");
+    FParse::Value(*Params, TEXT("seeds="), SeedsText);
+    FString FirstText = SeedsText;
+    FString LastText = SeedsText;
+    SeedsText.Split(TEXT(".."), &FirstText, &LastText);
+    const int32 FirstSeed = FCString::Atoi(*FirstText);
+    const int32 LastSeed = FCString::Atoi(*LastText);
+    if (!FirstText.IsNumeric() || !LastText.IsNumeric() || LastSeed < FirstSeed)
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("-seeds=%s is not a seed or a range First..Last"), *SeedsText);
+        return 1;
+    }
+
+    // Checked against the class up front, since the converter skips names it does not know
+    TSharedPtr<FJsonObject> Overrides;
+    FString ParamsPath;
+    if (FParse::Value(*Params, TEXT("params="), ParamsPath))
+    {
+        ParamsPath = FPaths::IsRelative(ParamsPath) ? FPaths::ProjectDir() / ParamsPath : ParamsPath;
+        FString Text;
+        if (!FFileHelper::LoadFileToString(Text, *ParamsPath))
+        {
+            UE_LOG(LogDiamondSquare, Error, TEXT("Cannot read %s"), *ParamsPath);
+            return 1;
+        }
+        const TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(Text);
+        if (!FJsonSerializer::Deserialize(Reader, Overrides) || !Overrides.IsValid())
+        {
+            UE_LOG(LogDiamondSquare, Error, TEXT("%s is not a JSON object: %s"), *ParamsPath, *Reader->GetErrorMessage());
+            return 1;
+        }
+        for (const TPair<FString, TSharedPtr<FJsonValue>>& Field : Overrides->Values)
+        {
+            const FProperty* Property = FindFProperty<FProperty>(ADiamondSquare::StaticClass(), FName(*Field.Key));
+            if (!Property || !Property->HasAnyPropertyFlags(CPF_Edit))
+            {
+                UE_LOG(LogDiamondSquare, Error, TEXT("%s: %s is not an editable ADiamondSquare property"), *ParamsPath, *Field.Key);
+                return 1;
+            }
+        }
+    }
+
+    FString OutputDir = TEXT("Terrain/Batch");
+    FParse::Value(*Params, TEXT("out="), OutputDir);
+    OutputDir = FPaths::ConvertRelativePathToFull(FPaths::IsRelative(OutputDir) ? FPaths::ProjectSavedDir() / OutputDir : OutputDir);
+    if (!FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*OutputDir))
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Cannot create %s"), *OutputDir);
+        return 1;
+    }
+    const bool bRaw = FParse::Param(*Params, TEXT("raw"));
+
+    // One terrain per worker, made here on the game thread; a job borrows a free one for its seed
+    TArray<TStrongObjectPtr<ADiamondSquare>> Terrains;
+    TArray<ADiamondSquare*> FreeTerrains;
+    FCriticalSection FreeTerrainsLock;
+    auto AddTerrain = [&]()
+    {
+        ADiamondSquare* Terrain = NewObject<ADiamondSquare>(GetTransientPackage(), NAME_None, RF_Transient);
+        if (Overrides.IsValid() && !FJsonObjectConverter::JsonObjectToUStruct(Overrides.ToSharedRef(), ADiamondSquare::StaticClass(), Terrain, CPF_Edit))
+        {
+            UE_LOG(LogDiamondSquare, Error, TEXT("%s has values that do not fit their properties"), *ParamsPath);
+            return false;
+        }
+        Terrains.Emplace(Terrain);
+        FreeTerrains.Add(Terrain);
+        return true;
+    };
+    if (!AddTerrain())
+    {
+        return 1;
+    }
+
+    // Hyperthreads share the cores the stages inside a job already spread over, so they add no throughput, and
+    // jobs past what the free memory holds would page
+    const int32 NumSeeds = LastSeed - FirstSeed + 1;
+    const int64 JobBytes = BatchJobBytesPerCell * FMath::Max(int64(Terrains[0]->XSize) * Terrains[0]->YSize, int64(1));
+    const int64 JobsInMemory = int64(FPlatformMemory::GetStats().AvailablePhysical) / JobBytes;
+    int32 NumJobs = int32(FMath::Min<int64>(FPlatformMisc::NumberOfCores(), JobsInMemory));
+    FParse::Value(*Params, TEXT("jobs="), NumJobs);
+    NumJobs = FMath::Clamp(NumJobs, 1, NumSeeds);
+    while (Terrains.Num() < NumJobs)
+    {
+        if (!AddTerrain())
+        {
+            return 1;
+        }
+    }
+
+    FQueuedThreadPool* Pool = FQueuedThreadPool::Allocate();
+    if (!Pool->Create(NumJobs, BatchWorkerStackSize, TPri_Normal, TEXT("TerrainBatchWorker")))
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Cannot start %d batch workers"), NumJobs);
+        delete Pool;
+        return 1;
+    }
+    UE_LOG(LogDiamondSquare, Log, TEXT("Batch: seeds %d to %d on %d workers, about %lld MB each, into %s"), FirstSeed, LastSeed, NumJobs, JobBytes >> 20, *OutputDir);
+
+    TArray<TFuture<FTerrainBatchResult>> Futures;
+    for (int32 Seed = FirstSeed; Seed <= LastSeed; ++Seed)
+    {
+        Futures.Add(AsyncPool(*Pool, [&FreeTerrains, &FreeTerrainsLock, &OutputDir, bRaw, Seed]()
+            {
+                // There are as many terrains as workers, so one is always free
+                ADiamondSquare* Terrain = nullptr;
+                {
+                    FScopeLock Lock(&FreeTerrainsLock);
+                    Terrain = FreeTerrains.Pop(false);
+                }
+                FTerrainBatchResult Result = RunSeed(*Terrain, Seed, OutputDir, bRaw);
+                {
+                    FScopeLock Lock(&FreeTerrainsLock);
+                    FreeTerrains.Add(Terrain);
+                }
+                return Result;
+            }));
+    }
+
+    FString Summary = TEXT("Seed,Rows,Cols,LandFraction,GenerateSeconds,WriteSeconds");
+    for (int32 Kind = 0; Kind < NumCellKinds; ++Kind)
+    {
+        Summary += FString::Printf(TEXT(",%s"), ADiamondSquare::GetCellName(ADiamondSquare::ECell(Kind)));
+    }
+    Summary += TEXT("\n");
+    int32 NumFailed = 0;
+    for (TFuture<FTerrainBatchResult>& Future : Futures)
+    {
+        const FTerrainBatchResult Result = Future.Get();
+        NumFailed += Result.bWritten ? 0 : 1;
+        Summary += FString::Printf(TEXT("%d,%d,%d,%.6f,%.6f,%.6f"), Result.Seed, Result.Rows, Result.Cols, Result.LandFraction, Result.GenerateSeconds, Result.WriteSeconds);
+        for (const int64 Count : Result.Histogram)
+        {
+            Summary += FString::Printf(TEXT(",%lld"), Count);
+        }
+        Summary += TEXT("\n");
+    }
+    Pool->Destroy();
+    delete Pool;
+
+    const FString SummaryPath = OutputDir / TEXT("Summary.csv");
+    if (!FFileHelper::SaveStringToFile(Summary, *SummaryPath))
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Cannot write %s"), *SummaryPath);
+        ++NumFailed;
+    }
+
+    double EndTime = FPlatformTime::Seconds();
+    UE_LOG(LogDiamondSquare, Log, TEXT("Batch: %d seeds in %f seconds (%.2f seeds/s), %d failed"),
+        NumSeeds, EndTime - StartTime, NumSeeds / FMath::Max(EndTime - StartTime, 1.0e-6), NumFailed);
+    return NumFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+#include "TerrainBoxBlur.h"
+#include "Async/ParallelFor.h"
+
+
+void FTerrainBoxBlur::BuildTable(const TArray<float>& Plane, int32 Rows, int32 Cols, TArray<double>& OutTable)
+{
+    const int32 Stride = Cols + 1;
+    OutTable.SetNumUninitialized((Rows + 1) * Stride);
+    FMemory::Memzero(OutTable.GetData(), Stride * sizeof(double));
+
+    // Prefix along each row
+    ParallelFor(Rows, [&](int32 R)
+        {
+            double* Row = OutTable.GetData() + (R + 1) * Stride;
+            const float* Source = Plane.GetData() + R * Cols;
+            double Sum = 0.0;
+            Row[0] = 0.0;
+            for (int32 C = 0; C < Cols; ++C)
+            {
+                Sum += Source[C];
+                Row[C + 1] = Sum;
+            }
+        });
+
+    // Then down each column, in bands of columns so every step reads whole cache lines
+    const int32 ColsPerBand = 256;
+    ParallelFor(FMath::DivideAndRoundUp(Stride, ColsPerBand), [&](int32 Band)
+        {
+            const int32 Begin = Band * ColsPerBand;
+            const int32 End = FMath::Min(Begin + ColsPerBand, Stride);
+            for (int32 R = 2; R <= Rows; ++R)
+            {
+                double* Row = OutTable.GetData() + R * Stride;
+                const double* Above = Row - Stride;
+                for (int32 C = Begin; C < End; ++C)
+                {
+                    Row[C] += Above[C];
+                }
+            }
+        });
+}
+
+
+void FTerrainBoxBlur::Blur(TArray<float>& Plane, int32 Rows, int32 Cols, int32 Radius, int32 Passes)
+{
+    if (Rows == 0 || Cols == 0 || Radius <= 0)
+    {
+        return;
+    }
+
+    const int32 Stride = Cols + 1;
+    TArray<double> Table;
+    for (int32 Pass = 0; Pass < Passes; ++Pass)
+    {
+        BuildTable(Plane, Rows, Cols, Table);
+
+        ParallelFor(Rows, [&](int32 R)
+            {
+                const int32 R0 = FMath::Max(R - Radius, 0);
+                const int32 R1 = FMath::Min(R + Radius + 1, Rows);
+                const double* Top = Table.GetData() + R0 * Stride;
+                const double* Bottom = Table.GetData() + R1 * Stride;
+                float* Out = Plane.GetData() + R * Cols;
+                for (int32 C = 0; C < Cols; ++C)
+                {
+                    const int32 C0 = FMath::Max(C - Radius, 0);
+                    const int32 C1 = FMath::Min(C + Radius + 1, Cols);
+                    const double Sum = Bottom[C1] - Bottom[C0] - Top[C1] + Top[C0];
+                    Out[C] = float(Sum / double((R1 - R0) * (C1 - C0)));
+                }
+            });
+    }
+}
@@ -0,0 +1,232 @@
+#include "TerrainCaves.h"
+#include "HAL/PlatformTime.h"
+
+// Offsets of the other noise fields from the first, within the 256-unit period of Perlin noise
+static const FVector SecondTunnelOffset(97.0, 41.0, 163.0);
+static const FVector OverhangOffset(181.0, 139.0, 23.0);
+
+
+float FTerrainCaveField::GetDensity(int32 X, int32 Y, int32 Z, const FTerrainCaveSettings& Settings) const
+{
+    const int32 Index = X * Cols + Y;
+    const float Surface = Heights[Index] - Z;
+    const float Weight = Mask[Index];
+    if (Weight <= 0.0f)
+    {
+        return Surface;
+    }
+
+    const FVector Point = FVector(X, Y, Z) * Settings.Frequency + NoiseOffset;
+    const float Shaped = Surface + Settings.OverhangHeight * Weight * FMath::PerlinNoise3D(Point + OverhangOffset);
+
+    // Each field is hollow in a sheet around its zero set; two sheets cross in a tunnel. Dividing by the
+    // frequency turns the noise distance into roughly cells.
+    const float TunnelNoise = FMath::Max(FMath::Abs(FMath::PerlinNoise3D(Point)), FMath::Abs(FMath::PerlinNoise3D(Point + SecondTunnelOffset)));
+    float Tunnel = (TunnelNoise - Settings.TunnelWidth) / Settings.Frequency;
+
+    // Solid again below Depth, and towards the edge of the mask, so the tunnels close off where the heightmap takes over
+    Tunnel = FMath::Max(Tunnel, Heights[Index] - Settings.Depth - Z);
+    Tunnel += (1.0f - Weight) * Settings.Depth;
+
+    return FMath::Min(Shaped, Tunnel);
+}
+
+
+void FTerrainCaves::BuildChunk(const FTerrainCaveField& Field, const FIntRect& Cells, const FTerrainCaveSettings& Settings, FTerrainCaveMesh& OutMesh)
+{
+    double StartTime = FPlatformTime::Seconds();
+    OutMesh = FTerrainCaveMesh();
+
+    // Lattice points of the chunk's cells and of the apron on its low sides
+    const int32 X0 = FMath::Max(Cells.Min.X - 1, 0);
+    const int32 Y0 = FMath::Max(Cells.Min.Y - 1, 0);
+    const int32 X1 = FMath::Min(Cells.Max.X, Field.Rows - 1);
+    const int32 Y1 = FMath::Min(Cells.Max.Y, Field.Cols - 1);
+    if (X1 <= X0 || Y1 <= Y0)
+    {
+        return;
+    }
+
+    // Below Z0 everything is rock and above Z1 everything is air, so the surface closes inside the range
+    float MinHeight = MAX_flt;
+    float MaxHeight = -MAX_flt;
+    for (int32 X = X0; X <= X1; ++X)
+    {
+        for (int32 Y = Y0; Y <= Y1; ++Y)
+        {
+            MinHeight = FMath::Min(MinHeight, Field.Heights[X * Field.Cols + Y]);
+            MaxHeight = FMath::Max(MaxHeight, Field.Heights[X * Field.Cols + Y]);
+        }
+    }
+    const int32 Z0 = FMath::FloorToInt(MinHeight - FMath::Max(Settings.Depth, Settings.OverhangHeight)) - 1;
+    const int32 Z1 = FMath::CeilToInt(MaxHeight + Settings.OverhangHeight) + 1;
+
+    // Densities with Z innermost, so a column of the heightmap is read once per point
+    const int32 NX = X1 - X0 + 1;
+    const int32 NY = Y1 - Y0 + 1;
+    const int32 NZ = Z1 - Z0 + 1;
+    TArray<float> Density;
+    Density.SetNumUninitialized(NX * NY * NZ);
+    for (int32 X = 0; X < NX; ++X)
+    {
+        for (int32 Y = 0; Y < NY; ++Y)
+        {
+            float* Column = &Density[(X * NY + Y) * NZ];
+            for (int32 Z = 0; Z < NZ; ++Z)
+            {
+                Column[Z] = Field.GetDensity(X0 + X, Y0 + Y, Z0 + Z, Settings);
+            }
+        }
+    }
+    OutMesh.NumVoxels = Density.Num();
+
+    auto GetDensity = [&Density, NY, NZ](int32 X, int32 Y, int32 Z) { return Density[(X * NY + Y) * NZ + Z]; };
+
+    // Vertex of each voxel, keyed by its low corner, made the first time a quad needs it
+    TArray<int32> VertexOf;
+    VertexOf.Init(INDEX_NONE, (NX - 1) * (NY - 1) * (NZ - 1));
+
+    static const int32 CornerEdges[12][2] = {
+        { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },
+        { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },
+        { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
+
+    auto GetVertex = [&](const FIntVector& Voxel)
+        {
+            int32& Slot = VertexOf[(Voxel.X * (NY - 1) + Voxel.Y) * (NZ - 1) + Voxel.Z];
+            if (Slot != INDEX_NONE)
+            {
+                return Slot;
+            }
+
+            // Corner I sits at (I & 1, (I >> 1) & 1, I >> 2) from the low corner
+            float Corner[8];
+            for (int32 I = 0; I < 8; ++I)
+            {
+                Corner[I] = GetDensity(Voxel.X + (I & 1), Voxel.Y + ((I >> 1) & 1), Voxel.Z + (I >> 2));
+            }
+
+            FVector Sum = FVector::ZeroVector;
+            int32 NumCrossings = 0;
+            for (const int32* Edge : CornerEdges)
+            {
+                const float A = Corner[Edge[0]];
+                const float B = Corner[Edge[1]];
+                if ((A > 0.0f) != (B > 0.0f))
+                {
+                    const FVector PointA((Edge[0] & 1), ((Edge[0] >> 1) & 1), (Edge[0] >> 2));
+                    const FVector PointB((Edge[1] & 1), ((Edge[1] >> 1) & 1), (Edge[1] >> 2));
+                    Sum += FMath::Lerp(PointA, PointB, A / (A - B));
+                    ++NumCrossings;
+                }
+            }
+
+            // Rock is positive, so the surface faces down the gradient
+            const FVector Gradient(
+                (Corner[1] - Corner[0]) + (Corner[3] - Corner[2]) + (Corner[5] - Corner[4]) + (Corner[7] - Corner[6]),
+                (Corner[2] - Corner[0]) + (Corner[3] - Corner[1]) + (Corner[6] - Corner[4]) + (Corner[7] - Corner[5]),
+                (Corner[4] - Corner[0]) + (Corner[5] - Corner[1]) + (Corner[6] - Corner[2]) + (Corner[7] - Corner[3]));
+
+            const FVector Position = FVector(X0 + Voxel.X, Y0 + Voxel.Y, Z0 + Voxel.Z) + Sum / FMath::Max(NumCrossings, 1);
+            const int32 ColumnX = FMath::Clamp(FMath::RoundToInt(float(Position.X)), 0, Field.Rows - 1);
+            const int32 ColumnY = FMath::Clamp(FMath::RoundToInt(float(Position.Y)), 0, Field.Cols - 1);
+            const int32 ColumnIndex = ColumnX * Field.Cols + ColumnY;
+
+            // Walls darken over the first few cells below the surface
+            const float Shade = FMath::Lerp(1.0f, 0.45f, FMath::Clamp((Field.Heights[ColumnIndex] - float(Position.Z)) / 4.0f, 0.0f, 1.0f));
+            const FColor& SurfaceColor = Field.Colors[ColumnIndex];
+
+            Slot = OutMesh.Vertices.Add(Position * Field.CellSize);
+            OutMesh.Normals.Add((-Gradient).GetSafeNormal(SMALL_NUMBER, FVector::UpVector));
+            OutMesh.UV0.Add(FVector2D(Position.X * Field.UVScale, Position.Y * Field.UVScale));
+            OutMesh.Colors.Add(FColor(uint8(SurfaceColor.R * Shade), uint8(SurfaceColor.G * Shade), uint8(SurfaceColor.B * Shade), SurfaceColor.A));
+            return Slot;
+        };
+
+    // Each chunk owns the lattice edges leaving its own points, so every quad is emitted by exactly one chunk
+    static const FIntVector Axes[3] = { FIntVector(1, 0, 0), FIntVector(0, 1, 0), FIntVector(0, 0, 1) };
+    for (int32 X = Cells.Min.X - X0; X < X1 - X0; ++X)
+    {
+        for (int32 Y = Cells.Min.Y - Y0; Y < Y1 - Y0; ++Y)
+        {
+            // Only the masked part of the chunk is meshed; the heightmap covers the rest
+            if (Field.Mask[(X0 + X) * Field.Cols + (Y0 + Y)] <= 0.0f)
+            {
+                continue;
+            }
+
+            for (int32 Z = 1; Z < NZ - 1; ++Z)
+            {
+                const bool bRock = GetDensity(X, Y, Z) > 0.0f;
+                for (int32 Axis = 0; Axis < 3; ++Axis)
+                {
+                    const FIntVector Point(X, Y, Z);
+                    const FIntVector Along = Axes[Axis];
+                    const FIntVector SideB = Axes[(Axis + 1) % 3];
+                    const FIntVector SideC = Axes[(Axis + 2) % 3];
+                    const FIntVector Next = Point + Along;
+                    if (bRock == (GetDensity(Next.X, Next.Y, Next.Z) > 0.0f))
+                    {
+                        continue;
+                    }
+
+                    // The four voxels around the edge, counterclockwise about it
+                    const FIntVector Low = Point - SideB - SideC;
+                    if (Low.X < 0 || Low.Y < 0 || Low.Z < 0)
+                    {
+                        continue;
+                    }
+                    const int32 V00 = GetVertex(Low);
+                    const int32 V10 = GetVertex(Point - SideC);
+                    const int32 V11 = GetVertex(Point);
+                    const int32 V01 = GetVertex(Point - SideB);
+
+                    // Front faces wind clockwise seen from the air side
+                    if (bRock)
+                    {
+                        OutMesh.Triangles.Append({ V00, V01, V11, V00, V11, V10 });
+                    }
+                    else
+                    {
+                        OutMesh.Triangles.Append({ V00, V10, V11, V00, V11, V01 });
+                    }
+                }
+            }
+        }
+    }
+
+    double EndTime = FPlatformTime::Seconds();
+    OutMesh.Seconds = EndTime - StartTime;
+}
+
+
+void FTerrainCaves::MergeMeshes(TArrayView<const FTerrainCaveMesh> Meshes, FTerrainCaveMesh& OutMesh)
+{
+    int32 NumVertices = 0;
+    int32 NumIndices = 0;
+    for (const FTerrainCaveMesh& Mesh : Meshes)
+    {
+        NumVertices += Mesh.Vertices.Num();
+        NumIndices += Mesh.Triangles.Num();
+    }
+    OutMesh.Vertices.Reserve(OutMesh.Vertices.Num() + NumVertices);
+    OutMesh.Normals.Reserve(OutMesh.Normals.Num() + NumVertices);
+    OutMesh.UV0.Reserve(OutMesh.UV0.Num() + NumVertices);
+    OutMesh.Colors.Reserve(OutMesh.Colors.Num() + NumVertices);
+    OutMesh.Triangles.Reserve(OutMesh.Triangles.Num() + NumIndices);
+
+    for (const FTerrainCaveMesh& Mesh : Meshes)
+    {
+        const int32 BaseIndex = OutMesh.Vertices.Num();
+        OutMesh.Vertices.Append(Mesh.Vertices);
+        OutMesh.Normals.Append(Mesh.Normals);
+        OutMesh.UV0.Append(Mesh.UV0);
+        OutMesh.Colors.Append(Mesh.Colors);
+        for (int32 Index : Mesh.Triangles)
+        {
+            OutMesh.Triangles.Add(BaseIndex + Index);
+        }
+        OutMesh.NumVoxels += Mesh.NumVoxels;
+        OutMesh.Seconds += Mesh.Seconds;
+    }
+}
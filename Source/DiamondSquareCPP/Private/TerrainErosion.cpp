@@ -0,0 +1,259 @@
+#include "TerrainErosion.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformTime.h"
+
+
+static const float ErosionGravity = 9.81f;
+
+// Water shallower than this moves no sediment, which keeps velocities finite on nearly dry cells
+static const float MinWaterDepth = 1.0e-4f;
+
+// Flat beds still erode a little, or lakes would never carve an outlet
+static const float MinTilt = 0.05f;
+
+
+// Runs Body(R) for every row, in bands of rows spread over the workers
+template <typename BodyType>
+static void ForEachRow(int32 Rows, BodyType&& Body)
+{
+    const int32 RowsPerBand = 16;
+    ParallelFor(FMath::DivideAndRoundUp(Rows, RowsPerBand), [&](int32 Band)
+        {
+            const int32 End = FMath::Min((Band + 1) * RowsPerBand, Rows);
+            for (int32 R = Band * RowsPerBand; R < End; ++R)
+            {
+                Body(R);
+            }
+        });
+}
+
+
+// State of the pipe model, one plane per quantity
+struct FErosionWaterPlanes
+{
+    TArray<float> Terrain;
+    TArray<float> NextTerrain;
+    TArray<float> Water;
+    TArray<float> NextWater;
+    TArray<float> Sediment;
+    TArray<float> NextSediment;
+
+    // Outflow through the pipes to the row above, the row below, the column left and the column right
+    TArray<float> FluxUp;
+    TArray<float> FluxDown;
+    TArray<float> FluxLeft;
+    TArray<float> FluxRight;
+
+    // Water velocity along the columns (U) and the rows (V)
+    TArray<float> U;
+    TArray<float> V;
+};
+
+
+static void StepWater(FErosionWaterPlanes& P, int32 Rows, int32 Cols, const FTerrainErosionSettings& Settings)
+{
+    const float Dt = Settings.TimeStep;
+
+    // Pipes accelerate with the difference in water surface, then scale back together when they would drain
+    // more than the cell holds
+    ForEachRow(Rows, [&](int32 R)
+        {
+            for (int32 C = 0; C < Cols; ++C)
+            {
+                const int32 I = R * Cols + C;
+                const float Surface = P.Terrain[I] + P.Water[I];
+                auto Outflow = [&](float Flux, int32 N)
+                    {
+                        return FMath::Max(0.0f, Flux + Dt * ErosionGravity * (Surface - P.Terrain[N] - P.Water[N]));
+                    };
+
+                const float Up = R > 0 ? Outflow(P.FluxUp[I], I - Cols) : 0.0f;
+                const float Down = R < Rows - 1 ? Outflow(P.FluxDown[I], I + Cols) : 0.0f;
+                const float Left = C > 0 ? Outflow(P.FluxLeft[I], I - 1) : 0.0f;
+                const float Right = C < Cols - 1 ? Outflow(P.FluxRight[I], I + 1) : 0.0f;
+
+                const float Drained = (Up + Down + Left + Right) * Dt;
+                const float Scale = Drained > P.Water[I] ? P.Water[I] / Drained : 1.0f;
+                P.FluxUp[I] = Up * Scale;
+                P.FluxDown[I] = Down * Scale;
+                P.FluxLeft[I] = Left * Scale;
+                P.FluxRight[I] = Right * Scale;
+            }
+        });
+
+    // Move the water, then dissolve or deposit towards the capacity of the flow over the local slope
+    const float MaxSpeed = 1.0f / Dt;
+    ForEachRow(Rows, [&](int32 R)
+        {
+            for (int32 C = 0; C < Cols; ++C)
+            {
+                const int32 I = R * Cols + C;
+                const float FromUp = R > 0 ? P.FluxDown[I - Cols] : 0.0f;
+                const float FromDown = R < Rows - 1 ? P.FluxUp[I + Cols] : 0.0f;
+                const float FromLeft = C > 0 ? P.FluxRight[I - 1] : 0.0f;
+                const float FromRight = C < Cols - 1 ? P.FluxLeft[I + 1] : 0.0f;
+
+                const float In = FromUp + FromDown + FromLeft + FromRight;
+                const float Out = P.FluxUp[I] + P.FluxDown[I] + P.FluxLeft[I] + P.FluxRight[I];
+                const float Water = FMath::Max(0.0f, P.Water[I] + Dt * (In - Out));
+                const float Depth = 0.5f * (P.Water[I] + Water);
+
+                float VelU = 0.0f;
+                float VelV = 0.0f;
+                if (Depth > MinWaterDepth)
+                {
+                    VelU = FMath::Clamp(0.5f * (FromLeft - P.FluxLeft[I] + P.FluxRight[I] - FromRight) / Depth, -MaxSpeed, MaxSpeed);
+                    VelV = FMath::Clamp(0.5f * (FromUp - P.FluxUp[I] + P.FluxDown[I] - FromDown) / Depth, -MaxSpeed, MaxSpeed);
+                }
+                P.U[I] = VelU;
+                P.V[I] = VelV;
+                P.NextWater[I] = Water;
+
+                const float SlopeU = 0.5f * (P.Terrain[R * Cols + FMath::Min(C + 1, Cols - 1)] - P.Terrain[R * Cols + FMath::Max(C - 1, 0)]);
+                const float SlopeV = 0.5f * (P.Terrain[FMath::Min(R + 1, Rows - 1) * Cols + C] - P.Terrain[FMath::Max(R - 1, 0) * Cols + C]);
+                const float SlopeSquared = SlopeU * SlopeU + SlopeV * SlopeV;
+                const float SinTilt = FMath::Max(FMath::Sqrt(SlopeSquared / (1.0f + SlopeSquared)), MinTilt);
+
+                // Thin films run fast but carry little, so capacity also scales with depth up to a cell
+                const float Capacity = Settings.SedimentCapacity * SinTilt * FMath::Sqrt(VelU * VelU + VelV * VelV) * FMath::Min(Depth, 1.0f);
+                const float Sediment = P.Sediment[I];
+                const float Moved = Capacity > Sediment ? Settings.DissolveRate * (Capacity - Sediment) : -Settings.DepositRate * (Sediment - Capacity);
+                P.NextTerrain[I] = P.Terrain[I] - Moved;
+                P.NextSediment[I] = Sediment + Moved;
+            }
+        });
+
+    // Carry the sediment back along the velocity, then evaporate and rain for the next step
+    const float Keep = FMath::Max(0.0f, 1.0f - Settings.EvaporationRate * Dt);
+    const float Rain = Settings.RainRate * Dt;
+    ForEachRow(Rows, [&](int32 R)
+        {
+            for (int32 C = 0; C < Cols; ++C)
+            {
+                const int32 I = R * Cols + C;
+                const float SourceR = FMath::Clamp(R - P.V[I] * Dt, 0.0f, float(Rows - 1));
+                const float SourceC = FMath::Clamp(C - P.U[I] * Dt, 0.0f, float(Cols - 1));
+                const int32 R0 = FMath::Min(int32(SourceR), Rows - 2);
+                const int32 C0 = FMath::Min(int32(SourceC), Cols - 2);
+                const int32 R1 = R0 + 1;
+                const int32 C1 = C0 + 1;
+                const float FR = SourceR - R0;
+                const float FC = SourceC - C0;
+                const float Top = FMath::Lerp(P.NextSediment[R0 * Cols + C0], P.NextSediment[R0 * Cols + C1], FC);
+                const float Bottom = FMath::Lerp(P.NextSediment[R1 * Cols + C0], P.NextSediment[R1 * Cols + C1], FC);
+                P.Sediment[I] = FMath::Lerp(Top, Bottom, FR);
+
+                P.Water[I] = P.NextWater[I] * Keep + Rain;
+            }
+        });
+    Swap(P.Terrain, P.NextTerrain);
+}
+
+
+static void StepThermal(TArray<float>& Heights, TArray<float>& Next, TArray<float>& Scales, int32 Rows, int32 Cols, const FTerrainErosionSettings& Settings)
+{
+    const float Talus = Settings.TalusSlope;
+    auto ForEachNeighbour = [Rows, Cols](int32 R, int32 C, auto&& Body)
+        {
+            if (R > 0) { Body((R - 1) * Cols + C); }
+            if (R < Rows - 1) { Body((R + 1) * Cols + C); }
+            if (C > 0) { Body(R * Cols + C - 1); }
+            if (C < Cols - 1) { Body(R * Cols + C + 1); }
+        };
+
+    // A cell sheds ThermalRate of its steepest excess, shared in proportion to each neighbour's excess.
+    // Scales holds shed / total excess, so any cell can work out what a neighbour sends it.
+    ForEachRow(Rows, [&](int32 R)
+        {
+            for (int32 C = 0; C < Cols; ++C)
+            {
+                const int32 I = R * Cols + C;
+                float Total = 0.0f;
+                float Steepest = 0.0f;
+                ForEachNeighbour(R, C, [&](int32 N)
+                    {
+                        const float Excess = Heights[I] - Heights[N] - Talus;
+                        if (Excess > 0.0f)
+                        {
+                            Total += Excess;
+                            Steepest = FMath::Max(Steepest, Excess);
+                        }
+                    });
+                Scales[I] = Total > 0.0f ? Settings.ThermalRate * Steepest / Total : 0.0f;
+            }
+        });
+
+    ForEachRow(Rows, [&](int32 R)
+        {
+            for (int32 C = 0; C < Cols; ++C)
+            {
+                const int32 I = R * Cols + C;
+                float Height = Heights[I];
+                ForEachNeighbour(R, C, [&](int32 N)
+                    {
+                        Height -= Scales[I] * FMath::Max(0.0f, Heights[I] - Heights[N] - Talus);
+                        Height += Scales[N] * FMath::Max(0.0f, Heights[N] - Heights[I] - Talus);
+                    });
+                Next[I] = Height;
+            }
+        });
+    Swap(Heights, Next);
+}
+
+
+FTerrainErosionStats FTerrainErosion::Erode(TArray<float>& Heights, int32 Rows, int32 Cols, const FTerrainErosionSettings& Settings)
+{
+    FTerrainErosionStats Stats;
+    if (Rows < 2 || Cols < 2)
+    {
+        return Stats;
+    }
+
+    const double StartTime = FPlatformTime::Seconds();
+    auto OutOfTime = [&]()
+        {
+            return Settings.MaxSeconds > 0.0f && FPlatformTime::Seconds() - StartTime > Settings.MaxSeconds;
+        };
+
+    const int32 NumCells = Rows * Cols;
+    if (Settings.HydraulicIterations > 0)
+    {
+        FErosionWaterPlanes Planes;
+        Planes.Terrain = MoveTemp(Heights);
+        for (TArray<float>* Plane : { &Planes.NextTerrain, &Planes.NextWater, &Planes.Sediment, &Planes.NextSediment,
+            &Planes.FluxUp, &Planes.FluxDown, &Planes.FluxLeft, &Planes.FluxRight, &Planes.U, &Planes.V })
+        {
+            Plane->SetNumZeroed(NumCells);
+        }
+        Planes.Water.Init(Settings.RainRate * Settings.TimeStep, NumCells);
+
+        while (Stats.HydraulicIterations < Settings.HydraulicIterations && !OutOfTime())
+        {
+            StepWater(Planes, Rows, Cols, Settings);
+            ++Stats.HydraulicIterations;
+        }
+
+        // Whatever is still suspended settles where it is
+        Heights = MoveTemp(Planes.Terrain);
+        for (int32 Index = 0; Index < NumCells; ++Index)
+        {
+            Heights[Index] += Planes.Sediment[Index];
+        }
+    }
+
+    if (Settings.ThermalIterations > 0)
+    {
+        TArray<float> Next;
+        TArray<float> Scales;
+        Next.SetNumUninitialized(NumCells);
+        Scales.SetNumUninitialized(NumCells);
+        while (Stats.ThermalIterations < Settings.ThermalIterations && !OutOfTime())
+        {
+            StepThermal(Heights, Next, Scales, Rows, Cols, Settings);
+            ++Stats.ThermalIterations;
+        }
+    }
+
+    Stats.Seconds = FPlatformTime::Seconds() - StartTime;
+    return Stats;
+}
@@ -0,0 +1,124 @@
+#include "TerrainHeightField.h"
+
+
+FTerrainHeightField::FTerrainHeightField(int32 InSizeX, int32 InSizeY, float InGridSpacing, TArrayView<const float> Heights)
+    : SizeX(InSizeX)
+    , SizeY(InSizeY)
+    , GridSpacing(InGridSpacing > 0.0f ? InGridSpacing : 1.0f)
+{
+    check(SizeX > 0 && SizeY > 0 && Heights.Num() == SizeX * SizeY);
+
+    float MaxHeight = Heights[0];
+    MinHeight = Heights[0];
+    for (float Height : Heights)
+    {
+        MinHeight = FMath::Min(MinHeight, Height);
+        MaxHeight = FMath::Max(MaxHeight, Height);
+    }
+    HeightStep = (MaxHeight - MinHeight) / MAX_uint16;
+
+    Samples.SetNumUninitialized(Heights.Num());
+    const float InvStep = HeightStep > 0.0f ? 1.0f / HeightStep : 0.0f;
+    for (int32 Index = 0; Index < Heights.Num(); ++Index)
+    {
+        Samples[Index] = (uint16)FMath::Clamp(FMath::RoundToInt((Heights[Index] - MinHeight) * InvStep), 0, (int32)MAX_uint16);
+    }
+}
+
+
+FArchive& operator<<(FArchive& Ar, FTerrainHeightField& Field)
+{
+    Ar << Field.SizeX << Field.SizeY << Field.GridSpacing << Field.MinHeight << Field.HeightStep;
+    Field.Samples.BulkSerialize(Ar);
+    return Ar;
+}
+
+
+bool FTerrainHeightField::IsInside(const FVector2D& Local) const
+{
+    const float GX = float(Local.X / GridSpacing);
+    const float GY = float(Local.Y / GridSpacing);
+    return GX >= 0.0f && GY >= 0.0f && GX <= SizeX - 1 && GY <= SizeY - 1;
+}
+
+
+float FTerrainHeightField::SampleBilinear(float GX, float GY) const
+{
+    GX = FMath::Clamp(GX, 0.0f, float(SizeX - 1));
+    GY = FMath::Clamp(GY, 0.0f, float(SizeY - 1));
+    const int32 X0 = FMath::FloorToInt(GX);
+    const int32 Y0 = FMath::FloorToInt(GY);
+    const float TX = GX - X0;
+    const float TY = GY - Y0;
+
+    const float H0 = FMath::Lerp(GetSample(X0, Y0), GetSample(X0, Y0 + 1), TY);
+    const float H1 = FMath::Lerp(GetSample(X0 + 1, Y0), GetSample(X0 + 1, Y0 + 1), TY);
+    return FMath::Lerp(H0, H1, TX);
+}
+
+
+// Catmull-Rom weights for the four samples around a point T of the way from the second to the third
+static FORCEINLINE void CatmullRomWeights(float T, float OutWeights[4])
+{
+    const float T2 = T * T;
+    const float T3 = T2 * T;
+    OutWeights[0] = 0.5f * (-T3 + 2.0f * T2 - T);
+    OutWeights[1] = 0.5f * (3.0f * T3 - 5.0f * T2 + 2.0f);
+    OutWeights[2] = 0.5f * (-3.0f * T3 + 4.0f * T2 + T);
+    OutWeights[3] = 0.5f * (T3 - T2);
+}
+
+
+float FTerrainHeightField::SampleBicubic(float GX, float GY) const
+{
+    GX = FMath::Clamp(GX, 0.0f, float(SizeX - 1));
+    GY = FMath::Clamp(GY, 0.0f, float(SizeY - 1));
+    const int32 X0 = FMath::FloorToInt(GX);
+    const int32 Y0 = FMath::FloorToInt(GY);
+
+    float WX[4];
+    float WY[4];
+    CatmullRomWeights(GX - X0, WX);
+    CatmullRomWeights(GY - Y0, WY);
+
+    // Samples past the border repeat the edge
+    float Height = 0.0f;
+    for (int32 I = 0; I < 4; ++I)
+    {
+        float Row = 0.0f;
+        for (int32 J = 0; J < 4; ++J)
+        {
+            Row += WY[J] * GetSample(X0 - 1 + I, Y0 - 1 + J);
+        }
+        Height += WX[I] * Row;
+    }
+    return Height;
+}
+
+
+float FTerrainHeightField::Sample(float GX, float GY, ETerrainSampleFilter Filter) const
+{
+    return Filter == ETerrainSampleFilter::Bicubic ? SampleBicubic(GX, GY) : SampleBilinear(GX, GY);
+}
+
+
+float FTerrainHeightField::GetHeight(const FVector2D& Local, ETerrainSampleFilter Filter) const
+{
+    return Sample(float(Local.X / GridSpacing), float(Local.Y / GridSpacing), Filter);
+}
+
+
+FVector FTerrainHeightField::GetNormal(const FVector2D& Local, ETerrainSampleFilter Filter) const
+{
+    // Central differences one grid step either side, one-sided at the border
+    const float GX = FMath::Clamp(float(Local.X / GridSpacing), 0.0f, float(SizeX - 1));
+    const float GY = FMath::Clamp(float(Local.Y / GridSpacing), 0.0f, float(SizeY - 1));
+    const float XLo = FMath::Max(GX - 1.0f, 0.0f);
+    const float XHi = FMath::Min(GX + 1.0f, float(SizeX - 1));
+    const float YLo = FMath::Max(GY - 1.0f, 0.0f);
+    const float YHi = FMath::Min(GY + 1.0f, float(SizeY - 1));
+
+    const float SlopeX = (Sample(XHi, GY, Filter) - Sample(XLo, GY, Filter)) / FMath::Max((XHi - XLo) * GridSpacing, SMALL_NUMBER);
+    const float SlopeY = (Sample(GX, YHi, Filter) - Sample(GX, YLo, Filter)) / FMath::Max((YHi - YLo) * GridSpacing, SMALL_NUMBER);
+    return FVector(-SlopeX, -SlopeY, 1.0f).GetSafeNormal(SMALL_NUMBER, FVector::UpVector);
+}
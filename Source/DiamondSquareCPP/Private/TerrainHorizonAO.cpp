@@ -0,0 +1,119 @@
+#include "TerrainHorizonAO.h"
+#include "Async/ParallelFor.h"
+
+// Grid steps of the azimuths, most important first so every prefix is spread evenly
+static const FIntPoint HorizonSteps[16] = {
+    FIntPoint(1, 0), FIntPoint(0, 1), FIntPoint(-1, 0), FIntPoint(0, -1),
+    FIntPoint(1, 1), FIntPoint(-1, 1), FIntPoint(-1, -1), FIntPoint(1, -1),
+    FIntPoint(2, 1), FIntPoint(1, 2), FIntPoint(-1, 2), FIntPoint(-2, 1),
+    FIntPoint(-2, -1), FIntPoint(-1, -2), FIntPoint(1, -2), FIntPoint(2, -1) };
+
+// Lines swept per task
+static const int32 LinesPerBatch = 64;
+
+
+void FTerrainHorizonAO::Bake(const TArray<float>& Heights, int32 Rows, int32 Cols, int32 NumDirections, TArray<float>& OutVisibility)
+{
+    OutVisibility.Init(0.0f, Rows * Cols);
+    const int32 NumSteps = FMath::Clamp(NumDirections, 1, int32(UE_ARRAY_COUNT(HorizonSteps)));
+    if (Rows == 0 || Cols == 0)
+    {
+        return;
+    }
+
+    // Each azimuth stands for the arc halfway to its neighbours on either side
+    TArray<float> Angles;
+    for (int32 Step = 0; Step < NumSteps; ++Step)
+    {
+        Angles.Add(FMath::Atan2(float(HorizonSteps[Step].Y), float(HorizonSteps[Step].X)));
+    }
+    TArray<float> Weights;
+    Weights.Init(1.0f, NumSteps);
+    if (NumSteps > 1)
+    {
+        for (int32 Step = 0; Step < NumSteps; ++Step)
+        {
+            float Previous = TWO_PI;
+            float Next = TWO_PI;
+            for (int32 Other = 0; Other < NumSteps; ++Other)
+            {
+                if (Other != Step)
+                {
+                    const float Gap = FMath::Fmod(Angles[Other] - Angles[Step] + 2.0f * TWO_PI, TWO_PI);
+                    Next = FMath::Min(Next, Gap);
+                    Previous = FMath::Min(Previous, TWO_PI - Gap);
+                }
+            }
+            Weights[Step] = 0.5f * (Previous + Next) / TWO_PI;
+        }
+    }
+
+    // Azimuths run one after another; within one, lines touch disjoint cells and run in parallel
+    for (int32 Step = 0; Step < NumSteps; ++Step)
+    {
+        const FIntPoint Delta = HorizonSteps[Step];
+        const float Weight = Weights[Step];
+        const float InvStepSquared = 1.0f / float(Delta.X * Delta.X + Delta.Y * Delta.Y);
+
+        // A line starts at every cell whose predecessor is off the grid
+        TArray<FIntPoint> Starts;
+        for (int32 R = 0; R < Rows; ++R)
+        {
+            for (int32 C = 0; C < Cols; ++C)
+            {
+                const int32 PR = R - Delta.X;
+                const int32 PC = C - Delta.Y;
+                if (PR < 0 || PC < 0 || PR >= Rows || PC >= Cols)
+                {
+                    Starts.Add(FIntPoint(R, C));
+                }
+            }
+        }
+
+        ParallelFor(FMath::DivideAndRoundUp(Starts.Num(), LinesPerBatch), [&](int32 Batch)
+            {
+                // Hull points as (position along the line, height)
+                TArray<int32> HullPositions;
+                TArray<float> HullHeights;
+
+                const int32 End = FMath::Min((Batch + 1) * LinesPerBatch, Starts.Num());
+                for (int32 Line = Batch * LinesPerBatch; Line < End; ++Line)
+                {
+                    HullPositions.Reset();
+                    HullHeights.Reset();
+                    int32 R = Starts[Line].X;
+                    int32 C = Starts[Line].Y;
+                    for (int32 Position = 0; R >= 0 && C >= 0 && R < Rows && C < Cols; ++Position, R += Delta.X, C += Delta.Y)
+                    {
+                        const int32 Index = R * Cols + C;
+                        const float Height = Heights[Index];
+
+                        // Drop the top of the hull while the point under it is seen at least as high; what is left on
+                        // top is the tangent, and the dropped points are under the hull once this cell joins it
+                        int32 Top = HullPositions.Num() - 1;
+                        while (Top >= 1
+                            && (HullHeights[Top - 1] - Height) * float(Position - HullPositions[Top])
+                            >= (HullHeights[Top] - Height) * float(Position - HullPositions[Top - 1]))
+                        {
+                            HullPositions.Pop(false);
+                            HullHeights.Pop(false);
+                            --Top;
+                        }
+
+                        // The cosine-weighted sky above a horizon at elevation angle E is cos^2 E, or 1 / (1 + tan^2 E)
+                        float TanSquared = 0.0f;
+                        if (Top >= 0 && HullHeights[Top] > Height)
+                        {
+                            const float Rise = HullHeights[Top] - Height;
+                            const float Run = float(Position - HullPositions[Top]);
+                            TanSquared = Rise * Rise / (Run * Run) * InvStepSquared;
+                        }
+                        OutVisibility[Index] += Weight / (1.0f + TanSquared);
+
+                        HullPositions.Add(Position);
+                        HullHeights.Add(Height);
+                    }
+                }
+            });
+    }
+}
@@ -0,0 +1,157 @@
+#include "TerrainHydrology.h"
+
+
+// Open cell of the priority-flood, ordered by level and then index so ties resolve the same way every run
+struct FFloodNode
+{
+    float Level;
+    int32 Index;
+
+    bool operator<(const FFloodNode& Other) const
+    {
+        return Level < Other.Level || (Level == Other.Level && Index < Other.Index);
+    }
+};
+
+
+FTerrainFlow FTerrainHydrology::ComputeFlow(const TArray<float>& Heights, const TArray<uint8>& Outlets, int32 Rows, int32 Cols)
+{
+    FTerrainFlow Flow;
+    Flow.Rows = Rows;
+    Flow.Cols = Cols;
+    const int32 NumCells = Rows * Cols;
+    if (NumCells == 0)
+    {
+        return Flow;
+    }
+
+    Flow.Receivers.Init(INDEX_NONE, NumCells);
+    Flow.Order.Reserve(NumCells);
+
+    // Levels are the heights with depressions filled to their spill points
+    TArray<float> Levels;
+    Levels.SetNumUninitialized(NumCells);
+    TArray<uint8> Closed;
+    Closed.SetNumZeroed(NumCells);
+
+    TArray<FFloodNode> Open;
+    for (int32 R = 0; R < Rows; ++R)
+    {
+        for (int32 C = 0; C < Cols; ++C)
+        {
+            const int32 Index = R * Cols + C;
+            if (Outlets[Index] || R == 0 || C == 0 || R == Rows - 1 || C == Cols - 1)
+            {
+                Closed[Index] = 1;
+                Levels[Index] = Heights[Index];
+                Open.Add({ Heights[Index], Index });
+            }
+        }
+    }
+    Open.Heapify();
+
+    // Cells reached from above are inside a depression; they drain at the level they were reached at, so they
+    // go through a plain queue ahead of the heap
+    TArray<int32> Pit;
+    int32 PitHead = 0;
+
+    static const int32 OffsetR[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+    static const int32 OffsetC[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+
+    while (Open.Num() > 0 || PitHead < Pit.Num())
+    {
+        int32 Index;
+        if (PitHead < Pit.Num())
+        {
+            Index = Pit[PitHead++];
+            if (PitHead == Pit.Num())
+            {
+                Pit.Reset();
+                PitHead = 0;
+            }
+        }
+        else
+        {
+            FFloodNode Node;
+            Open.HeapPop(Node, false);
+            Index = Node.Index;
+        }
+        Flow.Order.Add(Index);
+
+        const int32 R = Index / Cols;
+        const int32 C = Index % Cols;
+        for (int32 Direction = 0; Direction < 8; ++Direction)
+        {
+            const int32 NR = R + OffsetR[Direction];
+            const int32 NC = C + OffsetC[Direction];
+            if (NR < 0 || NC < 0 || NR >= Rows || NC >= Cols)
+            {
+                continue;
+            }
+            const int32 Neighbour = NR * Cols + NC;
+            if (Closed[Neighbour])
+            {
+                continue;
+            }
+
+            Closed[Neighbour] = 1;
+            Flow.Receivers[Neighbour] = Index;
+            if (Heights[Neighbour] <= Levels[Index])
+            {
+                Levels[Neighbour] = Levels[Index];
+                Pit.Add(Neighbour);
+            }
+            else
+            {
+                Levels[Neighbour] = Heights[Neighbour];
+                Open.HeapPush({ Heights[Neighbour], Neighbour });
+            }
+        }
+    }
+
+    // Receivers come before the cells draining into them, so one pass upstream to downstream sums the catchments
+    Flow.Accumulation.Init(1.0f, NumCells);
+    for (int32 Position = NumCells - 1; Position >= 0; --Position)
+    {
+        const int32 Index = Flow.Order[Position];
+        if (Flow.Receivers[Index] != INDEX_NONE)
+        {
+            Flow.Accumulation[Flow.Receivers[Index]] += Flow.Accumulation[Index];
+        }
+    }
+
+    return Flow;
+}
+
+
+void FTerrainHydrology::CarveRivers(const FTerrainFlow& Flow, float Threshold, float Depth, TArray<float>& Heights, TArray<uint8>& OutRivers)
+{
+    const int32 NumCells = Flow.Rows * Flow.Cols;
+    OutRivers.SetNumZeroed(NumCells);
+    if (NumCells == 0 || Threshold <= 0.0f)
+    {
+        return;
+    }
+
+    // Depth grows with the square root of discharge, up to three times Depth
+    for (int32 Index = 0; Index < NumCells; ++Index)
+    {
+        const float Discharge = Flow.Accumulation[Index];
+        if (Discharge >= Threshold && Flow.Receivers[Index] != INDEX_NONE)
+        {
+            OutRivers[Index] = 1;
+            Heights[Index] -= Depth * FMath::Min(FMath::Sqrt(Discharge / Threshold), 3.0f);
+        }
+    }
+
+    // Upstream to downstream, so a river cuts through the rims of the depressions it drains instead of pooling
+    for (int32 Position = NumCells - 1; Position >= 0; --Position)
+    {
+        const int32 Index = Flow.Order[Position];
+        const int32 Receiver = Flow.Receivers[Index];
+        if (OutRivers[Index] && Receiver != INDEX_NONE && OutRivers[Receiver])
+        {
+            Heights[Receiver] = FMath::Min(Heights[Receiver], Heights[Index]);
+        }
+    }
+}
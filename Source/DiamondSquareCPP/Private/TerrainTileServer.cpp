@@ -0,0 +1,478 @@
+#include "TerrainTileServer.h"
+#include "Async/Async.h"
+#include "HAL/PlatformTime.h"
+#include "Algo/Find.h"
+#include "HttpPath.h"
+#include "HttpResultCallback.h"
+#include "HttpRouteHandle.h"
+#include "HttpServerModule.h"
+#include "HttpServerRequest.h"
+#include "HttpServerResponse.h"
+#include "IHttpRouter.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/QueuedThreadPool.h"
+#include "Misc/ScopeLock.h"
+#include "Modules/ModuleManager.h"
+#include "UObject/Package.h"
+#include "DiamondSquareLog.h"
+
+// Largest map side a request may ask for, as for GenerateToDisk
+static const int32 MaxTileMapSize = 65536;
+
+// Stack of each tile worker; the biome stages recurse through ParallelFor and need more than the pool default
+static const uint32 TileWorkerStackSize = 256 * 1024;
+
+// ADiamondSquare properties a request may set, and the range each is clamped to. The ranges are the editor's
+// ClampMin and ClampMax, which are not there outside the editor, with a bound added where a property has none
+// so no request can ask for an unbounded amount of work.
+struct FTileOverride
+{
+    FName Name;
+    double Min;
+    double Max;
+};
+static const FTileOverride TileOverrides[] =
+{
+    { TEXT("Seed"), MIN_int32, MAX_int32 },
+    { TEXT("Octaves"), 0, 16 },
+    { TEXT("Lacunarity"), 0.0, 16.0 },
+    { TEXT("Persistence"), 0.0, 1.0 },
+    { TEXT("SurroundMapWithOcean"), 0, 1 },
+    { TEXT("ShoreFalloff"), 0.0, 64.0 },
+    { TEXT("BiomeBlendRadius"), 0, 64 },
+    { TEXT("BiomeBlendPasses"), 1, 4 },
+    { TEXT("ProbabilityOfLand"), 0.0, 1.0 },
+    { TEXT("DeepOceanDistance"), 1.0, 64.0 },
+    { TEXT("ShoreWidth"), 1.0, 64.0 },
+    { TEXT("MinIslandArea"), 0, 65536 },
+    { TEXT("bTiledBiomeStages"), 0, 1 },
+    { TEXT("BiomeTileSize"), 16, 2048 },
+};
+
+
+// Parses Text as the value of Allowed's property, clamps it to Allowed's range and writes it to OutValue in the
+// property's own text form. False when the property is missing or Text is not a value of it.
+static bool ClampOverride(const FTileOverride& Allowed, const FString& Text, FString& OutValue)
+{
+    const FProperty* Property = FindFProperty<FProperty>(ADiamondSquare::StaticClass(), Allowed.Name);
+    if (!Property)
+    {
+        return false;
+    }
+
+    void* Value = FMemory::Malloc(Property->GetSize(), Property->GetMinAlignment());
+    Property->InitializeValue(Value);
+    const bool bParsed = Property->ImportText(*Text, Value, PPF_None, nullptr) != nullptr;
+    if (bParsed)
+    {
+        if (const FNumericProperty* Numeric = CastField<FNumericProperty>(Property))
+        {
+            if (Numeric->IsFloatingPoint())
+            {
+                Numeric->SetFloatingPointPropertyValue(Value, FMath::Clamp(Numeric->GetFloatingPointPropertyValue(Value), Allowed.Min, Allowed.Max));
+            }
+            else
+            {
+                Numeric->SetIntPropertyValue(Value, FMath::Clamp(Numeric->GetSignedIntPropertyValue(Value), int64(Allowed.Min), int64(Allowed.Max)));
+            }
+        }
+        Property->ExportTextItem(OutValue, Value, nullptr, nullptr, PPF_None);
+    }
+    Property->DestroyValue(Value);
+    FMemory::Free(Value);
+    return bParsed;
+}
+
+
+FTerrainTileServer::FTerrainTileServer(const FSettings& InSettings)
+    : Settings(InSettings)
+    , Tiles(FMath::Max(InSettings.MaxCachedTiles, 1))
+{
+}
+
+
+FTerrainTileServer::~FTerrainTileServer()
+{
+    Stop();
+}
+
+
+bool FTerrainTileServer::Start()
+{
+    check(IsInGameThread());
+    ImageWrapperModule = &FModuleManager::LoadModuleChecked<IImageWrapperModule>(FName(TEXT("ImageWrapper")));
+
+    FHttpServerModule& HttpServer = FHttpServerModule::Get();
+    Router = HttpServer.GetHttpRouter(Settings.Port);
+    if (!Router.IsValid())
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Cannot listen on port %d"), Settings.Port);
+        return false;
+    }
+
+    Routes.Add(Router->BindRoute(FHttpPath(TEXT("/height")), EHttpServerRequestVerbs::VERB_GET,
+        [this](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete) { return HandleTile(Request, OnComplete, ETileKind::Height); }));
+    Routes.Add(Router->BindRoute(FHttpPath(TEXT("/biome")), EHttpServerRequestVerbs::VERB_GET,
+        [this](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete) { return HandleTile(Request, OnComplete, ETileKind::Biome); }));
+    Routes.Add(Router->BindRoute(FHttpPath(TEXT("/color")), EHttpServerRequestVerbs::VERB_GET,
+        [this](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete) { return HandleTile(Request, OnComplete, ETileKind::Color); }));
+    Routes.Add(Router->BindRoute(FHttpPath(TEXT("/stats")), EHttpServerRequestVerbs::VERB_GET,
+        [this](const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete) { return HandleStats(Request, OnComplete); }));
+    for (const FHttpRouteHandle& Route : Routes)
+    {
+        if (!Route.IsValid())
+        {
+            UE_LOG(LogDiamondSquare, Error, TEXT("The tile routes are already bound on port %d"), Settings.Port);
+            Stop();
+            return false;
+        }
+    }
+
+    Pool = FQueuedThreadPool::Allocate();
+    if (!Pool->Create(FMath::Max(Settings.NumWorkers, 1), TileWorkerStackSize, TPri_Normal, TEXT("TerrainTileWorker")))
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Cannot start %d tile workers"), Settings.NumWorkers);
+        Stop();
+        return false;
+    }
+
+    HttpServer.StartAllListeners();
+    StatsStartTime = FPlatformTime::Seconds();
+    UE_LOG(LogDiamondSquare, Log, TEXT("Serving terrain tiles on http://localhost:%d with %d workers and %d cached tiles"),
+        Settings.Port, Settings.NumWorkers, Settings.MaxCachedTiles);
+    return true;
+}
+
+
+void FTerrainTileServer::Stop()
+{
+    if (Router.IsValid())
+    {
+        for (const FHttpRouteHandle& Route : Routes)
+        {
+            if (Route.IsValid())
+            {
+                Router->UnbindRoute(Route);
+            }
+        }
+    }
+    Routes.Reset();
+    Router.Reset();
+
+    // Waits for the tiles being made; their generators are released here, on the game thread
+    if (Pool)
+    {
+        Pool->Destroy();
+        delete Pool;
+        Pool = nullptr;
+    }
+    Generators.Reset();
+}
+
+
+void FTerrainTileServer::LogStats()
+{
+    const double Now = FPlatformTime::Seconds();
+    const int64 Requests = NumRequests.Set(0);
+    const int64 Hits = NumCacheHits.Set(0);
+    const int64 Made = NumTilesMade.Set(0);
+    const int64 Microseconds = TotalMicroseconds.Set(0);
+    const double Seconds = FMath::Max(Now - StatsStartTime, 1.0e-6);
+    StatsStartTime = Now;
+
+    UE_LOG(LogDiamondSquare, Log, TEXT("Tiles: %lld requests (%.1f/s), %.2f ms mean latency, %lld cache hits, %lld tiles made, %d generators"),
+        Requests, Requests / Seconds, Requests > 0 ? Microseconds / 1000.0 / Requests : 0.0, Hits, Made, Generators.Num());
+}
+
+
+bool FTerrainTileServer::HandleTile(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete, ETileKind Kind)
+{
+    const double StartTime = FPlatformTime::Seconds();
+
+    auto ReadInt = [&Request](const TCHAR* Name, int32& OutValue)
+        {
+            const FString* Value = Request.QueryParams.Find(Name);
+            if (!Value || !Value->IsNumeric())
+            {
+                return false;
+            }
+            OutValue = FCString::Atoi(**Value);
+            return true;
+        };
+    int32 Z = 0;
+    int32 X = 0;
+    int32 Y = 0;
+    if (!ReadInt(TEXT("z"), Z) || !ReadInt(TEXT("x"), X) || !ReadInt(TEXT("y"), Y))
+    {
+        OnComplete(FHttpServerResponse::Error(EHttpServerResponseCodes::BadRequest, TEXT("bad_tile"), TEXT("z, x and y are required integers")));
+        return true;
+    }
+
+    FString Error;
+    EHttpServerResponseCodes ErrorCode = EHttpServerResponseCodes::BadRequest;
+    const FGeneratorPtr Generator = FindOrAddGenerator(Request, Error);
+    if (!Generator.IsValid())
+    {
+        if (Error.IsEmpty())
+        {
+            Error = TEXT("Too many parameter sets are in use; retry later");
+            ErrorCode = EHttpServerResponseCodes::ServiceUnavail;
+        }
+        OnComplete(FHttpServerResponse::Error(ErrorCode, TEXT("bad_parameters"), Error));
+        return true;
+    }
+
+    // Each level up reduces four tiles of the one below, so a tile far above MaxZoom would make a whole map of cells
+    const int32 MinZoom = FMath::Max(Generator->MaxZoom - FMath::Max(Settings.MaxReducedLevels, 0), 0);
+    const int32 Span = TileSize << (Generator->MaxZoom - FMath::Clamp(Z, MinZoom, Generator->MaxZoom));
+    if (Z < MinZoom || Z > Generator->MaxZoom || X < 0 || Y < 0 || int64(X) * Span >= Generator->MapSize.X || int64(Y) * Span >= Generator->MapSize.Y)
+    {
+        OnComplete(FHttpServerResponse::Error(EHttpServerResponseCodes::NotFound, TEXT("no_tile"),
+            FString::Printf(TEXT("Tile %d/%d/%d is outside the map; zoom levels run from %d to %d"), Z, X, Y, MinZoom, Generator->MaxZoom)));
+        return true;
+    }
+
+    Generator->LastUsed = StartTime;
+    NumRequests.Increment();
+    const FString ContentType = Kind == ETileKind::Color ? TEXT("image/png") : TEXT("application/octet-stream");
+    AsyncPool(*Pool, [this, Generator, Kind, Z, X, Y, OnComplete, ContentType, StartTime]()
+        {
+            const FTilePtr Tile = GetTile(*Generator, Z, X, Y);
+            TArray<uint8> Body = Encode(Kind, *Tile);
+            TotalMicroseconds.Add(int64((FPlatformTime::Seconds() - StartTime) * 1.0e6));
+
+            // Responses go out from the game thread, which owns the connections
+            AsyncTask(ENamedThreads::GameThread, [OnComplete, ContentType, Body = MoveTemp(Body)]() mutable
+                {
+                    OnComplete(FHttpServerResponse::Create(MoveTemp(Body), ContentType));
+                });
+        });
+    return true;
+}
+
+
+bool FTerrainTileServer::HandleStats(const FHttpServerRequest& Request, const FHttpResultCallback& OnComplete)
+{
+    int32 NumCached = 0;
+    {
+        FScopeLock Lock(&CacheLock);
+        NumCached = Tiles.Num();
+    }
+    const int64 Requests = NumRequests.GetValue();
+    const FString Body = FString::Printf(
+        TEXT("{\"requests\":%lld,\"cacheHits\":%lld,\"tilesMade\":%lld,\"meanLatencyMs\":%.3f,\"cachedTiles\":%d,\"generators\":%d,\"workers\":%d}"),
+        Requests, NumCacheHits.GetValue(), NumTilesMade.GetValue(), Requests > 0 ? TotalMicroseconds.GetValue() / 1000.0 / Requests : 0.0,
+        NumCached, Generators.Num(), Settings.NumWorkers);
+    OnComplete(FHttpServerResponse::Create(Body, TEXT("application/json")));
+    return true;
+}
+
+
+FTerrainTileServer::FGeneratorPtr FTerrainTileServer::FindOrAddGenerator(const FHttpServerRequest& Request, FString& OutError)
+{
+    check(IsInGameThread());
+
+    // Each override is parsed, clamped and written back out under the property's own name, so spellings that
+    // mean the same value (seed=7, Seed=7, Seed=07) share one generator
+    int32 MapSize = Settings.DefaultMapSize;
+    TArray<TPair<FName, FString>> Overrides;
+    for (const TPair<FString, FString>& Param : Request.QueryParams)
+    {
+        if (Param.Key == TEXT("z") || Param.Key == TEXT("x") || Param.Key == TEXT("y"))
+        {
+            continue;
+        }
+        if (Param.Key == TEXT("size"))
+        {
+            MapSize = FCString::Atoi(*Param.Value);
+            continue;
+        }
+
+        FString Value;
+        const FTileOverride* Allowed = Algo::FindBy(TileOverrides, FName(*Param.Key), &FTileOverride::Name);
+        if (!Allowed || !ClampOverride(*Allowed, Param.Value, Value))
+        {
+            OutError = FString::Printf(TEXT("%s is not a generation property of ADiamondSquare, or %s is not a valid value for it"), *Param.Key, *Param.Value);
+            return nullptr;
+        }
+        if (Overrides.ContainsByPredicate([Allowed](const TPair<FName, FString>& Override) { return Override.Key == Allowed->Name; }))
+        {
+            OutError = FString::Printf(TEXT("%s is given more than once"), *Allowed->Name.ToString());
+            return nullptr;
+        }
+        Overrides.Emplace(Allowed->Name, Value);
+    }
+    if (MapSize < 1 || MapSize > MaxTileMapSize)
+    {
+        OutError = FString::Printf(TEXT("size must be between 1 and %d"), MaxTileMapSize);
+        return nullptr;
+    }
+
+    // The key lists the parameters in a fixed order, so the same set always finds the same generator
+    Overrides.Sort([](const TPair<FName, FString>& A, const TPair<FName, FString>& B) { return A.Key.LexicalLess(B.Key); });
+    FString Key = FString::Printf(TEXT("size=%d"), MapSize);
+    for (const TPair<FName, FString>& Override : Overrides)
+    {
+        Key += FString::Printf(TEXT("&%s=%s"), *Override.Key.ToString(), *Override.Value);
+    }
+
+    if (const FGeneratorPtr* Found = Generators.Find(Key))
+    {
+        return *Found;
+    }
+
+    // Make room by dropping the least recently used generator no worker holds
+    if (Generators.Num() >= FMath::Max(Settings.MaxGenerators, 1))
+    {
+        const FString* Oldest = nullptr;
+        double OldestTime = MAX_dbl;
+        for (const TPair<FString, FGeneratorPtr>& Entry : Generators)
+        {
+            if (Entry.Value.IsUnique() && Entry.Value->LastUsed < OldestTime)
+            {
+                Oldest = &Entry.Key;
+                OldestTime = Entry.Value->LastUsed;
+            }
+        }
+        if (!Oldest)
+        {
+            return nullptr;
+        }
+        Generators.Remove(*Oldest);
+    }
+
+    // The terrain is only used for its properties and generation methods, so it is never spawned into a world
+    ADiamondSquare* Terrain = NewObject<ADiamondSquare>(GetTransientPackage(), NAME_None, RF_Transient);
+    for (const TPair<FName, FString>& Override : Overrides)
+    {
+        // Already parsed and clamped, so this cannot fail
+        const FProperty* Property = FindFProperty<FProperty>(ADiamondSquare::StaticClass(), Override.Key);
+        verify(Property->ImportText(*Override.Value, Property->ContainerPtrToValuePtr<void>(Terrain), PPF_None, Terrain));
+    }
+
+    const FGeneratorPtr Generator = MakeShared<FGenerator, ESPMode::ThreadSafe>();
+    Generator->Key = Key;
+    Generator->Terrain.Reset(Terrain);
+    Generator->MapSize = FIntPoint(MapSize, MapSize);
+    while ((TileSize << Generator->MaxZoom) < MapSize)
+    {
+        ++Generator->MaxZoom;
+    }
+    Generators.Add(Key, Generator);
+    UE_LOG(LogDiamondSquare, Verbose, TEXT("Tile generator %s: %d zoom levels"), *Key, Generator->MaxZoom + 1);
+    return Generator;
+}
+
+
+FTerrainTileServer::FTilePtr FTerrainTileServer::GetTile(FGenerator& Generator, int32 Z, int32 X, int32 Y)
+{
+    const FString TileKey = FString::Printf(TEXT("%s/%d/%d/%d"), *Generator.Key, Z, X, Y);
+    {
+        FScopeLock Lock(&CacheLock);
+        if (const FTilePtr* Cached = Tiles.FindAndTouch(TileKey))
+        {
+            NumCacheHits.Increment();
+            return *Cached;
+        }
+    }
+
+    // Made without holding the lock, so cache hits never wait on a miss; workers that miss the same tile at once each make it
+    const TSharedRef<FTerrainTile, ESPMode::ThreadSafe> Tile = MakeShared<FTerrainTile, ESPMode::ThreadSafe>();
+    Tile->Heights.Init(0, TileSize * TileSize);
+    Tile->Biomes.Init(ADiamondSquare::ECell::DeepOcean, TileSize * TileSize);
+
+    const int32 Span = TileSize << (Generator.MaxZoom - Z);
+    if (int64(X) * Span >= Generator.MapSize.X || int64(Y) * Span >= Generator.MapSize.Y)
+    {
+        // Wholly past the edge of the map
+    }
+    else if (Z == Generator.MaxZoom)
+    {
+        {
+            FScopeLock Lock(&Generator.PrepareLock);
+            if (!Generator.bPrepared)
+            {
+                Generator.Terrain->PrepareRegions(Generator.MapSize, Generator.Root, Generator.Stages);
+                Generator.bPrepared = true;
+            }
+        }
+
+        const FIntRect Region(
+            X * TileSize,
+            Y * TileSize,
+            FMath::Min((X + 1) * TileSize, Generator.MapSize.X),
+            FMath::Min((Y + 1) * TileSize, Generator.MapSize.Y));
+        const int32 RegionCols = Region.Max.Y - Region.Min.Y;
+        TArray<ADiamondSquare::ECell> Biomes;
+        TArray<uint16> Heights;
+        Generator.Terrain->GenerateRegion(Generator.Root, Generator.Stages, Generator.MapSize, Region, Biomes, Heights);
+        for (int32 Row = 0; Row < Region.Max.X - Region.Min.X; ++Row)
+        {
+            FMemory::Memcpy(&Tile->Heights[Row * TileSize], &Heights[Row * RegionCols], RegionCols * sizeof(uint16));
+            FMemory::Memcpy(&Tile->Biomes[Row * TileSize], &Biomes[Row * RegionCols], RegionCols * sizeof(ADiamondSquare::ECell));
+        }
+    }
+    else
+    {
+        // Each quarter halves one tile of the level below: heights are averaged and biomes point sampled
+        const int32 Half = TileSize / 2;
+        for (int32 Quarter = 0; Quarter < 4; ++Quarter)
+        {
+            const int32 DX = Quarter >> 1;
+            const int32 DY = Quarter & 1;
+            const FTilePtr Child = GetTile(Generator, Z + 1, 2 * X + DX, 2 * Y + DY);
+            for (int32 Row = 0; Row < Half; ++Row)
+            {
+                for (int32 Col = 0; Col < Half; ++Col)
+                {
+                    const int32 Source = 2 * Row * TileSize + 2 * Col;
+                    const uint32 Sum = uint32(Child->Heights[Source]) + Child->Heights[Source + 1] + Child->Heights[Source + TileSize] + Child->Heights[Source + TileSize + 1];
+                    const int32 Target = (DX * Half + Row) * TileSize + DY * Half + Col;
+                    Tile->Heights[Target] = uint16((Sum + 2) / 4);
+                    Tile->Biomes[Target] = Child->Biomes[Source];
+                }
+            }
+        }
+    }
+    NumTilesMade.Increment();
+
+    FScopeLock Lock(&CacheLock);
+    Tiles.Add(TileKey, Tile);
+    return Tile;
+}
+
+
+TArray<uint8> FTerrainTileServer::Encode(ETileKind Kind, const FTerrainTile& Tile) const
+{
+    TArray<uint8> Body;
+    switch (Kind)
+    {
+    case ETileKind::Height:
+        Body.Append(reinterpret_cast<const uint8*>(Tile.Heights.GetData()), Tile.Heights.Num() * sizeof(uint16));
+        break;
+
+    case ETileKind::Biome:
+        Body.Append(reinterpret_cast<const uint8*>(Tile.Biomes.GetData()), Tile.Biomes.Num() * sizeof(ADiamondSquare::ECell));
+        break;
+
+    case ETileKind::Color:
+    {
+        // Base colours without the mesh's per-vertex jitter, so a tile looks the same at every request
+        TArray<FColor> Pixels;
+        Pixels.SetNumUninitialized(Tile.Heights.Num());
+        for (int32 Index = 0; Index < Pixels.Num(); ++Index)
+        {
+            Pixels[Index] = ADiamondSquare::GetBiomeBaseColor(Tile.Heights[Index] / 65535.0f, Tile.Biomes[Index]).ToFColor(false);
+        }
+        const TSharedPtr<IImageWrapper> Png = ImageWrapperModule->CreateImageWrapper(EImageFormat::PNG);
+        if (Png.IsValid() && Png->SetRaw(Pixels.GetData(), Pixels.Num() * sizeof(FColor), TileSize, TileSize, ERGBFormat::BGRA, 8))
+        {
+            const TArray64<uint8>& Compressed = Png->GetCompressed();
+            Body.Append(Compressed.GetData(), int32(Compressed.Num()));
+        }
+        break;
+    }
+    }
+    return Body;
+}
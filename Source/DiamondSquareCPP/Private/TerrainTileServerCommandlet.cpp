@@ -0,0 +1,57 @@
+#include "TerrainTileServerCommandlet.h"
+#include "CoreGlobals.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Containers/Ticker.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "TerrainTileServer.h"
+
+
+UTerrainTileServerCommandlet::UTerrainTileServerCommandlet()
+{
+    IsClient = false;
+    IsServer = false;
+    IsEditor = false;
+    LogToConsole = true;
+}
+
+
+int32 UTerrainTileServerCommandlet::Main(const FString& Params)
+{
+    FTerrainTileServer::FSettings Settings;
+    FParse::Value(*Params, TEXT("port="), Settings.Port);
+    FParse::Value(*Params, TEXT("workers="), Settings.NumWorkers);
+    FParse::Value(*Params, TEXT("cache="), Settings.MaxCachedTiles);
+    FParse::Value(*Params, TEXT("generators="), Settings.MaxGenerators);
+    FParse::Value(*Params, TEXT("size="), Settings.DefaultMapSize);
+    FParse::Value(*Params, TEXT("reducedlevels="), Settings.MaxReducedLevels);
+    float StatsInterval = 10.0f;
+    FParse::Value(*Params, TEXT("statsinterval="), StatsInterval);
+
+    FTerrainTileServer Server(Settings);
+    if (!Server.Start())
+    {
+        return 1;
+    }
+
+    // The listeners tick on the core ticker, and finished tiles are handed back through the game thread's queue
+    double LastTime = FPlatformTime::Seconds();
+    double LastStatsTime = LastTime;
+    while (!IsEngineExitRequested())
+    {
+        const double Now = FPlatformTime::Seconds();
+        FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+        FTSTicker::GetCoreTicker().Tick(float(Now - LastTime));
+        LastTime = Now;
+
+        if (StatsInterval > 0.0f && Now - LastStatsTime >= StatsInterval)
+        {
+            Server.LogStats();
+            LastStatsTime = Now;
+        }
+        FPlatformProcess::Sleep(0.001f);
+    }
+
+    Server.Stop();
+    return 0;
+}
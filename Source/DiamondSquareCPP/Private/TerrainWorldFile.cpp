@@ -0,0 +1,353 @@
+#include "TerrainWorldFile.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformTime.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Misc/Compression.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "DiamondSquareLog.h"
+
+// "DSQW" read as a little-endian uint32
+static const uint32 WorldFileMagic = 0x57515344;
+static const uint32 WorldFileVersion = 1;
+
+// Magic, version and the size of the header that follows
+static const int32 WorldFilePreambleSize = 3 * sizeof(uint32);
+
+
+// Cells of chunk Index of a Rows x Cols world with ChunksY chunks per row of chunks, clamped to the world
+static FIntRect MakeChunkRect(int32 Index, int32 ChunkSize, int32 ChunksY, int32 Rows, int32 Cols)
+{
+    const int32 ChunkX = Index / ChunksY;
+    const int32 ChunkY = Index % ChunksY;
+    return FIntRect(
+        ChunkX * ChunkSize,
+        ChunkY * ChunkSize,
+        FMath::Min((ChunkX + 1) * ChunkSize, Rows),
+        FMath::Min((ChunkY + 1) * ChunkSize, Cols));
+}
+
+
+// Gradient prediction of cell (R, C) of a plane with Stride columns, from cells already coded. Wraps around in
+// 16 bits, which the decoder reproduces exactly.
+static FORCEINLINE uint16 PredictHeight(const uint16* Heights, int32 Stride, int32 R, int32 C)
+{
+    if (R == 0)
+    {
+        return C == 0 ? 0 : Heights[C - 1];
+    }
+    if (C == 0)
+    {
+        return Heights[(R - 1) * Stride];
+    }
+    return uint16(Heights[R * Stride + C - 1] + Heights[(R - 1) * Stride + C] - Heights[(R - 1) * Stride + C - 1]);
+}
+
+
+// Small negative residuals map to small codes, so the high byte plane stays mostly zero
+static FORCEINLINE uint16 ZigZag(uint16 Residual)
+{
+    return uint16((uint32(Residual) << 1) ^ ((Residual & 0x8000) ? 0xFFFFu : 0u));
+}
+
+static FORCEINLINE uint16 UnZigZag(uint16 Code)
+{
+    return uint16((Code >> 1) ^ ((Code & 1) ? 0xFFFFu : 0u));
+}
+
+
+bool FTerrainWorldFile::Save(const FString& Path, const FTerrainWorldPlanes& World, int32 InChunkSize, FName Format)
+{
+    double StartTime = FPlatformTime::Seconds();
+    const int32 NumCells = World.Rows * World.Cols;
+    if (World.Rows <= 0 || World.Cols <= 0 || World.Heights.Num() != NumCells || World.Biomes.Num() != NumCells)
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Cannot save a %d x %d world with %d heights and %d biomes"), World.Rows, World.Cols, World.Heights.Num(), World.Biomes.Num());
+        return false;
+    }
+
+    const int32 ChunkSize = FMath::Max(InChunkSize, 8);
+    const int32 ChunksX = FMath::DivideAndRoundUp(World.Rows, ChunkSize);
+    const int32 ChunksY = FMath::DivideAndRoundUp(World.Cols, ChunkSize);
+    const int32 NumChunks = ChunksX * ChunksY;
+
+    // An empty buffer marks a chunk that failed to compress
+    TArray<TArray<uint8>> Compressed;
+    Compressed.SetNum(NumChunks);
+    ParallelFor(NumChunks, [&](int32 Index)
+        {
+            const FIntRect Rect = MakeChunkRect(Index, ChunkSize, ChunksY, World.Rows, World.Cols);
+            const int32 ChunkRows = Rect.Max.X - Rect.Min.X;
+            const int32 ChunkCols = Rect.Max.Y - Rect.Min.Y;
+            const int32 ChunkCells = ChunkRows * ChunkCols;
+
+            TArray<uint8> Raw;
+            Raw.SetNumUninitialized(3 * ChunkCells);
+            uint8* Low = Raw.GetData();
+            uint8* High = Low + ChunkCells;
+            uint8* Biomes = High + ChunkCells;
+            const uint16* Origin = World.Heights.GetData() + Rect.Min.X * World.Cols + Rect.Min.Y;
+            for (int32 R = 0; R < ChunkRows; ++R)
+            {
+                for (int32 C = 0; C < ChunkCols; ++C)
+                {
+                    const int32 Cell = R * ChunkCols + C;
+                    const uint16 Code = ZigZag(uint16(Origin[R * World.Cols + C] - PredictHeight(Origin, World.Cols, R, C)));
+                    Low[Cell] = uint8(Code & 0xFF);
+                    High[Cell] = uint8(Code >> 8);
+                    Biomes[Cell] = World.Biomes[(Rect.Min.X + R) * World.Cols + Rect.Min.Y + C];
+                }
+            }
+
+            int32 CompressedSize = FCompression::CompressMemoryBound(Format, Raw.Num());
+            Compressed[Index].SetNumUninitialized(CompressedSize);
+            if (FCompression::CompressMemory(Format, Compressed[Index].GetData(), CompressedSize, Raw.GetData(), Raw.Num()))
+            {
+                Compressed[Index].SetNum(CompressedSize);
+            }
+            else
+            {
+                Compressed[Index].Empty();
+            }
+        });
+
+    // Header and chunk table; offsets count from the start of the file
+    TArray<uint8> Header;
+    FMemoryWriter Writer(Header);
+    int32 Rows = World.Rows;
+    int32 Cols = World.Cols;
+    int32 SavedChunkSize = ChunkSize;
+    FString FormatName = Format.ToString();
+    Writer << Rows << Cols << SavedChunkSize << FormatName;
+    const int64 TableSize = int64(NumChunks) * (sizeof(int64) + sizeof(int32));
+    int64 Offset = WorldFilePreambleSize + Header.Num() + TableSize;
+    int64 TotalCompressed = 0;
+    for (int32 Index = 0; Index < NumChunks; ++Index)
+    {
+        if (Compressed[Index].Num() == 0)
+        {
+            UE_LOG(LogDiamondSquare, Error, TEXT("Chunk %d of %s failed to compress with %s"), Index, *Path, *FormatName);
+            return false;
+        }
+        int64 ChunkOffset = Offset;
+        int32 ChunkBytes = Compressed[Index].Num();
+        Writer << ChunkOffset << ChunkBytes;
+        Offset += ChunkBytes;
+        TotalCompressed += ChunkBytes;
+    }
+
+    // Written next to the target and moved over it once complete, so a failed save leaves the old file intact
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Path));
+    const FString TempPath = Path + TEXT(".tmp");
+    TUniquePtr<IFileHandle> File(PlatformFile.OpenWrite(*TempPath));
+    const uint32 Preamble[3] = { WorldFileMagic, WorldFileVersion, uint32(Header.Num()) };
+    bool bWritten = File
+        && File->Write(reinterpret_cast<const uint8*>(Preamble), sizeof(Preamble))
+        && File->Write(Header.GetData(), Header.Num());
+    for (int32 Index = 0; Index < NumChunks && bWritten; ++Index)
+    {
+        bWritten = File->Write(Compressed[Index].GetData(), Compressed[Index].Num());
+    }
+    bWritten = bWritten && File->Flush();
+    File.Reset();
+    if (!bWritten || !IFileManager::Get().Move(*Path, *TempPath, true))
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Writing %s failed"), *Path);
+        PlatformFile.DeleteFile(*TempPath);
+        return false;
+    }
+
+    double EndTime = FPlatformTime::Seconds();
+    UE_LOG(LogDiamondSquare, Log, TEXT("Saved %d x %d world in %d chunks, %lld of %lld bytes, in %f seconds"),
+        World.Rows, World.Cols, NumChunks, TotalCompressed, int64(NumCells) * 3, EndTime - StartTime);
+    return true;
+}
+
+
+bool FTerrainWorldFile::Open(const FString& Path)
+{
+    *this = FTerrainWorldFile();
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    TUniquePtr<IFileHandle> File(PlatformFile.OpenRead(*Path));
+    uint32 Preamble[3];
+    if (!File || !File->Read(reinterpret_cast<uint8*>(Preamble), sizeof(Preamble)))
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Cannot read %s"), *Path);
+        return false;
+    }
+    if (Preamble[0] != WorldFileMagic || Preamble[1] != WorldFileVersion || int64(Preamble[2]) > File->Size())
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("%s is not a version %u world file"), *Path, WorldFileVersion);
+        return false;
+    }
+
+    TArray<uint8> Header;
+    Header.SetNumUninitialized(Preamble[2]);
+    if (!File->Read(Header.GetData(), Header.Num()))
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("Cannot read the header of %s"), *Path);
+        return false;
+    }
+
+    // Planes and the raw chunks are indexed with int32, as Save builds them
+    FMemoryReader Reader(Header);
+    FString FormatName;
+    Reader << Rows << Cols << ChunkSize << FormatName;
+    const int64 MaxChunkCells = int64(FMath::Min(ChunkSize, Rows)) * FMath::Min(ChunkSize, Cols);
+    if (Reader.IsError() || Rows <= 0 || Cols <= 0 || ChunkSize <= 0 || int64(Rows) * Cols > MAX_int32
+        || 3 * MaxChunkCells > MAX_int32 || !FCompression::IsFormatValid(FName(*FormatName)))
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("%s has a corrupt header"), *Path);
+        *this = FTerrainWorldFile();
+        return false;
+    }
+    ChunksX = FMath::DivideAndRoundUp(Rows, ChunkSize);
+    ChunksY = FMath::DivideAndRoundUp(Cols, ChunkSize);
+    const int64 NumChunks = int64(ChunksX) * ChunksY;
+    if (NumChunks * int64(sizeof(int64) + sizeof(int32)) > Header.Num() - Reader.Tell())
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("%s has a truncated chunk table"), *Path);
+        *this = FTerrainWorldFile();
+        return false;
+    }
+    Chunks.SetNum(int32(NumChunks));
+    for (FChunkEntry& Chunk : Chunks)
+    {
+        Reader << Chunk.Offset << Chunk.CompressedSize;
+    }
+    if (Reader.IsError())
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("%s has a truncated chunk table"), *Path);
+        *this = FTerrainWorldFile();
+        return false;
+    }
+
+    // Every chunk lies in the data after the table and ends within the file, so LoadRegion can read the entries
+    // as they are
+    const int64 DataStart = WorldFilePreambleSize + Header.Num();
+    const int64 FileSize = File->Size();
+    const int32 MaxCompressedSize = FCompression::CompressMemoryBound(FName(*FormatName), int32(3 * MaxChunkCells));
+    for (int32 Index = 0; Index < Chunks.Num(); ++Index)
+    {
+        const FChunkEntry& Chunk = Chunks[Index];
+        if (Chunk.CompressedSize <= 0 || Chunk.CompressedSize > MaxCompressedSize || Chunk.Offset < DataStart
+            || Chunk.Offset > FileSize - Chunk.CompressedSize)
+        {
+            UE_LOG(LogDiamondSquare, Error, TEXT("%s has a corrupt entry for chunk %d"), *Path, Index);
+            *this = FTerrainWorldFile();
+            return false;
+        }
+    }
+
+    Format = FName(*FormatName);
+    FilePath = Path;
+    return true;
+}
+
+
+bool FTerrainWorldFile::LoadRegion(const FIntRect& Region, FTerrainWorldPlanes& OutPlanes) const
+{
+    if (Chunks.Num() == 0)
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("LoadRegion needs an opened world file"));
+        return false;
+    }
+
+    const FIntRect Clamped(
+        FMath::Clamp(Region.Min.X, 0, Rows),
+        FMath::Clamp(Region.Min.Y, 0, Cols),
+        FMath::Clamp(Region.Max.X, 0, Rows),
+        FMath::Clamp(Region.Max.Y, 0, Cols));
+    const int32 OutRows = FMath::Max(Clamped.Max.X - Clamped.Min.X, 0);
+    const int32 OutCols = FMath::Max(Clamped.Max.Y - Clamped.Min.Y, 0);
+    OutPlanes.Init(OutRows, OutCols);
+    if (OutRows == 0 || OutCols == 0)
+    {
+        return true;
+    }
+
+    // Chunks overlapping the region, in file order
+    TArray<int32> Needed;
+    for (int32 ChunkX = Clamped.Min.X / ChunkSize; ChunkX <= (Clamped.Max.X - 1) / ChunkSize; ++ChunkX)
+    {
+        for (int32 ChunkY = Clamped.Min.Y / ChunkSize; ChunkY <= (Clamped.Max.Y - 1) / ChunkSize; ++ChunkY)
+        {
+            Needed.Add(ChunkX * ChunksY + ChunkY);
+        }
+    }
+
+    // Reading is sequential through one handle; decompression is the expensive part and runs in parallel
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    TUniquePtr<IFileHandle> File(PlatformFile.OpenRead(*FilePath));
+    TArray<TArray<uint8>> Compressed;
+    Compressed.SetNum(Needed.Num());
+    for (int32 Index = 0; Index < Needed.Num(); ++Index)
+    {
+        // Open checked the entry lies within the file
+        const FChunkEntry& Chunk = Chunks[Needed[Index]];
+        Compressed[Index].SetNumUninitialized(Chunk.CompressedSize);
+        if (!File || !File->Seek(Chunk.Offset) || !File->Read(Compressed[Index].GetData(), Chunk.CompressedSize))
+        {
+            UE_LOG(LogDiamondSquare, Error, TEXT("Cannot read chunk %d of %s"), Needed[Index], *FilePath);
+            return false;
+        }
+    }
+
+    TArray<uint8> Failed;
+    Failed.SetNumZeroed(Needed.Num());
+    ParallelFor(Needed.Num(), [&](int32 Index)
+        {
+            const FIntRect Rect = MakeChunkRect(Needed[Index], ChunkSize, ChunksY, Rows, Cols);
+            const int32 ChunkRows = Rect.Max.X - Rect.Min.X;
+            const int32 ChunkCols = Rect.Max.Y - Rect.Min.Y;
+            const int32 ChunkCells = ChunkRows * ChunkCols;
+
+            TArray<uint8> Raw;
+            Raw.SetNumUninitialized(3 * ChunkCells);
+            if (!FCompression::UncompressMemory(Format, Raw.GetData(), Raw.Num(), Compressed[Index].GetData(), Compressed[Index].Num()))
+            {
+                Failed[Index] = 1;
+                return;
+            }
+            Compressed[Index].Empty();
+
+            // The whole chunk decodes, since every prediction leans on the cells before it
+            const uint8* Low = Raw.GetData();
+            const uint8* High = Low + ChunkCells;
+            const uint8* Biomes = High + ChunkCells;
+            TArray<uint16> Heights;
+            Heights.SetNumUninitialized(ChunkCells);
+            for (int32 R = 0; R < ChunkRows; ++R)
+            {
+                for (int32 C = 0; C < ChunkCols; ++C)
+                {
+                    const int32 Cell = R * ChunkCols + C;
+                    const uint16 Code = uint16(Low[Cell] | (High[Cell] << 8));
+                    Heights[Cell] = uint16(PredictHeight(Heights.GetData(), ChunkCols, R, C) + UnZigZag(Code));
+                }
+            }
+
+            // Chunks cover disjoint parts of the output
+            for (int32 R = FMath::Max(Rect.Min.X, Clamped.Min.X); R < FMath::Min(Rect.Max.X, Clamped.Max.X); ++R)
+            {
+                const int32 Begin = FMath::Max(Rect.Min.Y, Clamped.Min.Y);
+                const int32 End = FMath::Min(Rect.Max.Y, Clamped.Max.Y);
+                const int32 Source = (R - Rect.Min.X) * ChunkCols + (Begin - Rect.Min.Y);
+                const int32 Target = (R - Clamped.Min.X) * OutCols + (Begin - Clamped.Min.Y);
+                FMemory::Memcpy(&OutPlanes.Heights[Target], &Heights[Source], (End - Begin) * sizeof(uint16));
+                FMemory::Memcpy(&OutPlanes.Biomes[Target], &Biomes[Source], (End - Begin) * sizeof(uint8));
+            }
+        });
+
+    if (Failed.Contains(1))
+    {
+        UE_LOG(LogDiamondSquare, Error, TEXT("%s has chunks that do not decompress with %s"), *FilePath, *Format.ToString());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,199 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "UObject/Package.h"
+#include "UObject/StrongObjectPtr.h"
+#include "BiomePipeline.h"
+#include "BiomeTiles.h"
+#include "DiamondSquare.h"
+
+// The planned biome pipeline runs the same stages three faster ways: Land/Ocean stages on the bitboard, runs of
+// stages fused into one cell pass, and the late Zoom/Shore stages tile by tile. Each must leave exactly the board
+// the stages make one after another through RunStage.
+//
+//   UnrealEditor-Cmd DiamondSquareCPP.uproject -ExecCmds="Automation RunTests DiamondSquare.BiomePipeline; Quit" -nullrhi
+
+namespace BiomePipelineTest
+{
+    using ECell = ADiamondSquare::ECell;
+    using FBoard = TArray<TArray<ECell>>;
+
+    static const int32 Seeds[] = { 1, 1337, 90210 };
+
+    static TStrongObjectPtr<ADiamondSquare> MakeTerrain()
+    {
+        return TStrongObjectPtr<ADiamondSquare>(NewObject<ADiamondSquare>(GetTransientPackage(), NAME_None, RF_Transient));
+    }
+
+    // First cell where A and B differ, or (-1, -1) when they match; a size mismatch reports (0, 0)
+    static FIntPoint FindFirstDifference(const FBoard& A, const FBoard& B)
+    {
+        if (A.Num() != B.Num())
+        {
+            return FIntPoint(0, 0);
+        }
+        for (int32 R = 0; R < A.Num(); ++R)
+        {
+            if (A[R].Num() != B[R].Num())
+            {
+                return FIntPoint(R, 0);
+            }
+            for (int32 C = 0; C < A[R].Num(); ++C)
+            {
+                if (A[R][C] != B[R][C])
+                {
+                    return FIntPoint(R, C);
+                }
+            }
+        }
+        return FIntPoint(-1, -1);
+    }
+
+    static void TestBoardsMatch(FAutomationTestBase& Test, const FString& What, const FBoard& Actual, const FBoard& Expected)
+    {
+        const FIntPoint Difference = FindFirstDifference(Actual, Expected);
+        Test.TestTrue(FString::Printf(TEXT("%s matches (first difference at %d, %d)"), *What, Difference.X, Difference.Y), Difference.X < 0);
+    }
+}
+
+
+// The untiled plan, bitboard and fused cell passes included, against the stages one after another through RunStage
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBiomePipelineFusedTest, "DiamondSquare.BiomePipeline.FusedMatchesUnfused",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FBiomePipelineFusedTest::RunTest(const FString& Parameters)
+{
+    using namespace BiomePipelineTest;
+
+    TStrongObjectPtr<ADiamondSquare> Terrain = MakeTerrain();
+    Terrain->bTiledBiomeStages = false;
+    for (const bool bSurroundWithOcean : { false, true })
+    {
+        const TArray<FBiomeStageDesc> Stages = Terrain->ResolveStageDefaults(FBiomePipelinePlanner::GetDefaultStages(bSurroundWithOcean));
+        FBiomePipelinePlan Plan;
+        FString PlanError;
+        if (!TestTrue(TEXT("Default stages plan"), FBiomePipelinePlanner::Plan(Stages, false, Plan, PlanError)))
+        {
+            return false;
+        }
+        TestTrue(TEXT("Plan has a fused cell pass"), Plan.Steps.ContainsByPredicate([](const FBiomePlanStep& Step) { return Step.Kind == EBiomePlanStepKind::CellPass; }));
+
+        for (const int32 Seed : Seeds)
+        {
+            Terrain->Seed = Seed;
+
+            Terrain->InitializeSeed();
+            FBoard Unfused;
+            for (const FBiomeStageDesc& Desc : Stages)
+            {
+                if (Desc.bEnabled)
+                {
+                    Unfused = Terrain->RunStage(Desc, Unfused);
+                }
+            }
+
+            Terrain->InitializeSeed();
+            TArray<FBiomeTileStage> TrailingStages;
+            const FBoard Fused = Terrain->RunBiomePipeline(Plan, TrailingStages);
+            TestEqual(TEXT("Untiled plan leaves no tile stages"), TrailingStages.Num(), 0);
+
+            TestBoardsMatch(*this, FString::Printf(TEXT("Seed %d, SurroundWithOcean %d"), Seed, bSurroundWithOcean), Fused, Unfused);
+        }
+    }
+    return true;
+}
+
+
+// The leading Land/Ocean stages on the bitboard against the same stages on a board of cells
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBiomePipelineBitboardTest, "DiamondSquare.BiomePipeline.BitboardMatchesCells",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FBiomePipelineBitboardTest::RunTest(const FString& Parameters)
+{
+    using namespace BiomePipelineTest;
+
+    TStrongObjectPtr<ADiamondSquare> Terrain = MakeTerrain();
+    const TArray<FBiomeStageDesc> Stages = Terrain->ResolveStageDefaults(FBiomePipelinePlanner::GetDefaultStages(false));
+    int32 NumBitboardStages = 0;
+    while (NumBitboardStages < Stages.Num() && FBiomePipelinePlanner::IsBitboardStage(Stages[NumBitboardStages].Stage))
+    {
+        ++NumBitboardStages;
+    }
+    TestTrue(TEXT("Default stages start on the bitboard"), NumBitboardStages > 1);
+
+    for (const int32 Seed : Seeds)
+    {
+        Terrain->Seed = Seed;
+
+        // Compare after every stage, so a mismatch names the stage that caused it
+        Terrain->InitializeSeed();
+        FBiomeBitboard Bits;
+        TArray<FBoard> BitboardSteps;
+        for (int32 Index = 0; Index < NumBitboardStages; ++Index)
+        {
+            Bits = Terrain->RunBitboardStage(Stages[Index], Bits);
+            BitboardSteps.Add(Terrain->ExpandBitboard(Bits));
+        }
+        const int32 BitboardRandomState = Terrain->Rng.GetCurrentSeed();
+
+        Terrain->InitializeSeed();
+        FBoard Cells;
+        for (int32 Index = 0; Index < NumBitboardStages; ++Index)
+        {
+            Cells = Terrain->RunStage(Stages[Index], Cells);
+            TestBoardsMatch(*this, FString::Printf(TEXT("Seed %d, stage %d (%s)"), Seed, Index,
+                *StaticEnum<EBiomeStage>()->GetNameStringByValue(int64(Stages[Index].Stage))), BitboardSteps[Index], Cells);
+        }
+
+        // The stages after the bitboard draw from the same stream, so both paths must leave it in the same state
+        TestEqual(FString::Printf(TEXT("Seed %d random state"), Seed), BitboardRandomState, Terrain->Rng.GetCurrentSeed());
+    }
+    return true;
+}
+
+
+// Tiled Zoom/Shore stages against the untiled plan, over tile sizes that do and do not divide the map
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBiomePipelineTiledTest, "DiamondSquare.BiomePipeline.TiledMatchesUntiled",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FBiomePipelineTiledTest::RunTest(const FString& Parameters)
+{
+    using namespace BiomePipelineTest;
+    static const int32 TileSizes[] = { 16, 100, 128, 517, 2048 };
+
+    TStrongObjectPtr<ADiamondSquare> Terrain = MakeTerrain();
+    const TArray<FBiomeStageDesc> Stages = Terrain->ResolveStageDefaults(FBiomePipelinePlanner::GetDefaultStages(true));
+    FBiomePipelinePlan UntiledPlan;
+    FBiomePipelinePlan TiledPlan;
+    FString PlanError;
+    if (!TestTrue(TEXT("Untiled plan"), FBiomePipelinePlanner::Plan(Stages, false, UntiledPlan, PlanError))
+        || !TestTrue(TEXT("Tiled plan"), FBiomePipelinePlanner::Plan(Stages, true, TiledPlan, PlanError)))
+    {
+        return false;
+    }
+
+    for (const int32 Seed : Seeds)
+    {
+        Terrain->Seed = Seed;
+
+        Terrain->InitializeSeed();
+        TArray<FBiomeTileStage> TrailingStages;
+        const FBoard Untiled = Terrain->RunBiomePipeline(UntiledPlan, TrailingStages);
+
+        for (const int32 TileSize : TileSizes)
+        {
+            // As TestIsland does: the plan stops before its trailing tile stages, which then run over the whole map
+            Terrain->BiomeTileSize = TileSize;
+            Terrain->InitializeSeed();
+            FBoard Tiled = Terrain->RunBiomePipeline(TiledPlan, TrailingStages);
+            TestTrue(TEXT("Tiled plan ends in tile stages"), TrailingStages.Num() > 0);
+            Tiled = FBiomeTiles::Run(Tiled, TrailingStages, TileSize);
+
+            TestBoardsMatch(*this, FString::Printf(TEXT("Seed %d, tile size %d"), Seed, TileSize), Tiled, Untiled);
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,78 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "HAL/PlatformTime.h"
+#include "UObject/Package.h"
+#include "UObject/StrongObjectPtr.h"
+#include "BiomePipeline.h"
+#include "DiamondSquare.h"
+
+// Times the biome stages that only run in the engine, which Tools/GenerationBenchmark cannot reach, at its map
+// sizes and with its seed. Each stage goes through RunStage, as an unfused stage of a pipeline does, and reports
+// the fastest of a few runs:
+//
+//   UnrealEditor-Cmd DiamondSquareCPP.uproject -ExecCmds="Automation RunTests DiamondSquare.Performance.BiomeStages; Quit" -nullrhi
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBiomeStagePerformanceTest, "DiamondSquare.Performance.BiomeStages",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FBiomeStagePerformanceTest::RunTest(const FString& Parameters)
+{
+    using ECell = ADiamondSquare::ECell;
+    using FBoard = TArray<TArray<ECell>>;
+    static const int32 MapSizes[] = { 200, 512, 1024, 2048 };
+    static const int32 NumRuns = 3;
+
+    TStrongObjectPtr<ADiamondSquare> Terrain(NewObject<ADiamondSquare>(GetTransientPackage(), NAME_None, RF_Transient));
+    Terrain->Seed = 1337;
+    auto MakeDesc = [&Terrain](EBiomeStage Stage)
+    {
+        FBiomeStageDesc Desc;
+        Desc.Stage = Stage;
+        return Terrain->ResolveStageDefaults({ Desc })[0];
+    };
+
+    for (const int32 Size : MapSizes)
+    {
+        // Grown as the benchmark grows its boards: an island zoomed past Size and cropped, then given
+        // temperatures for the temperature stages and biomes for the rest
+        Terrain->InitializeSeed();
+        FBoard Board = Terrain->RunStage(MakeDesc(EBiomeStage::Island), FBoard());
+        while (Board.Num() < Size)
+        {
+            Board = Terrain->RunStage(MakeDesc(EBiomeStage::Zoom), Terrain->RunStage(MakeDesc(EBiomeStage::AddIsland), Board));
+        }
+        Board.SetNum(Size);
+        for (TArray<ECell>& Row : Board)
+        {
+            Row.SetNum(Size);
+        }
+        const FBoard Temperatures = Terrain->RunStage(MakeDesc(EBiomeStage::AddTemps), Board);
+        const FBoard Biomes = Terrain->RunStage(MakeDesc(EBiomeStage::TemperatureToBiome), Temperatures);
+
+        const TPair<EBiomeStage, const FBoard*> Stages[] =
+        {
+            { EBiomeStage::WarmToTemperate, &Temperatures },
+            { EBiomeStage::FreezingToCold, &Temperatures },
+            { EBiomeStage::DeepOcean, &Biomes },
+            { EBiomeStage::Shore, &Biomes },
+            { EBiomeStage::RemoveSpecks, &Biomes },
+        };
+        for (const TPair<EBiomeStage, const FBoard*>& Stage : Stages)
+        {
+            const FBiomeStageDesc Desc = MakeDesc(Stage.Key);
+            double BestSeconds = MAX_dbl;
+            for (int32 Run = 0; Run < NumRuns; ++Run)
+            {
+                const double StartTime = FPlatformTime::Seconds();
+                const FBoard Result = Terrain->RunStage(Desc, *Stage.Value);
+                BestSeconds = FMath::Min(BestSeconds, FPlatformTime::Seconds() - StartTime);
+            }
+            AddInfo(FString::Printf(TEXT("%s/%d: %.3f ms, %.2f Mcells/s"), *StaticEnum<EBiomeStage>()->GetNameStringByValue(int64(Stage.Key)),
+                Size, BestSeconds * 1000.0, BestSeconds > 0.0 ? double(Size) * Size / BestSeconds / 1.0e6 : 0.0));
+        }
+    }
+    return true;
+}
+
+#endif
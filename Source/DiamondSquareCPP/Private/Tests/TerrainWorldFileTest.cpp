@@ -0,0 +1,94 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "HAL/FileManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/Paths.h"
+#include "TerrainWorldFile.h"
+
+// Saves a world whose size is not a multiple of its chunk size, then loads it back whole and in regions that
+// line up with chunks, straddle them, sit on the ragged last chunks and run past the world's edge.
+//
+//   UnrealEditor-Cmd DiamondSquareCPP.uproject -ExecCmds="Automation RunTests DiamondSquare.WorldFile; Quit" -nullrhi
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTerrainWorldFileTest, "DiamondSquare.WorldFile.RoundTrip",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTerrainWorldFileTest::RunTest(const FString& Parameters)
+{
+    static const int32 Rows = 300;
+    static const int32 Cols = 211;
+    static const int32 ChunkSize = 64;
+
+    // Smooth heights with a little noise, as the gradient predictor expects, and biomes in blocks
+    FTerrainWorldPlanes World;
+    World.Init(Rows, Cols);
+    FRandomStream Random(1337);
+    for (int32 X = 0; X < Rows; ++X)
+    {
+        for (int32 Y = 0; Y < Cols; ++Y)
+        {
+            const float Height = 0.5f + 0.25f * FMath::Sin(X * 0.05f) * FMath::Cos(Y * 0.07f) + Random.FRandRange(-0.01f, 0.01f);
+            World.Heights[X * Cols + Y] = uint16(FMath::Clamp(Height, 0.0f, 1.0f) * MAX_uint16);
+            World.Biomes[X * Cols + Y] = uint8((X / 17 + Y / 23) % 32);
+        }
+    }
+
+    const FString Path = FPaths::AutomationTransientDir() / TEXT("TerrainWorldFileTest.world");
+    if (!TestTrue(TEXT("Save"), FTerrainWorldFile::Save(Path, World, ChunkSize)))
+    {
+        return false;
+    }
+
+    FTerrainWorldFile File;
+    if (TestTrue(TEXT("Open"), File.Open(Path)))
+    {
+        TestEqual(TEXT("Rows"), File.GetRows(), Rows);
+        TestEqual(TEXT("Cols"), File.GetCols(), Cols);
+        TestEqual(TEXT("Chunk size"), File.GetChunkSize(), ChunkSize);
+
+        const FIntRect Regions[] =
+        {
+            FIntRect(0, 0, Rows, Cols),
+            FIntRect(0, 0, ChunkSize, ChunkSize),
+            FIntRect(ChunkSize, ChunkSize, 3 * ChunkSize, 2 * ChunkSize),
+            FIntRect(10, 20, 11, 21),
+            FIntRect(50, 60, 140, 75),
+            FIntRect(Rows - 5, Cols - 40, Rows, Cols),
+            FIntRect(250, 180, Rows + 100, Cols + 100),
+            FIntRect(-20, -20, 30, 30),
+        };
+        for (const FIntRect& Region : Regions)
+        {
+            const FIntRect Clamped(FMath::Max(Region.Min.X, 0), FMath::Max(Region.Min.Y, 0), FMath::Min(Region.Max.X, Rows), FMath::Min(Region.Max.Y, Cols));
+            const FString What = FString::Printf(TEXT("Region (%d, %d)-(%d, %d)"), Region.Min.X, Region.Min.Y, Region.Max.X, Region.Max.Y);
+
+            FTerrainWorldPlanes Loaded;
+            if (!TestTrue(What + TEXT(" loads"), File.LoadRegion(Region, Loaded)))
+            {
+                continue;
+            }
+            if (!TestEqual(What + TEXT(" rows"), Loaded.Rows, Clamped.Max.X - Clamped.Min.X)
+                || !TestEqual(What + TEXT(" cols"), Loaded.Cols, Clamped.Max.Y - Clamped.Min.Y))
+            {
+                continue;
+            }
+
+            int32 Mismatches = 0;
+            for (int32 X = Clamped.Min.X; X < Clamped.Max.X; ++X)
+            {
+                for (int32 Y = Clamped.Min.Y; Y < Clamped.Max.Y; ++Y)
+                {
+                    const int32 Index = (X - Clamped.Min.X) * Loaded.Cols + (Y - Clamped.Min.Y);
+                    Mismatches += Loaded.Heights[Index] != World.Heights[X * Cols + Y] || Loaded.Biomes[Index] != World.Biomes[X * Cols + Y];
+                }
+            }
+            TestEqual(What + TEXT(" mismatched cells"), Mismatches, 0);
+        }
+    }
+
+    IFileManager::Get().Delete(*Path);
+    return true;
+}
+
+#endif
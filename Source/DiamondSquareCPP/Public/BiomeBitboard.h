@@ -0,0 +1,96 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Land/Ocean board packed 64 cells per word. Bit C & 63 of word C >> 6 in a row is column C; a set bit is Land.
+// Bits past the last column are always zero.
+struct DIAMONDSQUARECPP_API FBiomeBitboard
+{
+    int32 Rows = 0;
+    int32 Cols = 0;
+    int32 WordsPerRow = 0;
+    TArray<uint64> Words;
+
+    // Resizes the board and fills it with Ocean
+    void Init(int32 InRows, int32 InCols);
+
+    const uint64* Row(int32 R) const { return Words.GetData() + R * WordsPerRow; }
+    uint64* Row(int32 R) { return Words.GetData() + R * WordsPerRow; }
+
+    bool Get(int32 R, int32 C) const
+    {
+        return (Row(R)[C >> 6] >> (C & 63)) & 1;
+    }
+
+    void Set(int32 R, int32 C, bool bLand)
+    {
+        const uint64 Bit = uint64(1) << (C & 63);
+        uint64& Word = Row(R)[C >> 6];
+        Word = bLand ? (Word | Bit) : (Word & ~Bit);
+    }
+
+    // Bits of word WordIndex that lie inside the board
+    uint64 ValidMask(int32 WordIndex) const;
+
+    // Word whose bit C holds the neighbour at column C - 1 (or C + 1). Columns without that neighbour
+    // get their own value, so they never compare as different from it.
+    uint64 LeftNeighbours(int32 R, int32 WordIndex) const;
+    uint64 RightNeighbours(int32 R, int32 WordIndex) const;
+
+    // Cells whose up/down/left/right neighbour differs, 64 columns at a time
+    uint64 EdgeWord(int32 R, int32 WordIndex) const;
+
+    // Ocean cells with no Land among their in-board up/down/left/right neighbours
+    uint64 SurroundedByOceanWord(int32 R, int32 WordIndex) const;
+
+    // Doubles the board in both directions, each cell becoming a 2x2 block
+    FBiomeBitboard Upscale2x() const;
+
+    // Row-major sweep over the edge cells that rewrites each one in place with the value at the
+    // coordinate returned by PickSource(R, C). Cells later in the sweep see earlier rewrites, both
+    // when deciding whether they are edges and when read as a source.
+    template <typename PickSourceType>
+    void JitterEdges(PickSourceType&& PickSource)
+    {
+        for (int32 R = 0; R < Rows; ++R)
+        {
+            for (int32 WordIndex = 0; WordIndex < WordsPerRow; ++WordIndex)
+            {
+                uint64 Edges = EdgeWord(R, WordIndex);
+                while (Edges)
+                {
+                    const int32 Bit = (int32)FMath::CountTrailingZeros64(Edges);
+                    const int32 C = (WordIndex << 6) + Bit;
+                    Edges &= Edges - 1;
+
+                    const FIntPoint Source = PickSource(R, C);
+                    const bool bSourceLand = Get(Source.X, Source.Y);
+                    if (bSourceLand != Get(R, C))
+                    {
+                        Set(R, C, bSourceLand);
+                        // The rest of the word now sees the new value as a left neighbour
+                        Edges = Bit == 63 ? 0 : (EdgeWord(R, WordIndex) & (~uint64(0) << (Bit + 1)));
+                    }
+                }
+            }
+        }
+    }
+
+    // Calls Func(R, C) for every set bit of the words produced by MaskWord(R, WordIndex), in row-major order
+    template <typename MaskWordType, typename FuncType>
+    void ForEachCell(MaskWordType&& MaskWord, FuncType&& Func) const
+    {
+        for (int32 R = 0; R < Rows; ++R)
+        {
+            for (int32 WordIndex = 0; WordIndex < WordsPerRow; ++WordIndex)
+            {
+                uint64 Mask = MaskWord(R, WordIndex);
+                while (Mask)
+                {
+                    Func(R, (WordIndex << 6) + (int32)FMath::CountTrailingZeros64(Mask));
+                    Mask &= Mask - 1;
+                }
+            }
+        }
+    }
+};
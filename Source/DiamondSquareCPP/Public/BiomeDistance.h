@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Exact Euclidean distance transform (Felzenszwalb and Huttenlocher). One pass down every column and one
+// along every row, each linear in its length, so any radius costs the same per cell.
+struct DIAMONDSQUARECPP_API FBiomeDistance
+{
+    // Squared distance, in cells, reported where no feature exists
+    static constexpr float NoFeature = 3.0e38f;
+
+    // For each cell of a Rows x Cols grid (row-major), the squared distance to the nearest cell whose
+    // Features entry is set. With bBorderIsFeature the ring of cells just outside the grid counts too.
+    static TArray<float> SquaredDistance(const TArray<uint8>& Features, int32 Rows, int32 Cols, bool bBorderIsFeature);
+
+    // Row-major feature mask of the cells of Board for which IsFeature(Cell) holds
+    template <typename CellType, typename PredicateType>
+    static TArray<uint8> MakeFeatures(const TArray<TArray<CellType>>& Board, PredicateType&& IsFeature)
+    {
+        const int32 Rows = Board.Num();
+        const int32 Cols = Rows > 0 ? Board[0].Num() : 0;
+        TArray<uint8> Features;
+        Features.SetNumUninitialized(Rows * Cols);
+        for (int32 R = 0; R < Rows; ++R)
+        {
+            for (int32 C = 0; C < Cols; ++C)
+            {
+                Features[R * Cols + C] = IsFeature(Board[R][C]) ? 1 : 0;
+            }
+        }
+        return Features;
+    }
+
+    // Lower envelope of the parabolas rooted at the finite entries of F, sampled at 0 .. N - 1 into D.
+    // V and Z are scratch of at least N and N + 1 entries.
+    static void Transform1D(const float* F, int32 N, float* D, int32* V, float* Z);
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "DiamondSquare.h"
+#include "BiomePipeline.generated.h"
+
+// Stages of the stochastic automaton stack that builds the biome map
+UENUM(BlueprintType)
+enum class EBiomeStage : uint8
+{
+    Island,
+    FuzzyZoom,
+    AddIsland,
+    AddIsland2,
+    Zoom,
+    RemoveTooMuchOcean,
+    SurroundWithOcean,
+    AddTemps,
+    WarmToTemperate,
+    FreezingToCold,
+    TemperatureToBiome,
+    DeepOcean,
+    Shore,
+    RemoveSpecks
+};
+
+USTRUCT(BlueprintType)
+struct FBiomeStageDesc
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Biome Pipeline")
+    EBiomeStage Stage = EBiomeStage::Zoom;
+
+    // Disabled stages are skipped, which keeps them in the list while experimenting
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Biome Pipeline")
+    bool bEnabled = true;
+
+    // Chance of a redrawn cell becoming land in AddIsland and AddIsland2; negative uses the actor's ProbabilityOfLand
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Meta = (ClampMax = 1.0f), Category = "Biome Pipeline")
+    float LandProbability = -1.0f;
+
+    // Distance, in cells of the board the stage runs on, for DeepOcean (ocean this far from land or the map
+    // edge turns deep) and Shore (beach width); negative uses the actor's DeepOceanDistance or ShoreWidth
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Biome Pipeline")
+    float Radius = -1.0f;
+
+    // Islands smaller than this many cells sink back into Ocean in RemoveSpecks; negative uses the actor's MinIslandArea
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Biome Pipeline")
+    int32 MinArea = -1;
+};
+
+// Ordered list of biome stages, editable without recompiling
+UCLASS(BlueprintType)
+class DIAMONDSQUARECPP_API UBiomePipeline : public UDataAsset
+{
+    GENERATED_BODY()
+
+public:
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Biome Pipeline")
+    TArray<FBiomeStageDesc> Stages;
+
+#if WITH_EDITOR
+    virtual EDataValidationResult IsDataValid(TArray<FText>& ValidationErrors) override;
+#endif
+};
+
+
+// Per-cell rewrite reading the 4- or 8-neighbourhood: a cell in Source becomes Target when any in-board
+// 4-neighbour is in Neighbours, or, with bAllEight, when all 8 neighbours are in the board and in Neighbours.
+struct FBiomeCellRule
+{
+    ADiamondSquare::FCellSet Source;
+    ADiamondSquare::FCellSet Neighbours;
+    ADiamondSquare::ECell Target;
+    bool bAllEight;
+
+    // True when no rewrite Earlier makes changes whether a cell is in Neighbours, so this rule can read
+    // its neighbours from Earlier's input instead of its output
+    bool IsInvariantUnder(const FBiomeCellRule& Earlier) const;
+
+    // Tests the neighbours of column C in Mid, with Up and Down the rows around it or nullptr past the border
+    FORCEINLINE bool MatchesNeighbours(const ADiamondSquare::ECell* Up, const ADiamondSquare::ECell* Mid, const ADiamondSquare::ECell* Down, int32 C, int32 Cols) const
+    {
+        if (!bAllEight)
+        {
+            return (Up && Neighbours.Contains(Up[C]))
+                || (Down && Neighbours.Contains(Down[C]))
+                || (C > 0 && Neighbours.Contains(Mid[C - 1]))
+                || (C < Cols - 1 && Neighbours.Contains(Mid[C + 1]));
+        }
+
+        if (!Up || !Down || C == 0 || C == Cols - 1)
+        {
+            return false;
+        }
+        return Neighbours.Contains(Up[C - 1]) && Neighbours.Contains(Up[C]) && Neighbours.Contains(Up[C + 1])
+            && Neighbours.Contains(Mid[C - 1]) && Neighbours.Contains(Mid[C + 1])
+            && Neighbours.Contains(Down[C - 1]) && Neighbours.Contains(Down[C]) && Neighbours.Contains(Down[C + 1]);
+    }
+};
+
+enum class EBiomePlanStepKind : uint8
+{
+    // Land/Ocean stages on the packed bitboard
+    Bitboard,
+    // One stage on the full board
+    Stage,
+    // An optional per-cell stage followed by neighbour rules, all in one row-buffered pass
+    CellPass,
+    // Zoom/Shore stages run tile by tile through FBiomeTiles
+    Tiled
+};
+
+struct FBiomePlanStep
+{
+    EBiomePlanStepKind Kind = EBiomePlanStepKind::Stage;
+    TArray<FBiomeStageDesc> Stages;
+};
+
+struct FBiomePipelinePlan
+{
+    TArray<FBiomePlanStep> Steps;
+
+    // Side length of the final board
+    int32 OutputSize = 0;
+
+    int32 NumStages = 0;
+
+    // Full-board sweeps the steps make; a bitboard step makes one per stage
+    int32 NumPasses = 0;
+};
+
+struct DIAMONDSQUARECPP_API FBiomePipelinePlanner
+{
+    // Side length of the board the Island stage starts from
+    static constexpr int32 IslandSize = 4;
+
+    // Largest final board the planner accepts
+    static constexpr int32 MaxOutputSize = 8192;
+
+    // Stage order TestIsland has always used
+    static TArray<FBiomeStageDesc> GetDefaultStages(bool bSurroundWithOcean);
+
+    // Checks the enabled stages and groups them into steps. Returns false with OutError set when the
+    // pipeline cannot run.
+    static bool Plan(const TArray<FBiomeStageDesc>& Stages, bool bTiled, FBiomePipelinePlan& OutPlan, FString& OutError);
+
+    // Stages that only ever produce Land and Ocean from Land and Ocean
+    static bool IsBitboardStage(EBiomeStage Stage);
+
+    // Stages reading only a fixed neighbourhood, with no sequential random draws
+    static bool IsTileStage(EBiomeStage Stage);
+
+    // Stages rewriting each cell from its own value alone
+    static bool IsPointStage(EBiomeStage Stage);
+
+    // Neighbour rule of a stage, or nullptr when the stage is not one
+    static const FBiomeCellRule* GetCellRule(EBiomeStage Stage);
+
+    // DeepOcean and Shore radii their 3x3 neighbourhood rules reproduce exactly: [sqrt(2), 2)
+    static bool IsStencilRadius(float Radius);
+
+    // False for a DeepOcean or Shore stage whose Radius needs the distance transform instead of its
+    // neighbourhood rule. Negative radii are not resolved yet and count as the default.
+    static bool IsStencilStage(const FBiomeStageDesc& Desc);
+};
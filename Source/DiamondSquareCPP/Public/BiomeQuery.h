@@ -0,0 +1,39 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LruCache.h"
+#include "HAL/CriticalSection.h"
+#include "BiomeTiles.h"
+
+// Point lookups on the final biome map. Only the board before the trailing tile stages is kept; tiles of the
+// final map are made from it on demand and memoized in a bounded LRU cache. Safe to use from any thread.
+class DIAMONDSQUARECPP_API FBiomeQuery
+{
+public:
+    using ECell = ADiamondSquare::ECell;
+
+    // Stages run over InRoot to make the final map; with none, InRoot is the final map
+    FBiomeQuery(TArray<TArray<ECell>>&& InRoot, const TArray<FBiomeTileStage>& InStages, int32 InTileSize, int32 MaxCachedTiles);
+
+    // Size of the final map, rows by columns
+    FIntPoint GetSize() const { return Size; }
+
+    const TArray<TArray<ECell>>& GetRoot() const { return Root; }
+    const TArray<FBiomeTileStage>& GetStages() const { return Stages; }
+
+    // Biome at row X, column Y of the final map; false when outside it
+    bool GetBiome(int32 X, int32 Y, ECell& OutBiome);
+
+private:
+    using FTilePtr = TSharedPtr<const FBiomeTile, ESPMode::ThreadSafe>;
+
+    FTilePtr FindOrMakeTile(const FIntPoint& TileCoord);
+
+    const TArray<TArray<ECell>> Root;
+    const TArray<FBiomeTileStage> Stages;
+    const FIntPoint Size;
+    const int32 TileSize;
+
+    FCriticalSection CacheLock;
+    TLruCache<FIntPoint, FTilePtr> Tiles;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Statistics of one connected region
+struct FBiomeRegion
+{
+    uint8 Class = 0;
+    int32 Area = 0;
+
+    // X rows, Y columns, Max exclusive
+    FIntRect Bounds;
+
+    // Mean (row, column) of the region's cells
+    FVector2D Centroid = FVector2D::ZeroVector;
+};
+
+// Connected regions of a grid, joining 4-neighbours of equal class. Labelling runs union-find on horizontal
+// strips in parallel, then merges the strip borders.
+struct DIAMONDSQUARECPP_API FBiomeRegions
+{
+    int32 Rows = 0;
+    int32 Cols = 0;
+
+    // Region index of every cell, row-major
+    TArray<int32> Labels;
+
+    // Regions in row-major order of their first cell
+    TArray<FBiomeRegion> Regions;
+
+    // Labels a Rows x Cols grid of classes (row-major), StripRows rows per parallel strip
+    static FBiomeRegions Label(const TArray<uint8>& Classes, int32 Rows, int32 Cols, int32 StripRows = 64);
+
+    // Row-major classes of the cells of Board, as given by ClassOf(Cell)
+    template <typename CellType, typename ClassOfType>
+    static TArray<uint8> MakeClasses(const TArray<TArray<CellType>>& Board, ClassOfType&& ClassOf)
+    {
+        const int32 NumRows = Board.Num();
+        const int32 NumCols = NumRows > 0 ? Board[0].Num() : 0;
+        TArray<uint8> Classes;
+        Classes.SetNumUninitialized(NumRows * NumCols);
+        for (int32 R = 0; R < NumRows; ++R)
+        {
+            for (int32 C = 0; C < NumCols; ++C)
+            {
+                Classes[R * NumCols + C] = ClassOf(Board[R][C]);
+            }
+        }
+        return Classes;
+    }
+
+    // Region at (R, C), or INDEX_NONE outside the grid
+    int32 GetRegion(int32 R, int32 C) const
+    {
+        return (R >= 0 && R < Rows && C >= 0 && C < Cols) ? Labels[R * Cols + C] : INDEX_NONE;
+    }
+
+    // Largest region of Class, or INDEX_NONE when there is none
+    int32 FindLargest(uint8 Class) const;
+
+    // Random cell of Region, falling back to its first cell when sampling its bounds keeps missing
+    FIntPoint GetRandomCell(int32 Region, FRandomStream& Random) const;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DiamondSquare.h"
+
+// Cells [Begin, End) of one row of a biome map
+struct FBiomeSpan
+{
+    int32 Row = 0;
+    int32 Begin = 0;
+    int32 End = 0;
+};
+
+// Read-only biome map stored as runs of equal cells along each row. After the Zoom stages the map is mostly
+// large uniform regions, so this is a small fraction of the board's size. Rows are X and columns Y, as in
+// the actor's BiomeMap. Immutable once built, so safe to share between threads.
+class DIAMONDSQUARECPP_API FBiomeRunMap
+{
+public:
+    using ECell = ADiamondSquare::ECell;
+
+    explicit FBiomeRunMap(const TArray<TArray<ECell>>& Board);
+
+    // Empty map, to be filled by loading it with operator<<
+    FBiomeRunMap() = default;
+
+    // Saves or loads the runs
+    friend DIAMONDSQUARECPP_API FArchive& operator<<(FArchive& Ar, FBiomeRunMap& Map);
+
+    // False for an empty map, or a loaded one whose runs do not tile its rows
+    bool IsValid() const;
+
+    // Size of the map, rows by columns
+    FIntPoint GetSize() const { return Size; }
+
+    int32 GetNumRuns() const { return RunStarts.Num(); }
+
+    SIZE_T GetAllocatedSize() const;
+
+    // Biome at row X, column Y, by binary search of the row's runs; false when outside the map
+    bool GetBiome(int32 X, int32 Y, ECell& OutBiome) const;
+
+    // Cell of Biome closest to From (Euclidean, From may lie off the map), searching no further than
+    // MaxDistance cells. Rows are visited outward from From and stop once they cannot beat the best found.
+    bool FindNearest(ECell Biome, const FIntPoint& From, FIntPoint& OutCell, int32 MaxDistance = MAX_int32) const;
+
+    // Row-major mask of the map, 1 for the cells whose biome is in Cells and 0 elsewhere
+    TArray<uint8> MakeMask(const ADiamondSquare::FCellSet& Cells) const;
+
+    // Appends the spans of Biome inside Rect (Max exclusive) to OutSpans and returns how many cells they cover
+    int32 FindInRect(ECell Biome, const FIntRect& Rect, TArray<FBiomeSpan>& OutSpans) const;
+
+private:
+    // Index of the run of row X covering column Y
+    int32 FindRun(int32 X, int32 Y) const;
+
+    // Column past the last cell of run Run on row X
+    int32 GetRunEnd(int32 X, int32 Run) const
+    {
+        return Run + 1 < RowOffsets[X + 1] ? RunStarts[Run + 1] : Size.Y;
+    }
+
+    FIntPoint Size;
+
+    // Runs of row X are RowOffsets[X] .. RowOffsets[X + 1] - 1
+    TArray<int32> RowOffsets;
+
+    // First column and biome of every run
+    TArray<int32> RunStarts;
+    TArray<ECell> RunBiomes;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <initializer_list>
+
+// Constexpr cell category sets for the cellular automaton stages. The stages themselves, with their neighbour
+// histograms, live in GenerationCore/BiomeStages.h.
+
+// Set of cell values stored as a bitmask; the enum must have fewer than 64 values
+template <typename CellType>
+struct TCellSet
+{
+    uint64 Bits = 0;
+
+    constexpr TCellSet() = default;
+
+    constexpr TCellSet(std::initializer_list<CellType> Cells)
+    {
+        for (CellType Cell : Cells)
+        {
+            Bits |= uint64(1) << uint64(Cell);
+        }
+    }
+
+    constexpr bool Contains(CellType Cell) const
+    {
+        return (Bits >> uint64(Cell)) & 1;
+    }
+
+    constexpr TCellSet operator|(const TCellSet& Other) const
+    {
+        TCellSet Result;
+        Result.Bits = Bits | Other.Bits;
+        return Result;
+    }
+};
+
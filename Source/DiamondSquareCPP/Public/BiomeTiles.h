@@ -0,0 +1,129 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DiamondSquare.h"
+#include "GenerationCore/BiomeStages.h"
+
+// Tiled execution of the late biome stages. Zoom and Shore read only a fixed neighbourhood of their input,
+// so any rectangle of the final board can be produced from a halo-padded rectangle of an earlier board.
+// Rectangles use X for rows and Y for columns, with Max exclusive, in the coordinates of their board.
+
+enum class EBiomeTileStageKind : uint8
+{
+    Zoom,
+    Shore
+};
+
+struct FBiomeTileStage
+{
+    EBiomeTileStageKind Kind = EBiomeTileStageKind::Zoom;
+
+    // Seeds the per-cell jitter of a Zoom stage
+    uint32 Seed = 0;
+
+    int32 GetScaleFactor() const { return Kind == EBiomeTileStageKind::Zoom ? 2 : 1; }
+};
+
+// Rectangle of cells from one board of the pyramid
+struct FBiomeTile
+{
+    FIntRect Rect;
+    int32 NumCols = 0;
+    TArray<ADiamondSquare::ECell> Cells;
+
+    void Init(const FIntRect& InRect)
+    {
+        Rect = InRect;
+        NumCols = InRect.Max.Y - InRect.Min.Y;
+        Cells.SetNumUninitialized((InRect.Max.X - InRect.Min.X) * NumCols);
+    }
+
+    ADiamondSquare::ECell Get(int32 R, int32 C) const
+    {
+        return Cells[(R - Rect.Min.X) * NumCols + (C - Rect.Min.Y)];
+    }
+
+    ADiamondSquare::ECell& At(int32 R, int32 C)
+    {
+        return Cells[(R - Rect.Min.X) * NumCols + (C - Rect.Min.Y)];
+    }
+};
+
+struct DIAMONDSQUARECPP_API FBiomeTiles
+{
+    using ECell = ADiamondSquare::ECell;
+
+    // Runs Stages over Input tile by tile on worker threads. The result matches running the stages
+    // one after another over the whole board.
+    static TArray<TArray<ECell>> Run(const TArray<TArray<ECell>>& Input, const TArray<FBiomeTileStage>& Stages, int32 TileSize);
+
+    // Produces OutputRect of the board Stages make from Input
+    static void RunTile(const TArray<TArray<ECell>>& Input, const TArray<FBiomeTileStage>& Stages, const FIntRect& OutputRect, FBiomeTile& OutTile);
+
+    // Board size after each stage; entry 0 is the input size
+    static TArray<FIntPoint> GetLevelSizes(const FIntPoint& InputSize, const TArray<FBiomeTileStage>& Stages);
+
+    // Input rectangle, clamped to the input board, that a stage reads to produce OutputRect
+    static FIntRect GetInputRect(const FBiomeTileStage& Stage, const FIntRect& OutputRect, const FIntPoint& InputSize);
+
+    // Well-mixed hash of a cell coordinate, so per-cell random choices do not depend on visiting order
+    static FORCEINLINE uint32 HashCell(uint32 Seed, int32 R, int32 C)
+    {
+        return GenerationCore::HashCell(Seed, R, C);
+    }
+
+    // Offset a Zoom edge cell copies from, drawn from { -1, -1, 0 x 8, 1, 1 } on each axis
+    static FORCEINLINE FIntPoint ZoomOffset(uint32 StageSeed, int32 R, int32 C)
+    {
+        const GenerationCore::FCellOffset Offset = GenerationCore::ZoomOffset(StageSeed, R, C);
+        return FIntPoint(Offset.R, Offset.C);
+    }
+
+    // Zoom output at (R, C) of a Rows x Cols board, given Scaled(R, C) reading the 2x upscaled input.
+    // Edge cells copy a jittered neighbour of the upscaled input.
+    template <typename ScaledType>
+    static FORCEINLINE ECell ZoomCell(ScaledType&& Scaled, int32 Rows, int32 Cols, uint32 StageSeed, int32 R, int32 C)
+    {
+        return GenerationCore::ZoomCell(Scaled, Rows, Cols, StageSeed, R, C);
+    }
+
+    // Shore output at (R, C) of a Rows x Cols board read through Get(R, C). Land next to Ocean but not
+    // next to DeepOcean becomes a beach matching its climate.
+    template <typename GetType>
+    static FORCEINLINE ECell ShoreCell(GetType&& Get, int32 Rows, int32 Cols, int32 R, int32 C)
+    {
+        const ECell Current = Get(R, C);
+        if (Current == ECell::Ocean)
+        {
+            return Current;
+        }
+
+        bool bNearOcean = false;
+        bool bNearDeepOcean = false;
+        for (int32 NR = FMath::Max(0, R - 1); NR <= FMath::Min(R + 1, Rows - 1); ++NR)
+        {
+            for (int32 NC = FMath::Max(0, C - 1); NC <= FMath::Min(C + 1, Cols - 1); ++NC)
+            {
+                if (NR == R && NC == C)
+                {
+                    continue;
+                }
+                const ECell Neighbour = Get(NR, NC);
+                bNearOcean |= Neighbour == ECell::Ocean;
+                bNearDeepOcean |= Neighbour == ECell::DeepOcean;
+            }
+        }
+
+        return (!bNearOcean || bNearDeepOcean) ? Current : ShoreBiome(Current);
+    }
+
+    // Beach that replaces a land cell on the coast, matching its climate
+    static FORCEINLINE ECell ShoreBiome(ECell Land)
+    {
+        if (ADiamondSquare::ColdShoreCells.Contains(Land))
+        {
+            return ECell::ColdBeach;
+        }
+        return Land == ECell::Swamp ? ECell::SwampShore : ECell::Beach;
+    }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Six cube faces projected onto the unit sphere. Face points are parameterized by (U, V) in [-1, 1]^2; the
+// edge a face shares with its neighbour maps to the same cube points on both, so meshes built face by face
+// meet exactly when both sides sample the same parameters.
+struct DIAMONDSQUARECPP_API FCubeSphere
+{
+    static constexpr int32 NumFaces = 6;
+
+    // Point of the cube [-1, 1]^3 at (U, V) of Face: Normal + U * AxisU + V * AxisV, with AxisU x AxisV
+    // pointing out of the face
+    static FVector GetCubePoint(int32 Face, double U, double V);
+
+    // Unit-sphere point of a cube point. Spreads cells far more evenly than normalizing, so grid cells near the
+    // face corners are not squeezed.
+    static FVector CubeToSphere(const FVector& CubePoint);
+
+    static FVector GetSpherePoint(int32 Face, double U, double V)
+    {
+        return CubeToSphere(GetCubePoint(Face, U, V));
+    }
+
+    // Face parameter of sample Index of Count + 1 evenly spaced samples across a face. Mirrored samples give
+    // exactly negated parameters, which keeps shared edges identical between faces.
+    static double GetFaceParameter(int32 Index, int32 Count)
+    {
+        return double(2 * Index - Count) / double(Count);
+    }
+};
@@ -2,11 +2,46 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "HAL/CriticalSection.h"
 #include "ProceduralMeshComponent.h"
+#include "BiomeBitboard.h"
+#include "BiomeStencil.h"
+#include "TerrainHeightField.h"
+#include "TerrainErosion.h"
+#include "TerrainCaves.h"
 #include "DiamondSquare.generated.h"
 
 class UProceduralMeshComponent;
 class UMaterialInterface;
+class UStaticMesh;
+class UHierarchicalInstancedStaticMeshComponent;
+class UBiomePipeline;
+class FBiomeQuery;
+class FBiomeRunMap;
+struct FBiomeRegions;
+struct FTerrainWorldPlanes;
+struct FBiomePipelinePlan;
+struct FBiomeStageDesc;
+struct FBiomeCellRule;
+enum class EBiomeStage : uint8;
+
+// Decimated collision geometry for one square chunk of the terrain grid
+USTRUCT()
+struct FTerrainCollisionChunk
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    TArray<FVector> Vertices;
+
+    UPROPERTY()
+    TArray<int32> Triangles;
+
+    UPROPERTY()
+    FBox Bounds = FBox(ForceInit);
+
+    bool bEnabled = false;
+};
 
 UCLASS()
 class DIAMONDSQUARECPP_API ADiamondSquare : public AActor
@@ -14,7 +49,7 @@ class DIAMONDSQUARECPP_API ADiamondSquare : public AActor
     GENERATED_BODY()
 
 public:
-    enum class ECell
+    enum class ECell : uint8
     {
         Land,
         Ocean,
@@ -51,8 +86,38 @@ public:
         Mesa
     };
 
+    using FCellSet = TCellSet<ECell>;
+
+    // Cell categories used by the automaton stages
+    static constexpr FCellSet OceanCells = { ECell::Ocean };
+    static constexpr FCellSet DeepOceanCells = { ECell::DeepOcean };
+    static constexpr FCellSet CoolerCells = { ECell::Cold, ECell::Freezing };
+    static constexpr FCellSet WarmerCells = { ECell::Warm, ECell::Temperate };
+    static constexpr FCellSet TemperatureCells = { ECell::Warm, ECell::Temperate, ECell::Cold, ECell::Freezing };
+    static constexpr FCellSet ColdShoreCells = { ECell::Tundra, ECell::IcePlains, ECell::Taiga, ECell::SnowyForest, ECell::DeepOcean, ECell::Ice };
+
+    // Cells that separate islands: the sea, and the rivers carved through the land
+    static constexpr FCellSet IslandWaterCells = { ECell::Ocean, ECell::DeepOcean, ECell::River };
+
+    // Biomes whose terrain gets the volumetric cave layer
+    static constexpr FCellSet CaveCells = { ECell::Mountain, ECell::Volcanic, ECell::Mesa };
+
+    // Kinds of environment objects scattered by PlaceEnvironmentObjects
+    enum class EFoliageKind
+    {
+        Tree,
+        Rock,
+        Building,
+        Num
+    };
+
     ADiamondSquare();
 
+    // Saves the height plane and the biome runs with the level after the properties, so queries work in a
+    // loaded level, PIE and a cooked game without a rebuild
+    virtual void Serialize(FArchive& Ar) override;
+    virtual void PostLoad() override;
+
     UPROPERTY(EditAnywhere)
     bool recreateMesh = false;
 
@@ -86,25 +151,245 @@ public:
     UPROPERTY(EditAnywhere)
     bool SurroundMapWithOcean = false;
 
+    // Grid cells over which land rises from the waterline to its full height; 0 keeps the biome heights as they are
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0))
+    float ShoreFalloff = 0.0f;
+
+    // Grid cells over which each biome's height range blends into its neighbours'; 0 keeps hard steps at biome edges
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0))
+    int32 BiomeBlendRadius = 0;
+
+    // Box filters stacked for the blend: 1 is a plain box, 3 is close to a Gaussian
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1, ClampMax = 4))
+    int32 BiomeBlendPasses = 3;
+
+    // Hydraulic and thermal erosion of the heightmap before the mesh is built
+    UPROPERTY(EditAnywhere, Category = "Erosion")
+    FTerrainErosionSettings Erosion;
+
+    // Marks cells with a large enough catchment as River and carves them into the heightmap
+    UPROPERTY(EditAnywhere, Category = "Rivers")
+    bool bGenerateRivers = false;
+
+    // Grid cells that must drain through a cell before it becomes River
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1.0f), Category = "Rivers")
+    float RiverThreshold = 1000.0f;
+
+    // Noise units a river at the threshold is cut into the terrain; larger rivers cut up to three times deeper
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Rivers")
+    float RiverDepth = 0.02f;
+
+    // Tunnels and overhangs under the CaveCells biomes, meshed as extra sections in place of the heightmap there
+    UPROPERTY(EditAnywhere, Category = "Caves")
+    FTerrainCaveSettings Caves;
+
+    // Bakes the share of sky each vertex sees into the vertex colour alpha, for materials to use as ambient
+    // occlusion when dynamic global illumination is off. Alpha is 1 everywhere when unset.
+    UPROPERTY(EditAnywhere, Category = "Lighting")
+    bool bBakeAmbientOcclusion = false;
+
+    // Azimuths scanned for the horizon: 4, 8 or 16
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 4, ClampMax = 16), Category = "Lighting")
+    int32 AmbientOcclusionDirections = 16;
+
     UPROPERTY(EditAnywhere)
     bool CalculateTangents = false;
 
+    // Cook collision off the game thread; the mesh has no collision until cooking finishes
+    UPROPERTY(EditAnywhere, Category = "Collision")
+    bool bUseAsyncCooking = true;
+
+    // Grid cells between collision proxy vertices; 1 uses the full render resolution
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1, ClampMax = 64), Category = "Collision")
+    int32 CollisionResolution = 4;
+
+    // Side length, in grid cells, of each independently enabled collision chunk
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 8, ClampMax = 2048), Category = "Collision")
+    int32 CollisionChunkSize = 64;
+
+    // In game, only chunks within this distance of the player pawn keep collision; 0 keeps all chunks
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0), Category = "Collision")
+    float CollisionRadius = 0.0f;
+
+    // Side lengths of the map GenerateOffline writes, which may be far larger than the mesh grid
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 2, ClampMax = 65536), Category = "Offline")
+    int32 OfflineXSize = 16384;
+
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 2, ClampMax = 65536), Category = "Offline")
+    int32 OfflineYSize = 16384;
+
+    // Output path without extension, relative to the project's Saved directory unless absolute
+    UPROPERTY(EditAnywhere, Category = "Offline")
+    FString OfflineOutputPath = TEXT("Terrain/Offline");
+
+    // Working memory GenerateOffline may use, whatever the map size
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 64), Category = "Offline")
+    int32 OfflineMemoryBudgetMB = 1024;
+
+    // Writes an OfflineXSize x OfflineYSize map to OfflineOutputPath with GenerateToDisk
+    UFUNCTION(CallInEditor, Category = "Offline")
+    void GenerateOffline();
+
+    // Generates a SizeX x SizeY height and biome map in strips of rows, within MemoryBudgetBytes of working memory,
+    // into BasePath.r16 (uint16 heights) and BasePath.biome (one ECell per cell), both row-major with X as the row.
+    // Uses the same noise, biome stages, biome blending and shore falloff as the mesh; erosion, rivers, caves and
+    // the other whole-map passes do not run. Returns false, having logged why, when the map cannot be written.
+    bool GenerateToDisk(const FString& BasePath, int32 SizeX, int32 SizeY, int64 MemoryBudgetBytes);
+
+    // Runs the biome stages of a map of MapSize cells up to its trailing tile stages, returned seeded in
+    // OutStages, so that GenerateRegion can make any part of the map from OutRoot on demand
+    void PrepareRegions(const FIntPoint& MapSize, TArray<TArray<ECell>>& OutRoot, TArray<struct FBiomeTileStage>& OutStages);
+
+    // Biomes and uint16 noise heights of Region (X rows, Y columns, Max exclusive) of the map Root and Stages make,
+    // row-major, as GenerateToDisk writes them. Reads GetRegionHalo cells around Region, so neighbouring regions
+    // agree with a whole-map run. Safe to call from any thread once PrepareRegions has run.
+    void GenerateRegion(const TArray<TArray<ECell>>& Root, const TArray<struct FBiomeTileStage>& Stages, const FIntPoint& MapSize, const FIntRect& Region, TArray<ECell>& OutBiomes, TArray<uint16>& OutHeights) const;
+
+    // Cells around a region that the biome blend and the shore falloff read
+    int32 GetRegionHalo() const;
+
+    // Working memory GenerateRegion needs per cell of its region and halo, counted from the buffers it allocates
+    int64 GetRegionBytesPerCell() const;
+
+    // World file path, relative to the project's Saved directory unless absolute
+    UPROPERTY(EditAnywhere, Category = "World File")
+    FString WorldFilePath = TEXT("Terrain/World.dsw");
+
+    // Writes the generated heights and biomes to WorldFilePath on the next rebuild
+    UPROPERTY(EditAnywhere, Category = "World File")
+    bool bSaveWorldFile = false;
+
+    // Builds the next rebuild from WorldFilePath instead of generating; noise, biome stages, erosion and rivers
+    // are skipped, and the grid takes the saved size
+    UPROPERTY(EditAnywhere, Category = "World File")
+    bool bLoadWorldFile = false;
+
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 8, ClampMax = 2048), Category = "World File")
+    int32 WorldFileChunkSize = 256;
+
+    // Enables collision on the chunks near FocusLocation (world space) and disables it on the rest
+    UFUNCTION(BlueprintCallable, Category = "Collision")
+    void UpdateCollisionChunks(const FVector& FocusLocation);
+
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Biome Map Parameters")
     int32 Seed = 0;
 
     UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f, ClampMax = 1.0f), Category = "Biome Map Parameters")
     float ProbabilityOfLand = 0.5f;
+
+    // Ocean further than this from land or the map edge turns deep, in cells of the board DeepOcean runs on.
+    // Values in [1.42, 2) give the classic rule of eight ocean neighbours.
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1.0f), Category = "Biome Map Parameters")
+    float DeepOceanDistance = 1.5f;
+
+    // Land this close to Ocean, and further than this from DeepOcean, becomes beach, in cells of the board
+    // Shore runs on. Values in [1.42, 2) give the classic one-cell beach.
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1.0f), Category = "Biome Map Parameters")
+    float ShoreWidth = 1.5f;
+
+    // Islands smaller than this many cells are removed by RemoveSpecks stages, in cells of the board they run on
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0), Category = "Biome Map Parameters")
+    int32 MinIslandArea = 16;
+
+    // Stages that build the biome map; when unset the built-in order runs, honouring SurroundMapWithOcean
+    UPROPERTY(EditAnywhere, Category = "Biome Map Parameters")
+    UBiomePipeline* BiomePipeline = nullptr;
+
+    // Run the Zoom/Shore stages tile by tile on worker threads; the result is identical either way
+    UPROPERTY(EditAnywhere, Category = "Biome Map Parameters")
+    bool bTiledBiomeStages = true;
+
+    // Side length, in cells of the final biome map, of each tile
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 16, ClampMax = 2048), Category = "Biome Map Parameters")
+    int32 BiomeTileSize = 128;
+
+    // Most tiles of the biome map beyond the grid that GetBiomeAt keeps in memory at once
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1), Category = "Biome Map Parameters")
+    int32 MaxCachedBiomeTiles = 64;
+
+    // Biome at cell (X, Y) of the last generated map; false before generation or outside the map. Cells of the
+    // grid come from the saved run-length map. The biome stages make a larger map than the grid, and cells of it
+    // beyond the grid are made tile by tile on first use and memoized. Safe to call from any thread.
+    bool GetBiomeAt(int32 X, int32 Y, ECell& OutBiome) const;
+
+    // Cell of Biome nearest to grid cell From in the last generated map, within MaxDistance cells.
+    // Safe to call from any thread.
+    bool FindNearestBiome(ECell Biome, const FIntPoint& From, FIntPoint& OutCell, int32 MaxDistance = MAX_int32) const;
+
+    // Run-length copy of the last generated map, for rectangle and repeated queries from any thread
+    TSharedPtr<const FBiomeRunMap, ESPMode::ThreadSafe> GetBiomeRuns() const;
+
+    // Biome under a world location, read through the actor transform; game thread only
+    bool GetBiomeAtLocation(const FVector& WorldLocation, ECell& OutBiome) const;
+
+    // Lazy lookup of the whole map the biome stages make, for callers that keep querying it from other threads
+    TSharedPtr<FBiomeQuery, ESPMode::ThreadSafe> GetBiomeQuery() const;
+
+    // Land (class 1) and water (class 0) regions of the grid from the last construction, labelled once erosion
+    // and rivers have run, with row X and column Y. Rivers count as water, so a river cut through to the sea
+    // splits the land either side into separate islands. Safe to call from any thread.
+    TSharedPtr<const FBiomeRegions, ESPMode::ThreadSafe> GetIslands() const;
+
+    // Random grid cell on the largest island; false when the grid has no land. Safe to call from any thread.
+    bool FindSpawnCellOnMainIsland(FRandomStream& Random, FIntPoint& OutCell) const;
+
+    // Ground height (world Z) under WorldLocation, read from the height plane kept after construction and
+    // saved with the level. Returns false when the location is off the grid, in which case the nearest edge is
+    // sampled, or before the mesh is built. Reads the actor transform at call time, so the ground follows the
+    // actor when it moves. Safe to call from any thread while the actor is not being moved.
+    bool GetHeightAt(const FVector& WorldLocation, float& OutHeight, ETerrainSampleFilter Filter = ETerrainSampleFilter::Bilinear) const;
+
+    // World-space ground normal under WorldLocation, on the same terms as GetHeightAt
+    bool GetNormalAt(const FVector& WorldLocation, FVector& OutNormal, ETerrainSampleFilter Filter = ETerrainSampleFilter::Bilinear) const;
+
+    // Batched GetHeightAt/GetNormalAt, taking the snapshot once. The outputs must be at least as long as
+    // WorldLocations and are left untouched before the mesh is built. Returns how many locations are on the grid.
+    int32 GetHeightsAt(TArrayView<const FVector> WorldLocations, TArrayView<float> OutHeights, ETerrainSampleFilter Filter = ETerrainSampleFilter::Bilinear) const;
+    int32 GetNormalsAt(TArrayView<const FVector> WorldLocations, TArrayView<FVector> OutNormals, ETerrainSampleFilter Filter = ETerrainSampleFilter::Bilinear) const;
+
+    // Height plane of the last built mesh, in actor space
+    TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe> GetHeightField() const;
+
+    // Heights a biome's noise maps onto, as (low, high)
+    static FVector2f GetBiomeHeightRange(ECell BiomeType);
+
+    // Vertex color of a biome at noise height Z, before the per-vertex jitter
+    static FLinearColor GetBiomeBaseColor(float Z, ECell BiomeType);
+
+    // Name of the enumerator, for logs and reports
+    static const TCHAR* GetCellName(ECell Cell);
+
+    // Runs the generation steps of a rebuild up to the finished height and biome maps, without touching the mesh:
+    // the biome stages, the noise fill, and erosion and rivers when they are enabled
+    void GenerateWorld(FTerrainWorldPlanes& OutWorld);
    
     //UPROPERTY(EditAnywhere, Category = "Procedural Generation")
     bool addProceduralObjects = false;
 
-    // Make the mesh component editable in the Unreal Editor
-    //UPROPERTY(EditAnywhere, Category = "Procedural Generation")
-    UInstancedStaticMeshComponent* TreeMeshComponent;
-   
+    UPROPERTY(EditAnywhere, Category = "Procedural Generation")
+    UStaticMesh* TreeMesh = nullptr;
+
+    UPROPERTY(EditAnywhere, Category = "Procedural Generation")
+    UStaticMesh* RockMesh = nullptr;
+
+    UPROPERTY(EditAnywhere, Category = "Procedural Generation")
+    UStaticMesh* BuildingMesh = nullptr;
+
+    // Side length, in grid cells, of the square cluster each foliage component covers
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 8, ClampMax = 2048), Category = "Procedural Generation")
+    int32 FoliageClusterSize = 64;
 
     void PlaceEnvironmentObjects(const TArray<TArray<float>>& NoiseMap);
 
+    // Rescatters the foliage of grid cells Min to Max (exclusive) over the built terrain, reading its heights and
+    // biomes from the height field and biome lookups; only the clusters overlapping the cells are rebuilt
+    UFUNCTION(BlueprintCallable, Category = "Procedural Generation")
+    void RegenerateRegion(FIntPoint Min, FIntPoint Max);
+
+    // Clears and repopulates only the foliage clusters overlapping CellRegion (grid cells, Max exclusive), with
+    // the vertex height and biome of each cell read through GetCellHeight and GetCellBiome
+    void RebuildFoliageRegion(const FIntRect& CellRegion, TFunctionRef<float(int32, int32)> GetCellHeight, TFunctionRef<ECell(int32, int32)> GetCellBiome);
+
 protected:
     virtual void BeginPlay() override;
     virtual void OnConstruction(const FTransform& Transform) override;
@@ -116,6 +401,13 @@ public:
     virtual void Tick(float DeltaTime) override;
 
 private:
+    // Times the engine-only biome stages through RunStage
+    friend class FBiomeStagePerformanceTest;
+    // Check the bitboard, fused and tiled pipeline paths against RunStage
+    friend class FBiomePipelineFusedTest;
+    friend class FBiomePipelineBitboardTest;
+    friend class FBiomePipelineTiledTest;
+
     UProceduralMeshComponent* ProceduralMesh;
     TArray<FVector> Vertices;
     TArray<int> Triangles;
@@ -125,17 +417,127 @@ private:
 
     TArray<FColor> Colors;
 
+    UPROPERTY()
+    TArray<FTerrainCollisionChunk> CollisionChunks;
+
+    void BuildCollisionChunks(const TArray<TArray<float>>& NoiseMap);
+
+    // Whether every grid vertex from (MinX, MinY) to (MaxX, MaxY) inclusive is entirely under the cave layer
+    bool IsUnderCaves(int32 MinX, int32 MinY, int32 MaxX, int32 MaxY) const;
+    void CommitCollisionChunks();
+
+    // One HISM per foliage cluster and kind, indexed by GetFoliageClusterIndex
+    UPROPERTY(VisibleInstanceOnly, Category = "Procedural Generation")
+    TArray<UHierarchicalInstancedStaticMeshComponent*> FoliageClusters;
+    int32 FoliageClustersX = 0;
+    int32 FoliageClustersY = 0;
+
+    void ResetFoliageClusters();
+    int32 GetFoliageClusterIndex(int32 ClusterX, int32 ClusterY, EFoliageKind Kind) const;
+    UHierarchicalInstancedStaticMeshComponent* GetOrCreateFoliageCluster(int32 ClusterX, int32 ClusterY, EFoliageKind Kind);
+    UStaticMesh* GetFoliageMesh(EFoliageKind Kind) const;
+    float GetFoliageDensity(ECell BiomeType, EFoliageKind Kind) const;
+    void GetFoliageCullSettings(ECell BiomeType, EFoliageKind Kind, int32& StartCull, int32& EndCull, float& LODDistanceScale) const;
+    float GetVertexHeight(float NoiseValue) const;
+
+    // Fractal noise at grid vertex (X, Y), before the biome height ranges apply
+    float GetBaseNoise(int32 X, int32 Y) const;
+
     void CreateVertices(const TArray<TArray<float>>& NoiseMap);
+
+    // Writes the sky visibility of every grid vertex into the alpha of Colors
+    void BakeAmbientOcclusion(const TArray<TArray<float>>& NoiseMap);
     void CreateTriangles();
 
     TArray<TArray<float>> GeneratePerlinNoiseMap();
 
+    // GeneratePerlinNoiseMap followed by erosion and rivers when they are enabled
+    TArray<TArray<float>> GenerateNoiseMap();
+
+    // Runs Erosion over the grid part of NoiseMap, in cells of height rather than noise units
+    void ErodeNoiseMap(TArray<TArray<float>>& NoiseMap) const;
+
+    // Routes water over the grid part of NoiseMap to the sea and the map edge, then carves and marks the rivers
+    void CarveRivers(TArray<TArray<float>>& NoiseMap);
+
+    // 1 for the ocean cells of BiomeMap and 0 elsewhere, row-major
+    TArray<uint8> GetWaterMask() const;
+
+    // Publishes BiomeRuns and Islands from the finished BiomeMap
+    void PublishBiomeLookups();
+
+    // Labels the land and water regions of Runs into Islands
+    void LabelIslands(const FBiomeRunMap& Runs);
+
+    // Labels Islands from the saved biome runs after loading, when they are not there yet
+    void RestoreIslands();
+
+    // NoiseMap and BiomeMap as quantized world file planes
+    void MakeWorldPlanes(const TArray<TArray<float>>& NoiseMap, FTerrainWorldPlanes& OutWorld) const;
+
+    bool SaveWorldFile(const TArray<TArray<float>>& NoiseMap) const;
+
+    // Fills OutNoiseMap, BiomeMap and the biome lookups from WorldFilePath; false, having logged why, when it
+    // cannot be loaded
+    bool LoadWorldFile(TArray<TArray<float>>& OutNoiseMap);
+
+    // Share of each grid vertex under the cave layer, blurred over Caves.BlendRadius; empty when caves are off.
+    // CreateTriangles leaves out the quads entirely under it.
+    TArray<float> CaveMask;
+
+    void BuildCaveMask();
+
+    // Meshes the cave layer chunk by chunk on worker threads, then merges the chunks into at most
+    // Caves.MaxSections sections after the collision proxy
+    void BuildCaves(const TArray<TArray<float>>& NoiseMap);
+
     TArray<TArray<ADiamondSquare::ECell>> BiomeMap;
 
+    // Outlive BiomeMap, so lookups keep working after construction. The runs are saved with the level, the
+    // islands labelled again from them on load and the query prepared again in BeginPlay. BiomeQueryLock guards
+    // all three.
+    TSharedPtr<const FBiomeRunMap, ESPMode::ThreadSafe> BiomeRuns;
+    TSharedPtr<const FBiomeRegions, ESPMode::ThreadSafe> Islands;
+    TSharedPtr<FBiomeQuery, ESPMode::ThreadSafe> BiomeQuery;
+    mutable FCriticalSection BiomeQueryLock;
+
+    // Publishes a query over the map Stages make from Root
+    void PublishBiomeQuery(TArray<TArray<ECell>>&& Root, const TArray<struct FBiomeTileStage>& Stages);
+
+    // Quantized vertex heights, kept after the noise map is dropped
+    TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe> HeightField;
+    mutable FCriticalSection HeightFieldLock;
+
+    bool GetHeightFieldSnapshot(TSharedPtr<const FTerrainHeightField, ESPMode::ThreadSafe>& OutField, FTransform& OutTransform) const;
+
     FLinearColor GetColorBasedOnBiomeAndHeight(float Z, ECell BiomeType);
     float GetInterpolatedHeight(float heightValue, ECell BiomeType);
 
     FRandomStream Rng;
+    int32 ZoomStageIndex = 0;
+
+    uint32 NextZoomSeed();
+
+    // Plans BiomePipeline, or the built-in stages when it is unset or cannot cover GridSize
+    void PlanBiomePipeline(const FIntPoint& GridSize, FBiomePipelinePlan& OutPlan);
+
+    // Runs Plan to its trailing tile stages and appends the tiled zooms that grow the map to MapSize
+    void RunRegionPipeline(const FBiomePipelinePlan& Plan, const FIntPoint& MapSize, TArray<TArray<ECell>>& OutRoot, TArray<struct FBiomeTileStage>& OutStages);
+
+    // Executes a planned pipeline from the Island stage. When the plan ends in tile stages, stops before
+    // them and returns their seeded list in OutTrailingStages.
+    TArray<TArray<ECell>> RunBiomePipeline(const FBiomePipelinePlan& Plan, TArray<struct FBiomeTileStage>& OutTrailingStages);
+    FBiomeBitboard RunBitboardStage(const FBiomeStageDesc& Desc, const FBiomeBitboard& Board);
+    TArray<TArray<ECell>> RunStage(const FBiomeStageDesc& Desc, const TArray<TArray<ECell>>& Board);
+    TArray<struct FBiomeTileStage> MakeTileStages(const TArray<FBiomeStageDesc>& Stages);
+    TArray<FBiomeStageDesc> ResolveStageDefaults(const TArray<FBiomeStageDesc>& Stages) const;
+
+    // One row-major sweep applying PointStage to every cell, then Rules in order. PointStage output is
+    // produced one row ahead of the rules, so its random draws happen in the same order as on its own.
+    TArray<TArray<ECell>> RunCellPass(const TArray<TArray<ECell>>& Board, TOptional<EBiomeStage> PointStage, TArrayView<const FBiomeCellRule* const> Rules);
+    ECell ApplyPointStage(EBiomeStage Stage, ECell Cell);
+    ECell AddTempsCell(ECell Cell);
+    ECell TemperatureToBiomeCell(ECell Cell);
 
     //Schostaic Automata Stack to Create Biome Map
     TArray<TArray<ECell>> Island(TArray<TArray<ECell>>& Board);
@@ -148,20 +550,23 @@ private:
     TArray<TArray<ECell>> WarmToTemperate(const TArray<TArray<ECell>>& Board);
     TArray<TArray<ECell>> FreezingToCold(const TArray<TArray<ECell>>& Board);
     TArray<TArray<ECell>> TemperatureToBiome(const TArray<TArray<ECell>>& Board);
-    TArray<TArray<ECell>> DeepOcean(const TArray<TArray<ECell>>& Board);
-    TArray<TArray<ECell>> Shore(const TArray<TArray<ECell>>& Board);
+    TArray<TArray<ECell>> DeepOcean(const TArray<TArray<ECell>>& Board, float Distance);
+    TArray<TArray<ECell>> Shore(const TArray<TArray<ECell>>& Board, float Width);
+    TArray<TArray<ECell>> RemoveSpecks(const TArray<TArray<ECell>>& Board, int32 MinArea);
     TArray<TArray<ECell>> SurroundWithOcean(TArray<TArray<ECell>>& Board);
 
+    // Land/Ocean stages on the packed bitboard, used until AddTemps introduces more cell values
+    FBiomeBitboard IslandBits();
+    FBiomeBitboard FuzzyZoomBits(const FBiomeBitboard& Board);
+    FBiomeBitboard AddIslandBits(const FBiomeBitboard& Board);
+    FBiomeBitboard ZoomBits(const FBiomeBitboard& Board);
+    FBiomeBitboard RemoveTooMuchOceanBits(const FBiomeBitboard& Board);
+    TArray<TArray<ECell>> ExpandBitboard(const FBiomeBitboard& Board) const;
+
 
 
     //helper functions
-    ECell SelectBiome(const TArray<ECell>& Biomes, const TArray<float>& Odds);
-    void SetBoardRegion(TArray<TArray<ECell>>& Board, int32 CenterX, int32 CenterY, int32 Radius, ECell NewState);
-    bool IsAdjacentToGroup(const TArray<TArray<ECell>>& Board, int32 X, int32 Y, const TSet<ECell>& GroupA, const TSet<ECell>& GroupB);
-    bool IsSurroundedByOcean(const TArray<TArray<ECell>>& Board, int32 i, int32 j);
-    bool IsEdgeCell(const TArray<TArray<ECell>>& Board, int32 i, int32 j);
     void PrintBoard(const TArray<TArray<ECell>>& Board);
     TArray<TArray<ECell>> TestIsland();
-    bool CanTransform(ECell CellType) const; 
     void InitializeSeed();
 };
\ No newline at end of file
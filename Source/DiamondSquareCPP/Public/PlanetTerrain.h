@@ -0,0 +1,170 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "DiamondSquare.h"
+#include "PlanetTerrain.generated.h"
+
+class UProceduralMeshComponent;
+class UMaterialInterface;
+
+// Elevation and biomes of a planet, as functions of the direction from its centre only, so every face and
+// chunk agrees wherever they meet
+USTRUCT(BlueprintType)
+struct FPlanetShape
+{
+    GENERATED_BODY()
+
+    // Sea-level radius, in actor units
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1.0f), Category = "Planet")
+    float Radius = 100000.0f;
+
+    // Height of the highest peaks above sea level
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Planet")
+    float HeightScale = 6000.0f;
+
+    UPROPERTY(EditAnywhere, Category = "Planet")
+    int32 Seed = 0;
+
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1, ClampMax = 16), Category = "Planet")
+    int32 Octaves = 8;
+
+    // Noise frequency over the unit sphere
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Planet")
+    float Frequency = 1.5f;
+
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Planet")
+    float Lacunarity = 2.0f;
+
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Planet")
+    float Persistence = 0.5f;
+
+    // Elevation, in [0, 1], of the sea surface
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f, ClampMax = 1.0f), Category = "Planet")
+    float SeaLevel = 0.5f;
+
+    // Elevation in [0, 1] of the terrain in unit direction Direction
+    float GetElevation(const FVector& Direction) const;
+
+    // Biome from latitude, altitude and a moisture field
+    ADiamondSquare::ECell GetBiome(const FVector& Direction, float Elevation) const;
+
+    // Actor-space surface point; seas are flat at Radius
+    FVector GetSurfacePoint(const FVector& Direction, float Elevation) const
+    {
+        return Direction * (Radius + FMath::Max(Elevation - SeaLevel, 0.0f) / FMath::Max(1.0f - SeaLevel, KINDA_SMALL_NUMBER) * HeightScale);
+    }
+
+private:
+    FVector GetNoiseOffset(int32 Salt) const;
+};
+
+// Geometry of one chunk of one face at one level of detail
+struct FPlanetChunkMesh
+{
+    TArray<FVector> Vertices;
+    TArray<int32> Triangles;
+    TArray<FVector> Normals;
+    TArray<FVector2D> UV0;
+    TArray<FColor> Colors;
+
+    // Builds the Resolution x Resolution quads of chunk (ChunkX, ChunkY) of Face, which is split into
+    // ChunksPerFace x ChunksPerFace chunks. A skirt hangs SkirtDepth below the border to hide cracks against
+    // neighbours at another level of detail.
+    void Build(const FPlanetShape& Shape, int32 Face, int32 ChunkX, int32 ChunkY, int32 ChunksPerFace, int32 Resolution, float SkirtDepth);
+};
+
+// A planet built from the six faces of a cube, each split into chunks whose level of detail follows the
+// distance to the viewer. Only the chunks near the viewer are at full resolution.
+UCLASS()
+class DIAMONDSQUARECPP_API APlanetTerrain : public AActor
+{
+    GENERATED_BODY()
+
+public:
+    APlanetTerrain();
+
+    UPROPERTY(EditAnywhere)
+    bool recreateMesh = false;
+
+    UPROPERTY(EditAnywhere, Category = "Planet")
+    FPlanetShape Shape;
+
+    // Chunks along each side of a cube face
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1, ClampMax = 32), Category = "Planet|Chunks")
+    int32 ChunksPerFace = 8;
+
+    // Quads along each side of a chunk at full detail; each coarser level halves it
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 4, ClampMax = 256), Category = "Planet|Chunks")
+    int32 ChunkResolution = 64;
+
+    // Distance from a chunk within which it is at full detail; each doubling of the distance drops one level
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1.0f), Category = "Planet|Chunks")
+    float LODDistance = 20000.0f;
+
+    // Level of detail every chunk is built at in the editor
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0, ClampMax = 6), Category = "Planet|Chunks")
+    int32 ConstructionLOD = 2;
+
+    // Most chunks rebuilt per update, nearest first, so flying around never stalls a frame for long
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1), Category = "Planet|Chunks")
+    int32 MaxChunkBuildsPerUpdate = 24;
+
+    // Depth of the skirts hiding cracks between chunks at different levels of detail, as a share of HeightScale
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Planet|Chunks")
+    float SkirtDepth = 0.05f;
+
+    UPROPERTY(EditAnywhere, Category = "Planet|Chunks")
+    bool bCreateCollision = false;
+
+    // Picks every chunk's level of detail for a viewer at ViewLocation (world space) and rebuilds those that changed
+    UFUNCTION(BlueprintCallable, Category = "Planet")
+    void UpdateLOD(const FVector& ViewLocation);
+
+    // Biome of the planet surface in world direction Direction from its centre
+    ADiamondSquare::ECell GetBiomeAt(const FVector& Direction) const;
+
+protected:
+    virtual void BeginPlay() override;
+    virtual void OnConstruction(const FTransform& Transform) override;
+
+    UPROPERTY(EditAnywhere)
+    UMaterialInterface* Material;
+
+public:
+    virtual void Tick(float DeltaTime) override;
+
+private:
+    struct FChunk
+    {
+        int32 Face = 0;
+        int32 X = 0;
+        int32 Y = 0;
+
+        // Centre and bounding radius in actor space, including the tallest possible terrain
+        FVector Center = FVector::ZeroVector;
+        float BoundRadius = 0.0f;
+
+        // Level the section holds, INDEX_NONE before it is built
+        int32 LOD = INDEX_NONE;
+    };
+
+    UProceduralMeshComponent* ProceduralMesh;
+    TArray<FChunk> Chunks;
+
+    // Level each section was built at, INDEX_NONE where none was; saved with the sections so BeginPlay can
+    // keep them
+    UPROPERTY()
+    TArray<int32> SectionLODs;
+
+    // Clears the sections and lays out the chunks with none built
+    void ResetChunks();
+
+    // Lays out Chunks for the current settings, leaving the sections alone
+    void InitChunks();
+
+    int32 GetMaxLOD() const;
+
+    // Rebuilds the chunks whose level differs from TargetLODs, at most MaxBuilds of them in the order given
+    void BuildChunks(const TArray<int32>& TargetLODs, const TArray<int32>& Order, int32 MaxBuilds);
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TerrainBatchCommandlet.generated.h"
+
+// Generates the height and biome maps of a range of seeds headless, for vetting seeds in bulk:
+//
+//   UnrealEditor-Cmd DiamondSquareCPP.uproject -run=TerrainBatch -seeds=0..499 [-params=Terrain.json]
+//       [-out=Terrain/Batch] [-jobs=N] [-raw] -nullrhi
+//
+// The parameter file is a JSON object of ADiamondSquare properties, nested structs and arrays included, applied
+// over the defaults. Each seed runs TestIsland and GeneratePerlinNoiseMap, then erosion and rivers when enabled,
+// as a rebuild would, and writes Seed_<n>.dsw (FTerrainWorldFile, loadable with bLoadWorldFile) or, with -raw,
+// Seed_<n>.r16 and Seed_<n>.biome. Seed_<n>.json holds the land fraction, the biome histogram and the timings,
+// and Summary.csv has a row per seed. Relative paths start from the project directory for -params and from the
+// project's Saved directory for -out.
+//
+// Seeds are jobs on a queue served by -jobs worker threads, each with its own terrain; the stages inside a job
+// spread over the task graph, so every core stays busy. A job holds about 64 bytes per cell of its XSize x YSize
+// map at its peak, and -jobs defaults to the number of physical cores or to the jobs the free physical memory
+// holds, whichever is fewer.
+UCLASS()
+class DIAMONDSQUARECPP_API UTerrainBatchCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+    UTerrainBatchCommandlet();
+
+    virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Box filtering through a summed-area table: every cell costs four table reads whatever the radius. Stacked
+// passes approach a Gaussian (three are within a few percent).
+struct DIAMONDSQUARECPP_API FTerrainBoxBlur
+{
+    // Replaces each cell of a Rows x Cols plane (row-major) with the mean of the (2 * Radius + 1)^2 box around
+    // it, Passes times. Boxes are clipped at the border and averaged over the cells they keep.
+    static void Blur(TArray<float>& Plane, int32 Rows, int32 Cols, int32 Radius, int32 Passes = 1);
+
+    // Inclusive prefix sums of a Rows x Cols plane into a (Rows + 1) x (Cols + 1) table with a zero first row
+    // and column. Doubles keep the sums exact enough over an 8192^2 map.
+    static void BuildTable(const TArray<float>& Plane, int32 Rows, int32 Cols, TArray<double>& OutTable);
+};
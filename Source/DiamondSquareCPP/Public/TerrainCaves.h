@@ -0,0 +1,102 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TerrainCaves.generated.h"
+
+// Volumetric layer under the cave biomes, where a heightmap cannot express tunnels or overhangs. Lengths are
+// in grid cells, vertically as well as across.
+USTRUCT(BlueprintType)
+struct FTerrainCaveSettings
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, Category = "Caves")
+    bool bEnabled = false;
+
+    // Side length, in grid cells, of the column of voxels each mesh section covers
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 8, ClampMax = 256), Category = "Caves")
+    int32 ChunkSize = 32;
+
+    // Frequency of the tunnel and overhang noise, per cell
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.001f, ClampMax = 1.0f), Category = "Caves")
+    float Frequency = 0.06f;
+
+    // Tunnels run where two noise fields are both within this of zero; larger values widen them
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f, ClampMax = 0.5f), Category = "Caves")
+    float TunnelWidth = 0.06f;
+
+    // Deepest a tunnel reaches below the surface
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1.0f), Category = "Caves")
+    float Depth = 24.0f;
+
+    // Furthest the surface is pushed in or out, which carves overhangs and arches into slopes
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Caves")
+    float OverhangHeight = 3.0f;
+
+    // Cells over which the layer fades into the heightmap around the cave biomes
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1, ClampMax = 16), Category = "Caves")
+    int32 BlendRadius = 3;
+
+    // Most mesh sections the chunks are merged into; each section is a draw call, and a body with collision
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 1, ClampMax = 64), Category = "Caves")
+    int32 MaxSections = 8;
+
+    // Cook collision for the cave walls. The heightmap's collision leaves out the quads under the layer either
+    // way, so the caves can be walked into only with this on.
+    UPROPERTY(EditAnywhere, Category = "Caves")
+    bool bCreateCollision = false;
+};
+
+// Terrain the cave density is built from, as row-major Rows x Cols planes over the grid vertices
+struct FTerrainCaveField
+{
+    int32 Rows = 0;
+    int32 Cols = 0;
+
+    // Surface height of each vertex, in cells
+    TArray<float> Heights;
+
+    // 1 inside the cave biomes, fading to 0 outside them; only cells above 0 are meshed
+    TArray<float> Mask;
+
+    // Surface vertex colours, carried down the cave walls
+    TArray<FColor> Colors;
+
+    // Offset of the noise fields, picked from the seed
+    FVector NoiseOffset = FVector::ZeroVector;
+
+    // Actor-space size of a cell, and UV units per cell
+    float CellSize = 1.0f;
+    float UVScale = 0.0f;
+
+    // Signed density of lattice point (X, Y, Z): positive in rock, negative in air. Depends on nothing but the
+    // point, so chunks sampling the same point agree exactly.
+    float GetDensity(int32 X, int32 Y, int32 Z, const FTerrainCaveSettings& Settings) const;
+};
+
+struct FTerrainCaveMesh
+{
+    TArray<FVector> Vertices;
+    TArray<int32> Triangles;
+    TArray<FVector> Normals;
+    TArray<FVector2D> UV0;
+    TArray<FColor> Colors;
+
+    // Lattice points sampled and time spent, for throughput reports
+    int64 NumVoxels = 0;
+    double Seconds = 0.0;
+};
+
+// Surface nets over the density: one vertex per voxel the surface crosses, at the mean of its edge crossings,
+// and one quad per crossed lattice edge joining the four voxels around it. Vertices are shared by every quad
+// of the chunk that uses them; chunks also mesh a one-voxel apron on their low sides, so the vertices on their
+// borders come out identical to the neighbour's and the sections meet without cracks.
+struct DIAMONDSQUARECPP_API FTerrainCaves
+{
+    // Meshes the grid cells of Cells (Max exclusive), over every height the surface can reach in them
+    static void BuildChunk(const FTerrainCaveField& Field, const FIntRect& Cells, const FTerrainCaveSettings& Settings, FTerrainCaveMesh& OutMesh);
+
+    // Appends the geometry of Meshes into OutMesh, one after the other. The apron vertices neighbouring chunks
+    // share are kept twice; they sit at the same place, so the seams stay closed.
+    static void MergeMeshes(TArrayView<const FTerrainCaveMesh> Meshes, FTerrainCaveMesh& OutMesh);
+};
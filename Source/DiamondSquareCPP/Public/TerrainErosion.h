@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TerrainErosion.generated.h"
+
+// Erosion of the heightmap between noise and mesh. Heights and lengths are both in grid cells.
+USTRUCT(BlueprintType)
+struct FTerrainErosionSettings
+{
+    GENERATED_BODY()
+
+    UPROPERTY(EditAnywhere, Category = "Erosion")
+    bool bEnabled = false;
+
+    // Pipe-model water simulation steps; each moves water and sediment by at most a cell
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0), Category = "Erosion")
+    int32 HydraulicIterations = 80;
+
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.001f, ClampMax = 0.2f), Category = "Erosion")
+    float TimeStep = 0.05f;
+
+    // Water depth added to every cell per unit of time
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Erosion")
+    float RainRate = 0.02f;
+
+    // Fraction of the water evaporating per unit of time
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Erosion")
+    float EvaporationRate = 0.5f;
+
+    // Sediment a unit of water can carry per unit of speed and slope
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Erosion")
+    float SedimentCapacity = 0.1f;
+
+    // Fractions of the capacity shortfall dissolved, and of the excess deposited, per step
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f, ClampMax = 1.0f), Category = "Erosion")
+    float DissolveRate = 0.3f;
+
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f, ClampMax = 1.0f), Category = "Erosion")
+    float DepositRate = 0.3f;
+
+    // Talus relaxation steps, run after the water
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0), Category = "Erosion")
+    int32 ThermalIterations = 40;
+
+    // Steepest stable height difference between neighbouring cells
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Erosion")
+    float TalusSlope = 0.8f;
+
+    // Share of a cell's steepest excess over TalusSlope that slides per step
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f, ClampMax = 0.5f), Category = "Erosion")
+    float ThermalRate = 0.25f;
+
+    // Opt-in wall-clock budget: stops iterating once this much time is spent, keeping whatever has been eroded.
+    // 0, the default, always runs the iterations above, so the same seed erodes the same on every machine. A
+    // budget that is reached makes the terrain depend on machine speed and load, so batch seeds and server
+    // tiles should leave it at 0.
+    UPROPERTY(EditAnywhere, Meta = (ClampMin = 0.0f), Category = "Erosion")
+    float MaxSeconds = 0.0f;
+};
+
+struct FTerrainErosionStats
+{
+    int32 HydraulicIterations = 0;
+    int32 ThermalIterations = 0;
+    double Seconds = 0.0;
+};
+
+// Every step is a Jacobi pass over structure-of-arrays planes: each cell gathers from its neighbours' previous
+// values and writes only itself, so bands of rows run in parallel with a result independent of the split.
+struct DIAMONDSQUARECPP_API FTerrainErosion
+{
+    // Erodes a Rows x Cols plane of heights (row-major) in place
+    static FTerrainErosionStats Erode(TArray<float>& Heights, int32 Rows, int32 Cols, const FTerrainErosionSettings& Settings);
+};
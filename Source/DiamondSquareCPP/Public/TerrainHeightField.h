@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class ETerrainSampleFilter : uint8
+{
+    // Matches the flat triangles of the mesh closely; reads 2x2 samples
+    Bilinear,
+    // Catmull-Rom through 4x4 samples; smooth gradients for normals and placement
+    Bicubic
+};
+
+// Heights of the terrain grid, quantized to 16 bits between their minimum and maximum. Coordinates are in
+// actor space, with grid vertex (X, Y) at (X * GridSpacing, Y * GridSpacing). Immutable once built, so it
+// can be read from any thread.
+class DIAMONDSQUARECPP_API FTerrainHeightField
+{
+public:
+    // Heights holds SizeX * SizeY actor-space heights, vertex (X, Y) at X * SizeY + Y
+    FTerrainHeightField(int32 InSizeX, int32 InSizeY, float InGridSpacing, TArrayView<const float> Heights);
+
+    // Empty field, to be filled by loading it with operator<<
+    FTerrainHeightField() = default;
+
+    // Saves or loads the quantized samples
+    friend DIAMONDSQUARECPP_API FArchive& operator<<(FArchive& Ar, FTerrainHeightField& Field);
+
+    // False for an empty field, or a loaded one whose samples do not match its size
+    bool IsValid() const
+    {
+        return SizeX > 0 && SizeY > 0 && GridSpacing > 0.0f && Samples.Num() == int64(SizeX) * SizeY;
+    }
+
+    int32 GetSizeX() const { return SizeX; }
+    int32 GetSizeY() const { return SizeY; }
+    float GetGridSpacing() const { return GridSpacing; }
+
+    // True when Local lies over the grid
+    bool IsInside(const FVector2D& Local) const;
+
+    // Height of vertex (X, Y), with the coordinates clamped to the grid
+    float GetSample(int32 X, int32 Y) const
+    {
+        X = FMath::Clamp(X, 0, SizeX - 1);
+        Y = FMath::Clamp(Y, 0, SizeY - 1);
+        return MinHeight + Samples[X * SizeY + Y] * HeightStep;
+    }
+
+    // Height at Local, clamped to the grid
+    float GetHeight(const FVector2D& Local, ETerrainSampleFilter Filter) const;
+
+    // Upward unit normal at Local, clamped to the grid
+    FVector GetNormal(const FVector2D& Local, ETerrainSampleFilter Filter) const;
+
+private:
+    // Sampling at fractional grid coordinates
+    float SampleBilinear(float GX, float GY) const;
+    float SampleBicubic(float GX, float GY) const;
+    float Sample(float GX, float GY, ETerrainSampleFilter Filter) const;
+
+    int32 SizeX = 0;
+    int32 SizeY = 0;
+    float GridSpacing = 1.0f;
+    float MinHeight = 0.0f;
+    float HeightStep = 0.0f;
+    TArray<uint16> Samples;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Sky visibility of a heightmap from horizon scans. Along each azimuth, one sweep per grid line keeps the upper
+// convex hull of the profile behind it, and the hull's tangent from a cell is that cell's horizon. A cell enters
+// and leaves the hull at most once per line, so each azimuth costs time linear in the cells.
+struct DIAMONDSQUARECPP_API FTerrainHorizonAO
+{
+    // Cosine-weighted share of the sky seen from each cell of a Rows x Cols plane of heights (row-major, in
+    // cells), in [0, 1]. Azimuths follow grid lines: 4 gives the axes, 8 adds the diagonals and 16 the knight's
+    // moves; each is weighted by the arc it stands for.
+    static void Bake(const TArray<float>& Heights, int32 Rows, int32 Cols, int32 NumDirections, TArray<float>& OutVisibility);
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Drainage of a height plane: where each cell's water goes and how many cells drain through it
+struct FTerrainFlow
+{
+    int32 Rows = 0;
+    int32 Cols = 0;
+
+    // D8 receiver of every cell (row-major), or INDEX_NONE for outlets
+    TArray<int32> Receivers;
+
+    // Every cell after its receiver, outlets first
+    TArray<int32> Order;
+
+    // Cells draining through each cell, itself included
+    TArray<float> Accumulation;
+};
+
+struct DIAMONDSQUARECPP_API FTerrainHydrology
+{
+    // Priority-flood from the outlets (cells with Outlets set, and the grid border) up through a Rows x Cols
+    // height plane. Each cell drains to the neighbour it was flooded from, so depressions and flats drain
+    // out through their spill points without the plane being filled first. Cells below the level they are
+    // reached at skip the heap, which keeps depressions linear; the rest is O(n log n).
+    static FTerrainFlow ComputeFlow(const TArray<float>& Heights, const TArray<uint8>& Outlets, int32 Rows, int32 Cols);
+
+    // Lowers cells draining at least Threshold cells by up to Depth, deeper for larger rivers, and makes
+    // every such cell at least as low as the river cells draining into it. Marks them in OutRivers.
+    static void CarveRivers(const FTerrainFlow& Flow, float Threshold, float Depth, TArray<float>& Heights, TArray<uint8>& OutRivers);
+};
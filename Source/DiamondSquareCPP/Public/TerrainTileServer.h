@@ -0,0 +1,132 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LruCache.h"
+#include "HAL/CriticalSection.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "UObject/StrongObjectPtr.h"
+#include "DiamondSquare.h"
+#include "BiomeTiles.h"
+
+class FQueuedThreadPool;
+class IHttpRouter;
+class IImageWrapperModule;
+struct FHttpRouteHandleInternal;
+struct FHttpServerRequest;
+struct FHttpServerResponse;
+
+// TileSize x TileSize cells of one zoom level, row-major with X as the row
+struct FTerrainTile
+{
+    // Noise heights in [0, 1], quantized to the full uint16 range
+    TArray<uint16> Heights;
+    TArray<ADiamondSquare::ECell> Biomes;
+};
+
+// Local HTTP service for terrain tiles, so tools can read the terrain without the editor:
+//
+//   GET /height?z=&x=&y=&...   TileSize^2 little-endian uint16 noise heights
+//   GET /biome?z=&x=&y=&...    TileSize^2 ECell bytes
+//   GET /color?z=&x=&y=&...    PNG of the biome colours
+//   GET /stats                 JSON counters since the last LogStats
+//
+// The other query parameters set the ADiamondSquare generation property of that name (seed=7, ShoreFalloff=6,
+// ...), clamped to the range the editor allows, and size sets the side of the map. Each distinct set of
+// parameters gets its own generator. Tiles follow the usual pyramid: zoom level MaxZoom holds the map at one
+// cell per pixel, and each level above halves it, so level 0 is a single tile. Tile x counts rows and y
+// columns; parts of a tile past the edge of the map are deep ocean.
+//
+// The routes run on the game thread and only queue work; tiles are made on a pool of worker threads and kept in
+// an LRU cache shared by all generators. Levels above MaxZoom are reduced from the four tiles under them, down
+// to MaxReducedLevels above it; levels higher still would read too many cells per tile and are not served.
+class DIAMONDSQUARECPP_API FTerrainTileServer
+{
+public:
+    static const int32 TileSize = 256;
+
+    struct FSettings
+    {
+        int32 Port = 8088;
+        int32 NumWorkers = 8;
+        int32 MaxCachedTiles = 4096;
+
+        // Generators alive at once; an idle one is dropped to make room for a new parameter set
+        int32 MaxGenerators = 8;
+
+        // Side of the map when a request has no size parameter
+        int32 DefaultMapSize = 4096;
+
+        // Zoom levels above MaxZoom that are served; a tile that many levels up reads 4^MaxReducedLevels tiles
+        int32 MaxReducedLevels = 3;
+    };
+
+    explicit FTerrainTileServer(const FSettings& InSettings);
+    ~FTerrainTileServer();
+
+    // Starts the workers and binds the routes; call from the game thread. False, having logged why, on failure.
+    bool Start();
+    void Stop();
+
+    // Logs the request counters and mean latency since the last call, and starts them over
+    void LogStats();
+
+private:
+    enum class ETileKind : uint8
+    {
+        Height,
+        Biome,
+        Color
+    };
+
+    // A configured terrain and the biome board its tiles are made from
+    struct FGenerator
+    {
+        FString Key;
+        TStrongObjectPtr<ADiamondSquare> Terrain;
+        FIntPoint MapSize = FIntPoint::ZeroValue;
+        int32 MaxZoom = 0;
+        double LastUsed = 0.0;
+
+        // The board is made by the first worker to need it
+        FCriticalSection PrepareLock;
+        bool bPrepared = false;
+        TArray<TArray<ADiamondSquare::ECell>> Root;
+        TArray<FBiomeTileStage> Stages;
+    };
+
+    using FGeneratorPtr = TSharedPtr<FGenerator, ESPMode::ThreadSafe>;
+    using FTilePtr = TSharedPtr<const FTerrainTile, ESPMode::ThreadSafe>;
+
+    // FHttpResultCallback and FHttpRouteHandle, spelled out so HTTPServer stays a private dependency
+    using FResultCallback = TFunction<void(TUniquePtr<FHttpServerResponse>&& Response)>;
+    using FRouteHandle = TSharedPtr<FHttpRouteHandleInternal>;
+
+    bool HandleTile(const FHttpServerRequest& Request, const FResultCallback& OnComplete, ETileKind Kind);
+    bool HandleStats(const FHttpServerRequest& Request, const FResultCallback& OnComplete);
+
+    // Generator for the parameters of Request, made on first use; game thread only
+    FGeneratorPtr FindOrAddGenerator(const FHttpServerRequest& Request, FString& OutError);
+
+    // Tile (Z, X, Y) of Generator from the cache, or made on the calling thread
+    FTilePtr GetTile(FGenerator& Generator, int32 Z, int32 X, int32 Y);
+
+    TArray<uint8> Encode(ETileKind Kind, const FTerrainTile& Tile) const;
+
+    FSettings Settings;
+    FQueuedThreadPool* Pool = nullptr;
+    IImageWrapperModule* ImageWrapperModule = nullptr;
+    TSharedPtr<IHttpRouter> Router;
+    TArray<FRouteHandle> Routes;
+
+    // Game thread only
+    TMap<FString, FGeneratorPtr> Generators;
+
+    FCriticalSection CacheLock;
+    TLruCache<FString, FTilePtr> Tiles;
+
+    FThreadSafeCounter64 NumRequests;
+    FThreadSafeCounter64 NumCacheHits;
+    FThreadSafeCounter64 NumTilesMade;
+    FThreadSafeCounter64 TotalMicroseconds;
+    double StatsStartTime = 0.0;
+};
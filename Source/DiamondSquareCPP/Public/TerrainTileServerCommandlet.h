@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TerrainTileServerCommandlet.generated.h"
+
+// Runs FTerrainTileServer headless until the process is asked to exit:
+//
+//   UnrealEditor-Cmd DiamondSquareCPP.uproject -run=TerrainTileServer [-port=8088] [-workers=8] [-cache=4096]
+//       [-generators=8] [-size=4096] [-reducedlevels=3] [-statsinterval=10]
+UCLASS()
+class DIAMONDSQUARECPP_API UTerrainTileServerCommandlet : public UCommandlet
+{
+    GENERATED_BODY()
+
+public:
+    UTerrainTileServerCommandlet();
+
+    virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Row-major planes of a saved world, with X as the row as everywhere in this module
+struct FTerrainWorldPlanes
+{
+    int32 Rows = 0;
+    int32 Cols = 0;
+
+    // Noise heights in [0, 1], quantized to the full uint16 range
+    TArray<uint16> Heights;
+
+    // One ADiamondSquare::ECell per cell
+    TArray<uint8> Biomes;
+
+    void Init(int32 InRows, int32 InCols)
+    {
+        Rows = InRows;
+        Cols = InCols;
+        Heights.SetNumUninitialized(InRows * InCols);
+        Biomes.SetNumUninitialized(InRows * InCols);
+    }
+};
+
+// World save file: a header, a table of chunk offsets, then square chunks compressed independently, so a region
+// loads by decompressing only the chunks it overlaps. A chunk stores its heights as the residuals of a gradient
+// predictor (left + up - up-left), zigzag coded and split into a plane of low bytes and a plane of high bytes,
+// then its biomes. Smooth terrain leaves residuals near zero, which compress far better than raw heights.
+class DIAMONDSQUARECPP_API FTerrainWorldFile
+{
+public:
+    // Writes World to Path in ChunkSize x ChunkSize chunks compressed with Format (any FCompression format, such
+    // as NAME_Zlib or NAME_Oodle). Chunks compress on worker threads, and the file is written beside Path and moved
+    // over it once complete. Returns false, having logged why, on failure.
+    static bool Save(const FString& Path, const FTerrainWorldPlanes& World, int32 ChunkSize = 256, FName Format = NAME_Zlib);
+
+    // Reads the header and chunk table of Path; chunk data is only read by the loads. Fails on a table entry that
+    // does not lie within the file.
+    bool Open(const FString& Path);
+
+    int32 GetRows() const { return Rows; }
+    int32 GetCols() const { return Cols; }
+    int32 GetChunkSize() const { return ChunkSize; }
+
+    // Loads the cells of Region (X rows, Y columns, Max exclusive, clamped to the world) into OutPlanes, sized to
+    // the clamped region. Only the overlapping chunks are read, and they decompress on worker threads.
+    bool LoadRegion(const FIntRect& Region, FTerrainWorldPlanes& OutPlanes) const;
+
+    bool LoadAll(FTerrainWorldPlanes& OutPlanes) const
+    {
+        return LoadRegion(FIntRect(0, 0, Rows, Cols), OutPlanes);
+    }
+
+private:
+    struct FChunkEntry
+    {
+        int64 Offset = 0;
+        int32 CompressedSize = 0;
+    };
+
+    FString FilePath;
+    int32 Rows = 0;
+    int32 Cols = 0;
+    int32 ChunkSize = 0;
+    int32 ChunksX = 0;
+    int32 ChunksY = 0;
+    FName Format;
+    TArray<FChunkEntry> Chunks;
+};
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Compares GenerationBenchmark results with the stored baseline and flags regressions.
+
+    GenerationBenchmark --benchmark_out=Results.json --benchmark_out_format=json --benchmark_repetitions=5
+    python Tools/GenerationBenchmark/CompareBaseline.py Results.json
+    python Tools/GenerationBenchmark/CompareBaseline.py Results.json --threshold 0.10
+    python Tools/GenerationBenchmark/CompareBaseline.py Results.json --update
+
+Reads Google Benchmark JSON, using the median of repeated runs when there is one. A benchmark more than
+--threshold slower than the baseline is a regression, and any regression makes the exit code 1. --update
+rewrites the baseline from the results instead; do that on the machine the comparisons will run on, since the
+times only mean something against the same hardware. Uses only the standard library.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "Baseline.json")
+
+NANOSECONDS = {"ns": 1.0, "us": 1.0e3, "ms": 1.0e6, "s": 1.0e9}
+
+
+def load_results(path):
+    """Real time in nanoseconds per benchmark name, preferring the median aggregate over single runs."""
+    with open(path) as results_file:
+        report = json.load(results_file)
+
+    times = {}
+    medians = {}
+    for entry in report.get("benchmarks", []):
+        if entry.get("error_occurred"):
+            continue
+        name = entry.get("run_name", entry["name"])
+        real_time = entry["real_time"] * NANOSECONDS[entry.get("time_unit", "ns")]
+        if entry.get("run_type") == "aggregate":
+            if entry.get("aggregate_name") == "median":
+                medians[name] = real_time
+        else:
+            times.setdefault(name, real_time)
+    times.update(medians)
+    return times, report.get("context", {})
+
+
+def format_time(nanoseconds):
+    for unit, scale in (("s", 1.0e9), ("ms", 1.0e6), ("us", 1.0e3)):
+        if nanoseconds >= scale:
+            return "{:.2f} {}".format(nanoseconds / scale, unit)
+    return "{:.1f} ns".format(nanoseconds)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("results", help="GenerationBenchmark output in JSON")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE)
+    parser.add_argument("--threshold", type=float, default=0.15, help="slowdown that counts as a regression")
+    parser.add_argument("--update", action="store_true", help="write the results as the new baseline")
+    args = parser.parse_args()
+
+    results, context = load_results(args.results)
+    if not results:
+        print("no benchmark results in {}".format(args.results))
+        return 1
+
+    if args.update:
+        baseline = {
+            "context": {key: context[key] for key in ("num_cpus", "mhz_per_cpu", "library_build_type") if key in context},
+            "benchmarks": {name: {"real_time_ns": round(time, 1)} for name, time in sorted(results.items())},
+        }
+        with open(args.baseline, "w") as baseline_file:
+            json.dump(baseline, baseline_file, indent=2, sort_keys=True)
+            baseline_file.write("\n")
+        print("wrote {} benchmarks to {}".format(len(results), args.baseline))
+        return 0
+
+    with open(args.baseline) as baseline_file:
+        stored = json.load(baseline_file)
+    baseline = {name: entry["real_time_ns"] for name, entry in stored["benchmarks"].items()}
+
+    # The thread-count variants only compare between machines with the same number of cores
+    baseline_cpus = stored.get("context", {}).get("num_cpus")
+    if baseline_cpus is not None and context.get("num_cpus") not in (None, baseline_cpus):
+        print("warning: baseline recorded on {} CPUs, results on {}; rerun with --update on this machine".format(
+            baseline_cpus, context["num_cpus"]))
+        print()
+
+    regressions = []
+    improvements = []
+    width = max(len(name) for name in results)
+    for name in sorted(results):
+        if name not in baseline:
+            print("{:<{}}  {:>10}  new".format(name, width, format_time(results[name])))
+            continue
+        change = results[name] / baseline[name] - 1.0
+        status = ""
+        if change > args.threshold:
+            status = "REGRESSION"
+            regressions.append(name)
+        elif change < -args.threshold:
+            status = "improved"
+            improvements.append(name)
+        print("{:<{}}  {:>10}  {:>10}  {:+7.1%}  {}".format(
+            name, width, format_time(baseline[name]), format_time(results[name]), change, status))
+
+    missing = sorted(set(baseline) - set(results))
+    print()
+    print("{} compared, {} regressions, {} improved beyond {:.0%}, {} in the baseline but not run".format(
+        len(results) - sum(1 for name in results if name not in baseline), len(regressions), len(improvements),
+        args.threshold, len(missing)))
+    for name in regressions:
+        print("  regression  {}".format(name))
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,466 @@
+// Microbenchmarks for every stage of the generation core: the biome automaton stages, the fractal noise fill,
+// vertex and index building and foliage scattering, at map sizes from 200 to 2048 cells a side. The noise fill
+// also sweeps octave counts. Each benchmark runs the core the way the actor calls it; where the actor hands rows
+// to ParallelFor, this hands the same row-by-row calls to a pool of 1 to 8 threads. The stages that only exist in the engine (WarmToTemperate, FreezingToCold, DeepOcean, Shore and RemoveSpecks) are
+// timed by the DiamondSquare.Performance.BiomeStages automation test instead. Results come out in Google
+// Benchmark's formats; write them as JSON and check them against the stored baseline with CompareBaseline.py:
+//
+//   GenerationBenchmark --benchmark_out=Results.json --benchmark_out_format=json --benchmark_repetitions=5
+//   python Tools/GenerationBenchmark/CompareBaseline.py Results.json
+//
+// Lives outside the module directory so Unreal Build Tool does not compile its main into the game.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "GenerationCore/BiomeStages.h"
+#include "GenerationCore/Foliage.h"
+#include "GenerationCore/GridMesh.h"
+#include "GenerationCore/Noise.h"
+#include "GenerationCore/Random.h"
+
+using namespace GenerationCore;
+
+namespace
+{
+    const int32_t BenchmarkSeed = 1337;
+    const float ProbabilityOfLand = 0.5f;
+
+    // Map sides, in cells, every sized benchmark runs at
+    const std::vector<int64_t> MapSizes = { 200, 512, 1024, 2048 };
+    const std::vector<int64_t> OctaveCounts = { 1, 4, 12 };
+    const std::vector<int64_t> ThreadCounts = { 1, 2, 4, 8 };
+
+    // How far through the pipeline a fixture board is
+    enum class EBoardPhase
+    {
+        // Land and ocean only, as the island stages see it
+        LandOcean,
+        // After AddTemps
+        Temperature,
+        // After TemperatureToBiome
+        Biome
+    };
+
+    FBiomeBoard Crop(const FBiomeBoard& Board, int32_t Size)
+    {
+        FBiomeBoard Result(Size, Size);
+        for (int32_t R = 0; R < Size; ++R)
+        {
+            std::copy(Board.Row(R), Board.Row(R) + Size, Result.Row(R));
+        }
+        return Result;
+    }
+
+    // Size x Size board grown from a seeded island the way the pipeline grows it; built once per size and phase
+    const FBiomeBoard& GetBoard(int32_t Size, EBoardPhase Phase)
+    {
+        static std::map<std::pair<int32_t, EBoardPhase>, FBiomeBoard> Boards;
+        const auto Key = std::make_pair(Size, Phase);
+        auto Found = Boards.find(Key);
+        if (Found != Boards.end())
+        {
+            return Found->second;
+        }
+
+        FRandom Random(BenchmarkSeed);
+        FBiomeBoard Board = Island(Random);
+        uint32_t ZoomSeed = 0;
+        while (Board.Rows < Size)
+        {
+            Board = Zoom(AddIsland(Board, ProbabilityOfLand, Random), ZoomSeed++);
+        }
+        Board = Crop(Board, Size);
+        if (Phase != EBoardPhase::LandOcean)
+        {
+            Board = AddTemps(Board, Random);
+        }
+        if (Phase == EBoardPhase::Biome)
+        {
+            Board = TemperatureToBiome(Board, Random);
+        }
+        return Boards.emplace(Key, std::move(Board)).first->second;
+    }
+
+    // Size x Size noise heights in [0, 1]; built once per size
+    const TGrid<float>& GetHeights(int32_t Size)
+    {
+        static std::map<int32_t, TGrid<float>> Heights;
+        auto Found = Heights.find(Size);
+        if (Found != Heights.end())
+        {
+            return Found->second;
+        }
+
+        FFractalNoiseSettings Settings;
+        Settings.Octaves = 4;
+        Settings.Scale = 64.0f;
+        Settings.Lacunarity = 2.0f;
+        Settings.Persistence = 0.5f;
+        TGrid<float> Grid(Size, Size);
+        FillFractalNoise(Settings, Grid);
+        for (float& Height : Grid.Cells)
+        {
+            Height = std::min(std::max(Height * 0.5f + 0.5f, 0.0f), 1.0f);
+        }
+        return Heights.emplace(Size, std::move(Grid)).first->second;
+    }
+
+    // Threads that share out the rows of a grid as ParallelFor does the rows of the actor's maps: each takes the
+    // next row until none are left, and the calling thread works alongside them. The workers outlive each Run, as
+    // the task graph's do, so an iteration does not pay for starting threads.
+    class FRowPool
+    {
+    public:
+        explicit FRowPool(int32_t NumThreads)
+        {
+            for (int32_t Index = 1; Index < NumThreads; ++Index)
+            {
+                Workers.emplace_back([this]() { WorkerLoop(); });
+            }
+        }
+
+        ~FRowPool()
+        {
+            {
+                std::lock_guard<std::mutex> Lock(Mutex);
+                bStop = true;
+            }
+            Wake.notify_all();
+            for (std::thread& Worker : Workers)
+            {
+                Worker.join();
+            }
+        }
+
+        // Calls Func(Row) for every row in [0, Rows) and returns once all have finished
+        void Run(int32_t Rows, const std::function<void(int32_t)>& Func)
+        {
+            {
+                std::lock_guard<std::mutex> Lock(Mutex);
+                Job = &Func;
+                NumRows = Rows;
+                NextRow = 0;
+                NumBusy = int32_t(Workers.size());
+                ++Generation;
+            }
+            Wake.notify_all();
+            TakeRows();
+
+            std::unique_lock<std::mutex> Lock(Mutex);
+            Done.wait(Lock, [this]() { return NumBusy == 0; });
+        }
+
+    private:
+        void TakeRows()
+        {
+            for (int32_t Row = NextRow++; Row < NumRows; Row = NextRow++)
+            {
+                (*Job)(Row);
+            }
+        }
+
+        void WorkerLoop()
+        {
+            uint64_t SeenGeneration = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> Lock(Mutex);
+                    Wake.wait(Lock, [this, SeenGeneration]() { return bStop || Generation != SeenGeneration; });
+                    if (bStop)
+                    {
+                        return;
+                    }
+                    SeenGeneration = Generation;
+                }
+                TakeRows();
+
+                std::lock_guard<std::mutex> Lock(Mutex);
+                if (--NumBusy == 0)
+                {
+                    Done.notify_one();
+                }
+            }
+        }
+
+        std::vector<std::thread> Workers;
+        std::mutex Mutex;
+        std::condition_variable Wake;
+        std::condition_variable Done;
+        const std::function<void(int32_t)>* Job = nullptr;
+        int32_t NumRows = 0;
+        std::atomic<int32_t> NextRow{ 0 };
+        int32_t NumBusy = 0;
+        uint64_t Generation = 0;
+        bool bStop = false;
+    };
+
+    void SetCellsProcessed(benchmark::State& State, int64_t CellsPerIteration)
+    {
+        State.SetItemsProcessed(int64_t(State.iterations()) * CellsPerIteration);
+        State.counters["cells"] = double(CellsPerIteration);
+    }
+
+    // Foliage densities close to the actor defaults: dense in forests, sparse on open land, none at sea
+    float GetBenchmarkDensity(ECell Cell)
+    {
+        switch (Cell)
+        {
+        case ECell::Forest:
+        case ECell::Woodland:
+        case ECell::Rainforest:
+        case ECell::Taiga:
+        case ECell::SnowyForest:
+            return 0.2f;
+        case ECell::Ocean:
+        case ECell::DeepOcean:
+            return 0.0f;
+        default:
+            return 0.02f;
+        }
+    }
+}
+
+
+// Biome stages. Stages that double the board read a board of half the size, so every stage writes Size^2 cells.
+
+static void BM_Island(benchmark::State& State)
+{
+    FRandom Random(BenchmarkSeed);
+    for (auto _ : State)
+    {
+        benchmark::DoNotOptimize(Island(Random));
+    }
+}
+BENCHMARK(BM_Island);
+
+static void BM_FuzzyZoom(benchmark::State& State)
+{
+    const int32_t Size = int32_t(State.range(0));
+    const FBiomeBoard& Board = GetBoard(Size / 2, EBoardPhase::LandOcean);
+    FRandom Random(BenchmarkSeed);
+    for (auto _ : State)
+    {
+        benchmark::DoNotOptimize(FuzzyZoom(Board, Random));
+    }
+    SetCellsProcessed(State, int64_t(Board.Num()) * 4);
+}
+BENCHMARK(BM_FuzzyZoom)->ArgsProduct({ MapSizes })->Unit(benchmark::kMicrosecond);
+
+static void BM_Zoom(benchmark::State& State)
+{
+    const int32_t Size = int32_t(State.range(0));
+    const FBiomeBoard& Board = GetBoard(Size / 2, EBoardPhase::Biome);
+    for (auto _ : State)
+    {
+        benchmark::DoNotOptimize(Zoom(Board, 7));
+    }
+    SetCellsProcessed(State, int64_t(Board.Num()) * 4);
+}
+BENCHMARK(BM_Zoom)->ArgsProduct({ MapSizes })->Unit(benchmark::kMicrosecond);
+
+static void BM_AddIsland(benchmark::State& State)
+{
+    const FBiomeBoard& Board = GetBoard(int32_t(State.range(0)), EBoardPhase::LandOcean);
+    FRandom Random(BenchmarkSeed);
+    for (auto _ : State)
+    {
+        benchmark::DoNotOptimize(AddIsland(Board, ProbabilityOfLand, Random));
+    }
+    SetCellsProcessed(State, Board.Num());
+}
+BENCHMARK(BM_AddIsland)->ArgsProduct({ MapSizes })->Unit(benchmark::kMicrosecond);
+
+static void BM_AddIsland2(benchmark::State& State)
+{
+    const FBiomeBoard& Board = GetBoard(int32_t(State.range(0)), EBoardPhase::Biome);
+    FRandom Random(BenchmarkSeed);
+    for (auto _ : State)
+    {
+        benchmark::DoNotOptimize(AddIsland2(Board, ProbabilityOfLand, Random));
+    }
+    SetCellsProcessed(State, Board.Num());
+}
+BENCHMARK(BM_AddIsland2)->ArgsProduct({ MapSizes })->Unit(benchmark::kMicrosecond);
+
+static void BM_RemoveTooMuchOcean(benchmark::State& State)
+{
+    const FBiomeBoard& Board = GetBoard(int32_t(State.range(0)), EBoardPhase::LandOcean);
+    FRandom Random(BenchmarkSeed);
+    for (auto _ : State)
+    {
+        benchmark::DoNotOptimize(RemoveTooMuchOcean(Board, Random));
+    }
+    SetCellsProcessed(State, Board.Num());
+}
+BENCHMARK(BM_RemoveTooMuchOcean)->ArgsProduct({ MapSizes })->Unit(benchmark::kMicrosecond);
+
+static void BM_AddTemps(benchmark::State& State)
+{
+    const FBiomeBoard& Board = GetBoard(int32_t(State.range(0)), EBoardPhase::LandOcean);
+    FRandom Random(BenchmarkSeed);
+    for (auto _ : State)
+    {
+        benchmark::DoNotOptimize(AddTemps(Board, Random));
+    }
+    SetCellsProcessed(State, Board.Num());
+}
+BENCHMARK(BM_AddTemps)->ArgsProduct({ MapSizes })->Unit(benchmark::kMicrosecond);
+
+static void BM_TemperatureToBiome(benchmark::State& State)
+{
+    const FBiomeBoard& Board = GetBoard(int32_t(State.range(0)), EBoardPhase::Temperature);
+    FRandom Random(BenchmarkSeed);
+    for (auto _ : State)
+    {
+        benchmark::DoNotOptimize(TemperatureToBiome(Board, Random));
+    }
+    SetCellsProcessed(State, Board.Num());
+}
+BENCHMARK(BM_TemperatureToBiome)->ArgsProduct({ MapSizes })->Unit(benchmark::kMicrosecond);
+
+static void BM_SurroundWithOcean(benchmark::State& State)
+{
+    FBiomeBoard Board = GetBoard(int32_t(State.range(0)), EBoardPhase::Biome);
+    for (auto _ : State)
+    {
+        SurroundWithOcean(Board);
+        benchmark::ClobberMemory();
+    }
+    SetCellsProcessed(State, Board.Num());
+}
+BENCHMARK(BM_SurroundWithOcean)->ArgsProduct({ MapSizes })->Unit(benchmark::kMicrosecond);
+
+static void BM_ComputeEdgeMask(benchmark::State& State)
+{
+    const FBiomeBoard& Board = GetBoard(int32_t(State.range(0)), EBoardPhase::Biome);
+    TGrid<uint8_t> Mask;
+    for (auto _ : State)
+    {
+        ComputeEdgeMask(Board, Mask);
+        benchmark::DoNotOptimize(Mask.Cells.data());
+    }
+    SetCellsProcessed(State, Board.Num());
+}
+BENCHMARK(BM_ComputeEdgeMask)->ArgsProduct({ MapSizes })->Unit(benchmark::kMicrosecond);
+
+
+// Fractal noise fill as GeneratePerlinNoiseMap runs it, a row per call shared out over threads: Size, Octaves,
+// Threads. The actor samples the engine's Perlin noise, which the core's FPerlinNoise stands in for here.
+
+static void BM_NoiseFill(benchmark::State& State)
+{
+    const int32_t Size = int32_t(State.range(0));
+    FFractalNoiseSettings Settings;
+    Settings.Octaves = int32_t(State.range(1));
+    FRowPool Pool(int32_t(State.range(2)));
+    TGrid<float> Noise(Size, Size);
+    const std::function<void(int32_t)> FillRow = [&Settings, &Noise](int32_t X)
+        {
+            FillFractalNoise(Settings, Noise, X, X + 1, FPerlinNoise());
+        };
+    for (auto _ : State)
+    {
+        Pool.Run(Size, FillRow);
+        benchmark::DoNotOptimize(Noise.Cells.data());
+    }
+    SetCellsProcessed(State, Noise.Num());
+}
+BENCHMARK(BM_NoiseFill)->ArgsProduct({ MapSizes, OctaveCounts, ThreadCounts })->Unit(benchmark::kMillisecond)->UseRealTime();
+
+
+// Mesh building: CreateVertices (Size, Threads, a row per call as the actor runs it) and CreateTriangles (Size,
+// with or without a cave layer)
+
+static void BM_CreateVertices(benchmark::State& State)
+{
+    const TGrid<float>& Heights = GetHeights(int32_t(State.range(0)));
+    FRowPool Pool(int32_t(State.range(1)));
+    const FGridMeshSettings Settings;
+    std::vector<float> Positions(size_t(Heights.Num()) * 3);
+    std::vector<float> UVs(size_t(Heights.Num()) * 2);
+    const std::function<void(int32_t)> BuildRow = [&](int32_t X)
+        {
+            BuildGridVertices(Heights, Settings, X, X + 1, Positions.data(), UVs.data());
+        };
+    for (auto _ : State)
+    {
+        Pool.Run(Heights.Rows, BuildRow);
+        benchmark::DoNotOptimize(Positions.data());
+    }
+    SetCellsProcessed(State, Heights.Num());
+}
+BENCHMARK(BM_CreateVertices)->ArgsProduct({ MapSizes, ThreadCounts })->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_CreateTriangles(benchmark::State& State)
+{
+    const int32_t Size = int32_t(State.range(0));
+    const bool bCaves = State.range(1) != 0;
+
+    // A cave layer over the middle third of the map, where whole quads drop out
+    std::vector<float> CaveMask;
+    if (bCaves)
+    {
+        CaveMask.assign(size_t(Size) * Size, 0.0f);
+        for (int32_t X = Size / 3; X < 2 * Size / 3; ++X)
+        {
+            std::fill(CaveMask.begin() + size_t(X) * Size + Size / 3, CaveMask.begin() + size_t(X) * Size + 2 * Size / 3, 1.0f);
+        }
+    }
+
+    std::vector<int32_t> Indices(size_t(GetMaxGridTriangleIndices(Size, Size)));
+    int64_t NumIndices = 0;
+    for (auto _ : State)
+    {
+        NumIndices = BuildGridTriangles(Size, Size, bCaves ? CaveMask.data() : nullptr, Indices.data());
+        benchmark::DoNotOptimize(Indices.data());
+    }
+    SetCellsProcessed(State, int64_t(Size) * Size);
+    State.counters["triangles"] = double(NumIndices / 3);
+}
+BENCHMARK(BM_CreateTriangles)->ArgsProduct({ MapSizes, { 0, 1 } })->Unit(benchmark::kMicrosecond);
+
+
+// Foliage scattering over the whole map
+
+static void BM_ScatterFoliage(benchmark::State& State)
+{
+    const int32_t Size = int32_t(State.range(0));
+    const FBiomeBoard& Board = GetBoard(Size, EBoardPhase::Biome);
+    const TGrid<float>& Heights = GetHeights(Size);
+    const FGridMeshSettings Settings;
+    FRandom Random(BenchmarkSeed);
+    std::vector<float> Instances;
+    int32_t NumInstances = 0;
+    for (auto _ : State)
+    {
+        Instances.clear();
+        NumInstances = ScatterFoliage(0, Size, 0, Size,
+            [&Board](int32_t X, int32_t Y) { return GetBenchmarkDensity(Board(X, Y)); },
+            Random,
+            [&](int32_t X, int32_t Y, float Yaw)
+            {
+                Instances.push_back(X * Settings.Scale);
+                Instances.push_back(Y * Settings.Scale);
+                Instances.push_back(GetVertexHeight(Settings, Heights(X, Y)));
+                Instances.push_back(Yaw);
+            });
+        benchmark::DoNotOptimize(Instances.data());
+    }
+    SetCellsProcessed(State, Board.Num());
+    State.counters["instances"] = double(NumInstances);
+}
+BENCHMARK(BM_ScatterFoliage)->ArgsProduct({ MapSizes })->Unit(benchmark::kMicrosecond);
+
+
+BENCHMARK_MAIN();
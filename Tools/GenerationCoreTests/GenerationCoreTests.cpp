@@ -0,0 +1,214 @@
+// Correctness checks for the generation core, run by CTest. They pin down what the engine's faster paths rely on:
+// a Zoom tile made from a halo-padded window of its input matches the whole-board Zoom, grids filled by row range
+// match a single fill, and the island stages keep their documented rules. Prints each failed check and exits
+// non-zero if there was one:
+//
+//   cmake -S Source/DiamondSquareCPP/GenerationCore -B Build/GenerationCore
+//   cmake --build Build/GenerationCore && ctest --test-dir Build/GenerationCore --output-on-failure
+//
+// Lives outside the module directory so Unreal Build Tool does not compile its main into the game.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "GenerationCore/BiomeStages.h"
+#include "GenerationCore/GridMesh.h"
+#include "GenerationCore/Noise.h"
+#include "GenerationCore/Random.h"
+
+using namespace GenerationCore;
+
+namespace
+{
+    int32_t NumFailures = 0;
+
+#define GENERATION_CORE_CHECK(Condition) \
+    do \
+    { \
+        if (!(Condition)) \
+        { \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #Condition); \
+            ++NumFailures; \
+        } \
+    } while (0)
+
+    const int32_t Seeds[] = { 1, 1337, 90210 };
+
+    // Rows x Cols board of Land and Ocean, half of each
+    FBiomeBoard MakeLandOceanBoard(int32_t Rows, int32_t Cols, int32_t Seed)
+    {
+        FRandom Random(Seed);
+        FBiomeBoard Board(Rows, Cols);
+        for (ECell& Cell : Board.Cells)
+        {
+            Cell = Random.FRand() < 0.5f ? ECell::Land : ECell::Ocean;
+        }
+        return Board;
+    }
+
+    // Zooms Board tile by tile, each tile reading only the window of Board under it plus a one-cell halo, as the
+    // engine's FBiomeTiles does
+    FBiomeBoard ZoomByTiles(const FBiomeBoard& Board, uint32_t StageSeed, int32_t TileSize)
+    {
+        const int32_t Rows = Board.Rows * 2;
+        const int32_t Cols = Board.Cols * 2;
+        FBiomeBoard Result(Rows, Cols);
+        for (int32_t TileR = 0; TileR < Rows; TileR += TileSize)
+        {
+            for (int32_t TileC = 0; TileC < Cols; TileC += TileSize)
+            {
+                const int32_t EndR = TileR + TileSize < Rows ? TileR + TileSize : Rows;
+                const int32_t EndC = TileC + TileSize < Cols ? TileC + TileSize : Cols;
+
+                // Input cells under the tile, widened by one on each side for the edge test and the jitter
+                const int32_t MinR = ClampIndex(TileR / 2 - 1, 0, Board.Rows - 1);
+                const int32_t MinC = ClampIndex(TileC / 2 - 1, 0, Board.Cols - 1);
+                const int32_t MaxR = ClampIndex((EndR - 1) / 2 + 1, 0, Board.Rows - 1);
+                const int32_t MaxC = ClampIndex((EndC - 1) / 2 + 1, 0, Board.Cols - 1);
+                FBiomeBoard Window(MaxR - MinR + 1, MaxC - MinC + 1);
+                for (int32_t R = MinR; R <= MaxR; ++R)
+                {
+                    for (int32_t C = MinC; C <= MaxC; ++C)
+                    {
+                        Window(R - MinR, C - MinC) = Board(R, C);
+                    }
+                }
+
+                auto Scaled = [&Window, MinR, MinC](int32_t R, int32_t C) { return Window(R / 2 - MinR, C / 2 - MinC); };
+                for (int32_t R = TileR; R < EndR; ++R)
+                {
+                    for (int32_t C = TileC; C < EndC; ++C)
+                    {
+                        Result(R, C) = ZoomCell(Scaled, Rows, Cols, StageSeed, R, C);
+                    }
+                }
+            }
+        }
+        return Result;
+    }
+
+    void TestZoomTiles()
+    {
+        const int32_t TileSizes[] = { 1, 7, 16, 50, 128 };
+        for (const int32_t Seed : Seeds)
+        {
+            const FBiomeBoard Board = MakeLandOceanBoard(61, 45, Seed);
+            const FBiomeBoard Whole = Zoom(Board, uint32_t(Seed));
+            for (const int32_t TileSize : TileSizes)
+            {
+                GENERATION_CORE_CHECK(ZoomByTiles(Board, uint32_t(Seed), TileSize).Cells == Whole.Cells);
+            }
+        }
+    }
+
+    void TestNoiseRowRanges()
+    {
+        FFractalNoiseSettings Settings;
+        Settings.Octaves = 4;
+        Settings.Scale = 37.0f;
+
+        TGrid<float> Whole(97, 53);
+        FillFractalNoise(Settings, Whole);
+
+        // Uneven row blocks, filled out of order as ParallelFor may run them
+        const int32_t BlockRows = 10;
+        TGrid<float> Blocks(Whole.Rows, Whole.Cols);
+        for (int32_t First = (Whole.Rows - 1) / BlockRows * BlockRows; First >= 0; First -= BlockRows)
+        {
+            const int32_t End = First + BlockRows < Whole.Rows ? First + BlockRows : Whole.Rows;
+            FillFractalNoise(Settings, Blocks, First, End, FPerlinNoise());
+        }
+        GENERATION_CORE_CHECK(Blocks.Cells == Whole.Cells);
+    }
+
+    void TestVertexRowRanges()
+    {
+        FFractalNoiseSettings NoiseSettings;
+        NoiseSettings.Octaves = 3;
+        TGrid<float> Noise(41, 29);
+        FillFractalNoise(NoiseSettings, Noise);
+
+        FGridMeshSettings Settings;
+        Settings.UVScale = 0.25f;
+        const size_t NumVertices = size_t(Noise.Num());
+        std::vector<float> WholePositions(NumVertices * 3);
+        std::vector<float> WholeUVs(NumVertices * 2);
+        BuildGridVertices(Noise, Settings, WholePositions.data(), WholeUVs.data());
+
+        // Noise below zero gives NaN heights, so compare the bits rather than the values
+        std::vector<float> Positions(NumVertices * 3);
+        std::vector<float> UVs(NumVertices * 2);
+        for (int32_t Row = Noise.Rows - 1; Row >= 0; --Row)
+        {
+            BuildGridVertices(Noise, Settings, Row, Row + 1, Positions.data(), UVs.data());
+        }
+        GENERATION_CORE_CHECK(std::memcmp(Positions.data(), WholePositions.data(), Positions.size() * sizeof(float)) == 0);
+        GENERATION_CORE_CHECK(std::memcmp(UVs.data(), WholeUVs.data(), UVs.size() * sizeof(float)) == 0);
+    }
+
+    void TestGridTriangles()
+    {
+        const int32_t Rows = 5;
+        const int32_t Cols = 4;
+        std::vector<int32_t> Indices(size_t(GetMaxGridTriangleIndices(Rows, Cols)));
+        GENERATION_CORE_CHECK(BuildGridTriangles(Rows, Cols, nullptr, Indices.data()) == int64_t(Indices.size()));
+        for (const int32_t Index : Indices)
+        {
+            GENERATION_CORE_CHECK(Index >= 0 && Index < Rows * Cols);
+        }
+
+        // Only quads with all four corners masked are left out
+        std::vector<float> SkipMask(size_t(Rows * Cols), 1.0f);
+        GENERATION_CORE_CHECK(BuildGridTriangles(Rows, Cols, SkipMask.data(), Indices.data()) == 0);
+        SkipMask[0] = 0.0f;
+        GENERATION_CORE_CHECK(BuildGridTriangles(Rows, Cols, SkipMask.data(), Indices.data()) == 6);
+        GENERATION_CORE_CHECK(GetMaxGridTriangleIndices(1, Cols) == 0);
+    }
+
+    void TestAddIsland2Majority()
+    {
+        // A tie between the up/right and down/left neighbours goes to the one seen first, up
+        FBiomeBoard Board(3, 3, ECell::Ocean);
+        Board(0, 1) = ECell::Desert;
+        Board(2, 1) = ECell::Plains;
+        Board(1, 0) = ECell::Plains;
+        Board(1, 2) = ECell::Desert;
+        FRandom Random(1);
+        GENERATION_CORE_CHECK(AddIsland2(Board, 1.0f, Random)(1, 1) == ECell::Desert);
+
+        // Temperature cells are never reshaped
+        Board(1, 1) = ECell::Warm;
+        GENERATION_CORE_CHECK(AddIsland2(Board, 1.0f, Random)(1, 1) == ECell::Warm);
+    }
+
+    void TestStagesRepeatBySeed()
+    {
+        for (const int32_t Seed : Seeds)
+        {
+            const FBiomeBoard Board = MakeLandOceanBoard(40, 40, Seed);
+            FRandom First(Seed);
+            FRandom Second(Seed);
+            GENERATION_CORE_CHECK(TemperatureToBiome(AddTemps(Board, First), First).Cells == TemperatureToBiome(AddTemps(Board, Second), Second).Cells);
+            GENERATION_CORE_CHECK(First.GetCurrentSeed() == Second.GetCurrentSeed());
+        }
+    }
+}
+
+int main()
+{
+    TestZoomTiles();
+    TestNoiseRowRanges();
+    TestVertexRowRanges();
+    TestGridTriangles();
+    TestAddIsland2Majority();
+    TestStagesRepeatBySeed();
+
+    if (NumFailures > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", int(NumFailures));
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}
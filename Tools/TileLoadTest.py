@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Load generator for the terrain tile server (UTerrainTileServerCommandlet).
+
+Fires tile requests at the server from a pool of client threads and reports throughput, latency percentiles
+and the server's own counters. Uses only the standard library.
+
+    python Tools/TileLoadTest.py --port 8088 --clients 16 --requests 2000 --zoom 4 --kind color
+    python Tools/TileLoadTest.py --hot 32 --seed 7 --param ShoreFalloff=6
+
+With --hot N the requests cycle over N tiles, so after the first pass they measure the cache; without it every
+request picks a random tile of the zoom level, which mostly measures generation.
+"""
+
+import argparse
+import json
+import random
+import statistics
+import threading
+import time
+import urllib.error
+import urllib.parse
+import urllib.request
+from concurrent.futures import ThreadPoolExecutor
+
+TILE_SIZE = 256
+
+
+def percentile(sorted_values, fraction):
+    if not sorted_values:
+        return 0.0
+    index = min(len(sorted_values) - 1, int(round(fraction * (len(sorted_values) - 1))))
+    return sorted_values[index]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=8088)
+    parser.add_argument("--clients", type=int, default=8, help="requests in flight at once")
+    parser.add_argument("--requests", type=int, default=1000)
+    parser.add_argument("--kind", choices=["height", "biome", "color"], default="height")
+    parser.add_argument("--zoom", type=int, default=None, help="zoom level; defaults to the deepest for --size")
+    parser.add_argument("--size", type=int, default=4096, help="side of the map, in cells")
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--param", action="append", default=[], metavar="NAME=VALUE",
+                        help="extra ADiamondSquare property to set; may be repeated")
+    parser.add_argument("--hot", type=int, default=0, help="cycle over this many tiles instead of random ones")
+    parser.add_argument("--timeout", type=float, default=120.0)
+    args = parser.parse_args()
+
+    max_zoom = 0
+    while (TILE_SIZE << max_zoom) < args.size:
+        max_zoom += 1
+    zoom = max_zoom if args.zoom is None else args.zoom
+    span = TILE_SIZE << (max_zoom - zoom)
+    tiles_per_side = (args.size + span - 1) // span
+
+    base_params = {"seed": str(args.seed), "size": str(args.size), "z": str(zoom)}
+    for param in args.param:
+        name, _, value = param.partition("=")
+        base_params[name] = value
+
+    rng = random.Random(args.seed)
+    all_tiles = [(x, y) for x in range(tiles_per_side) for y in range(tiles_per_side)]
+    hot_tiles = rng.sample(all_tiles, min(args.hot, len(all_tiles))) if args.hot > 0 else None
+    requests = []
+    for index in range(args.requests):
+        requests.append(hot_tiles[index % len(hot_tiles)] if hot_tiles else rng.choice(all_tiles))
+
+    base_url = "http://{}:{}".format(args.host, args.port)
+    latencies = []
+    errors = []
+    received_bytes = [0]
+    lock = threading.Lock()
+
+    def fetch(tile):
+        params = dict(base_params, x=str(tile[0]), y=str(tile[1]))
+        url = "{}/{}?{}".format(base_url, args.kind, urllib.parse.urlencode(params))
+        start = time.perf_counter()
+        try:
+            with urllib.request.urlopen(url, timeout=args.timeout) as response:
+                body = response.read()
+            elapsed = time.perf_counter() - start
+            with lock:
+                latencies.append(elapsed)
+                received_bytes[0] += len(body)
+        except (urllib.error.URLError, OSError) as error:
+            with lock:
+                errors.append(str(error))
+
+    print("{} {} requests at zoom {} ({} x {} tiles) from {} clients".format(
+        args.requests, args.kind, zoom, tiles_per_side, tiles_per_side, args.clients))
+    start = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=args.clients) as pool:
+        list(pool.map(fetch, requests))
+    wall = time.perf_counter() - start
+
+    latencies.sort()
+    print("  completed  {} in {:.2f} s, {} errors".format(len(latencies), wall, len(errors)))
+    print("  throughput {:.1f} tiles/s, {:.1f} MB/s".format(len(latencies) / wall, received_bytes[0] / wall / 1.0e6))
+    if latencies:
+        print("  latency    mean {:.1f} ms, p50 {:.1f} ms, p95 {:.1f} ms, p99 {:.1f} ms, max {:.1f} ms".format(
+            1000.0 * statistics.mean(latencies), 1000.0 * percentile(latencies, 0.50),
+            1000.0 * percentile(latencies, 0.95), 1000.0 * percentile(latencies, 0.99), 1000.0 * latencies[-1]))
+    for error in sorted(set(errors))[:5]:
+        print("  error      {}".format(error))
+
+    try:
+        with urllib.request.urlopen(base_url + "/stats", timeout=args.timeout) as response:
+            print("  server     {}".format(json.dumps(json.loads(response.read()))))
+    except (urllib.error.URLError, OSError, ValueError) as error:
+        print("  server     stats unavailable: {}".format(error))
+
+    return 1 if errors else 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())